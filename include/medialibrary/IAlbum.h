@@ -46,12 +46,27 @@ public:
      * @brief tracks fetches album tracks from the database
      */
     virtual std::vector<std::shared_ptr<IMedia>> tracks( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+    /**
+     * @brief tracks fetches a page of album tracks from the database
+     * @param pageSize The maximum number of tracks to return. 0 means no limit.
+     * @param continuation The token returned as Page::next by a previous call
+     * with the same sort & desc parameters, or an empty string for the first page.
+     */
+    virtual Page<IMedia> tracks( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation = {} ) const = 0;
+    /**
+     * @brief trackIds Returns the ids of the album tracks, in the order tracks()
+     * would return them, without fetching the tracks themselves.
+     */
+    virtual std::vector<int64_t> trackIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
     /**
      * @brief tracks fetches album tracks, filtered by genre
      * @param genre A musical genre. Only tracks of this genre will be returned
      * @return
      */
     virtual std::vector<std::shared_ptr<IMedia>> tracks( GenrePtr genre, SortingCriteria sort = SortingCriteria::Default, bool desc = false  ) const = 0;
+    virtual Page<IMedia> tracks( GenrePtr genre, SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation = {} ) const = 0;
     /**
      * @brief albumArtist Returns the album main artist (generally tagged as album-artist)
      */
@@ -62,6 +77,7 @@ public:
      * @param desc
      */
     virtual std::vector<ArtistPtr> artists( bool desc ) const = 0;
+    virtual Page<IArtist> artists( bool desc, uint32_t pageSize, const std::string& continuation = {} ) const = 0;
     /**
      * @brief nbTracks Returns the amount of track in this album.
      * The value is cached, and doesn't require fetching anything.
@@ -38,7 +38,20 @@ public:
     virtual const std::string& name() const = 0;
     virtual const std::string& shortBio() const = 0;
     virtual std::vector<AlbumPtr> albums( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+    virtual Page<IAlbum> albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation = {} ) const = 0;
     virtual std::vector<MediaPtr> media( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+    virtual Page<IMedia> media( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                const std::string& continuation = {} ) const = 0;
+    /**
+     * @brief mediaIds Returns the ids of the media media() would return, in
+     * the same order, without fetching the media themselves.
+     */
+    virtual std::vector<int64_t> mediaIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+    /**
+     * @brief nbMedia Returns the number of media media() would return
+     */
+    virtual uint32_t nbMedia() const = 0;
     virtual const std::string& artworkMrl() const = 0;
     virtual const std::string& musicBrainzId() const = 0;
 };
@@ -37,8 +37,14 @@ public:
     virtual const std::string& name() const = 0;
     virtual uint32_t nbTracks() const = 0;
     virtual std::vector<ArtistPtr> artists( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+    virtual Page<IArtist> artists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                   const std::string& continuation = {} ) const = 0;
     virtual std::vector<MediaPtr> tracks( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+    virtual Page<IMedia> tracks( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation = {} ) const = 0;
     virtual std::vector<AlbumPtr> albums( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+    virtual Page<IAlbum> albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation = {} ) const = 0;
 };
 
 }
@@ -23,10 +23,13 @@
 #ifndef IMEDIALIBRARY_H
 #define IMEDIALIBRARY_H
 
+#include <chrono>
+#include <future>
 #include <vector>
 #include <string>
 
 #include "medialibrary/ILogger.h"
+#include "medialibrary/IReadSnapshot.h"
 #include "Types.h"
 
 namespace medialibrary
@@ -52,6 +55,105 @@ struct SearchAggregate
     std::vector<PlaylistPtr> playlists;
 };
 
+///
+/// \brief Latency distribution of a profiled operation.
+/// All durations are expressed in microseconds. Percentiles are approximated
+/// by the upper bound of the histogram bucket they fall in.
+///
+struct LatencyStats
+{
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p95;
+    uint64_t p99;
+};
+
+struct QueryStats
+{
+    std::string sql;
+    LatencyStats latency;
+    /// Number of rows returned by the query, accross all its executions
+    uint64_t nbRows;
+    /// The EXPLAIN QUERY PLAN output, one line per step. Only filled when
+    /// explicitely requested.
+    std::vector<std::string> queryPlan;
+};
+
+struct BusyStats
+{
+    /// Number of times the database was reported busy
+    uint64_t nbBusy;
+    /// Number of statements or transactions retried after an innocuous error
+    uint64_t nbRetries;
+    /// Number of requests that failed because the busy deadline expired
+    uint64_t nbTimeouts;
+    /// Total time spent waiting for the database to become available, in microseconds
+    uint64_t busyTime;
+};
+
+struct QueryProfile
+{
+    /// Profiled queries, sorted by decreasing total execution time
+    std::vector<QueryStats> queries;
+    /// Time spent waiting for a read context
+    LatencyStats readLockWait;
+    /// Time spent waiting for a write context
+    LatencyStats writeLockWait;
+    /// Busy database statistics. Unlike the other fields, those are
+    /// gathered even when the profiler is disabled.
+    BusyStats busy;
+};
+
+///
+/// \brief Defines how long to wait for a busy database
+/// Waits start at initialDelay, and double after each failed attempt, up to
+/// maxDelay. A random jitter is applied to each wait so that competing
+/// connections don't retry in lockstep. Once deadline expired, the request fails.
+///
+struct BusyPolicy
+{
+    std::chrono::milliseconds initialDelay;
+    std::chrono::milliseconds maxDelay;
+    std::chrono::milliseconds deadline;
+};
+
+///
+/// \brief Statistics of the cache of a single entity type
+///
+struct CacheStats
+{
+    /// The cached entity type
+    std::string entity;
+    /// Number of lookups which found the entity in cache
+    uint64_t nbHits;
+    /// Number of entities which had to be loaded from the database
+    uint64_t nbMisses;
+    /// Number of entities added to the cache
+    uint64_t nbInserts;
+    /// Number of entities evicted to keep the cache within its capacity
+    uint64_t nbEvictions;
+    /// Number of entities currently in cache
+    uint64_t nbEntities;
+    /// Approximate memory used by the cached entities, in bytes
+    uint64_t nbBytes;
+};
+
+///
+/// \brief Selects the entities loaded in cache in the background once the
+/// media library is started, so that the first listings don't have to fetch
+/// them one by one.
+///
+struct PreloadPolicy
+{
+    bool artists;
+    bool albums;
+    bool genres;
+    /// Number of most recently played media to preload
+    uint32_t nbRecentMedia;
+};
+
 enum class SortingCriteria
 {
     /*
@@ -177,6 +279,14 @@ public:
      * @param isIdle true when all background tasks are idle, false otherwise
      */
     virtual void onBackgroundTasksIdleChanged( bool isIdle ) = 0;
+    /**
+     * @brief onCachePreloaded Called once the entities selected by the preload
+     * policy have been loaded in cache.
+     * It has a default implementation, so that existing implementations
+     * don't need to be updated.
+     * @param duration The time it took to load them
+     */
+    virtual void onCachePreloaded( std::chrono::milliseconds ) {}
 };
 
 class IMediaLibrary
@@ -225,9 +335,35 @@ class IMediaLibrary
         virtual MediaPtr media( const std::string& mrl ) const = 0;
         virtual MediaPtr addMedia( const std::string& mrl ) = 0;
         virtual std::vector<MediaPtr> audioFiles( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+        /**
+         * Paginated listings.
+         * Each listing function accepts a page size (0 meaning no limit) and the
+         * continuation token returned as Page::next by the previous call. Pages
+         * are computed from the last returned sort key rather than an offset,
+         * so fetching page N costs the same as fetching the first one.
+         * A token is only valid for the sorting criteria it was generated with.
+         */
+        virtual Page<IMedia> audioFiles( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                         const std::string& continuation = {} ) const = 0;
         virtual std::vector<MediaPtr> videoFiles( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+        virtual Page<IMedia> videoFiles( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                         const std::string& continuation = {} ) const = 0;
+        /**
+         * Count & id only listings.
+         * These run the same filter & ordering as their listing counterpart,
+         * but only read the record ids or their count: no entity is built, so
+         * they are suitable for sizing a view or driving a virtualized list.
+         */
+        virtual uint32_t nbAudioFiles() const = 0;
+        virtual uint32_t nbVideoFiles() const = 0;
+        virtual std::vector<int64_t> audioFileIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+        virtual std::vector<int64_t> videoFileIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
         virtual AlbumPtr album( int64_t id ) const = 0;
         virtual std::vector<AlbumPtr> albums( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+        virtual Page<IAlbum> albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation = {} ) const = 0;
+        virtual uint32_t nbAlbums() const = 0;
+        virtual std::vector<int64_t> albumIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
         virtual ShowPtr show( const std::string& name ) const = 0;
         virtual MoviePtr movie( const std::string& title ) const = 0;
         virtual ArtistPtr artist( int64_t id ) const = 0;
@@ -239,21 +375,103 @@ class IMediaLibrary
          * @param desc If true, the provided sorting criteria will be reversed.
          */
         virtual std::vector<ArtistPtr> artists( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+        virtual Page<IArtist> artists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                       const std::string& continuation = {} ) const = 0;
+        virtual uint32_t nbArtists() const = 0;
+        virtual std::vector<int64_t> artistIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
         /**
          * @brief genres Return the list of music genres
          * @param sort A sorting criteria. So far, this is ignored, and artists are sorted by lexial order
          * @param desc If true, the provided sorting criteria will be reversed.
          */
         virtual std::vector<GenrePtr> genres( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
+        virtual Page<IGenre> genres( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation = {} ) const = 0;
+        virtual uint32_t nbGenres() const = 0;
+        virtual std::vector<int64_t> genreIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
         virtual GenrePtr genre( int64_t id ) const = 0;
         /***
          *  Playlists
          */
         virtual PlaylistPtr createPlaylist( const std::string& name ) = 0;
         virtual std::vector<PlaylistPtr> playlists( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) = 0;
+        virtual Page<IPlaylist> playlists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                           const std::string& continuation = {} ) = 0;
+        virtual uint32_t nbPlaylists() const = 0;
+        virtual std::vector<int64_t> playlistIds( SortingCriteria sort = SortingCriteria::Default, bool desc = false ) const = 0;
         virtual PlaylistPtr playlist( int64_t id ) const = 0;
         virtual bool deletePlaylist( int64_t playlistId ) = 0;
 
+        /**
+         * Query profiling
+         */
+        /**
+         * @brief setQueryProfiling Enables or disables the database queries profiler.
+         * The profiler is disabled by default, and only costs an atomic load
+         * per request until it gets enabled.
+         */
+        virtual void setQueryProfiling( bool enabled ) = 0;
+        /**
+         * @brief queryProfile Returns the statistics gathered since the profiler
+         * was enabled, or since the last call to resetQueryProfile()
+         * @param explain If true, each query plan will be fetched from the database.
+         * This requires compiling each profiled query, and should therefore
+         * only be requested when needed.
+         */
+        virtual QueryProfile queryProfile( bool explain ) const = 0;
+        virtual void resetQueryProfile() = 0;
+        /**
+         * @brief setBusyPolicy Configures how long to wait for a busy database
+         * before failing a request. The default policy starts with 1ms waits,
+         * growing up to 100ms, with a 5 seconds deadline.
+         */
+        virtual void setBusyPolicy( const BusyPolicy& policy ) = 0;
+        /**
+         * @brief setPreloadPolicy Selects the entities to load in cache once
+         * the media library is started. This must be called before start().
+         * By default all artists, albums & genres are preloaded, along with
+         * the 100 most recently played media.
+         */
+        virtual void setPreloadPolicy( const PreloadPolicy& policy ) = 0;
+        /**
+         * @brief cacheStats Returns the statistics of the entity caches, one
+         * element per cached entity type
+         */
+        virtual std::vector<CacheStats> cacheStats() const = 0;
+        /**
+         * @brief setCacheBudget Sets the maximum number of entities kept by
+         * each bounded entity cache. Entities which are still in use are never
+         * evicted, so a cache can temporarily hold more of them.
+         * @param maxEntities The maximum number of entities per cache, or 0 to
+         *                    restore the default budget
+         */
+        virtual void setCacheBudget( uint32_t maxEntities ) = 0;
+        /**
+         * @brief setCacheBudget Sets the budget of a single bounded entity
+         * cache, which then ignores the budget common to all caches, unless
+         * maxEntities is 0.
+         * @param entity The cached entity type, as reported by cacheStats()
+         * @param maxEntities The maximum number of cached entities, or 0 to
+         *                    use the common budget
+         * @param maxBytes The approximate maximum memory used by the cached
+         *                 entities, or 0 for no limit
+         */
+        virtual void setCacheBudget( const std::string& entity, uint32_t maxEntities,
+                                     uint64_t maxBytes ) = 0;
+        /**
+         * @brief setCacheStatsLogging Logs the entity caches statistics every
+         * interval, with an info level. A zero interval disables it, which is
+         * the default.
+         */
+        virtual void setCacheStatsLogging( std::chrono::seconds interval ) = 0;
+        /**
+         * @brief setEagerLoading Loads the files & album track, show episode or
+         * movie of the listed media along with the media themselves, using a
+         * few batched requests per listing, instead of one request per media
+         * when accessing them. This is disabled by default.
+         */
+        virtual void setEagerLoading( bool enabled ) = 0;
+
         /**
          * History
          */
@@ -280,6 +498,47 @@ class IMediaLibrary
         virtual std::vector<ArtistPtr> searchArtists( const std::string& name ) const = 0;
         virtual SearchAggregate search( const std::string& pattern ) const = 0;
 
+        /**
+         * Asynchronous requests
+         * These run their synchronous counterpart on an internal pool of reader
+         * threads, so that the calling thread doesn't have to wait for the database.
+         * When a non empty key is provided, queuing a request drops any pending
+         * request with the same key, so that only the latest one gets executed.
+         * The future of a dropped request throws a std::future_error, with the
+         * std::future_errc::broken_promise error code.
+         */
+        virtual std::future<MediaPtr> mediaAsync( int64_t mediaId ) const = 0;
+        virtual std::future<std::vector<MediaPtr>> audioFilesAsync( SortingCriteria sort, bool desc,
+                                                                    const std::string& key = {} ) const = 0;
+        virtual std::future<std::vector<MediaPtr>> videoFilesAsync( SortingCriteria sort, bool desc,
+                                                                    const std::string& key = {} ) const = 0;
+        virtual std::future<std::vector<AlbumPtr>> albumsAsync( SortingCriteria sort, bool desc,
+                                                                const std::string& key = {} ) const = 0;
+        virtual std::future<std::vector<ArtistPtr>> artistsAsync( SortingCriteria sort, bool desc,
+                                                                  const std::string& key = {} ) const = 0;
+        virtual std::future<std::vector<GenrePtr>> genresAsync( SortingCriteria sort, bool desc,
+                                                                const std::string& key = {} ) const = 0;
+        virtual std::future<std::vector<PlaylistPtr>> playlistsAsync( SortingCriteria sort, bool desc,
+                                                                      const std::string& key = {} ) = 0;
+        virtual std::future<MediaSearchAggregate> searchMediaAsync( const std::string& pattern,
+                                                                    const std::string& key = {} ) const = 0;
+        virtual std::future<SearchAggregate> searchAsync( const std::string& pattern,
+                                                          const std::string& key = {} ) const = 0;
+        /**
+         * @brief cancelAsync Drops the pending asynchronous request associated with the provided key
+         * A request that already started is left to complete.
+         */
+        virtual void cancelAsync( const std::string& key ) const = 0;
+        /**
+         * @brief acquireReadSnapshot Returns a consistent view of the database
+         * for the calling thread, see IReadSnapshot.
+         * This is meant to group the requests required to display a screen, so
+         * that a concurrent update can't interleave, and so they only acquire
+         * a single read context. Snapshots should be short lived: when the
+         * database doesn't support WAL journaling, holding one blocks writers.
+         */
+        virtual ReadSnapshotPtr acquireReadSnapshot() const = 0;
+
         /**
          * @brief discover Launch a discovery on the provided entry point.
          * The actuall discovery will run asynchronously, meaning this method will immediatly return.
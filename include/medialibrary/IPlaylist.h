@@ -38,6 +38,7 @@ public:
     virtual bool setName( const std::string& name ) = 0;
     virtual unsigned int creationDate() const = 0;
     virtual std::vector<MediaPtr> media() const = 0;
+    virtual Page<IMedia> media( uint32_t pageSize, const std::string& continuation = {} ) const = 0;
     ///
     /// \brief append Appends a media to a playlist
     /// The media will be the last element of a subsequent call to media()
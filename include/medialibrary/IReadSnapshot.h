@@ -20,21 +20,32 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
-#if HAVE_CONFIG_H
-# include "config.h"
-#endif
-
-#include "SqliteTools.h"
+#pragma once
 
 namespace medialibrary
 {
 
-namespace sqlite
+///
+/// \brief The IReadSnapshot class represents a consistent view of the database
+///
+/// As long as a snapshot is alive, all the reads performed by the thread which
+/// acquired it see the database as it was when the snapshot was acquired, and
+/// share a single read context. Changes committed by other threads in the
+/// meantime only become visible once the snapshot is released.
+///
+/// A snapshot is bound to the thread which acquired it, and must be released
+/// (or destroyed) on that same thread. Entities which were already loaded
+/// before may still reflect a more recent state of the database.
+///
+class IReadSnapshot
 {
-std::unordered_map<SqliteConnection::Handle,
-                    std::unordered_map<std::string, Statement::CachedStmtPtr>> Statement::StatementsCache;
-
-compat::Mutex Statement::StatementsCacheLock;
-}
+public:
+    virtual ~IReadSnapshot() = default;
+    ///
+    /// \brief release Ends the snapshot before its destruction
+    /// Calling this more than once is harmless.
+    ///
+    virtual void release() = 0;
+};
 
 }
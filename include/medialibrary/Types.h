@@ -23,6 +23,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace medialibrary
 {
@@ -47,6 +49,7 @@ class IMediaLibraryCb;
 class IDeviceLister;
 class IDeviceListerCb;
 class IFolder;
+class IReadSnapshot;
 
 using AlbumPtr = std::shared_ptr<IAlbum>;
 using AlbumTrackPtr = std::shared_ptr<IAlbumTrack>;
@@ -64,6 +67,19 @@ using ShowPtr = std::shared_ptr<IShow>;
 using VideoTrackPtr = std::shared_ptr<IVideoTrack>;
 using DeviceListerPtr = std::shared_ptr<IDeviceLister>;
 using FolderPtr = std::shared_ptr<IFolder>;
+using ReadSnapshotPtr = std::unique_ptr<IReadSnapshot>;
+
+///
+/// \brief A page of a paginated listing
+///
+template <typename T>
+struct Page
+{
+    std::vector<std::shared_ptr<T>> items;
+    /// Opaque token to provide to the listing function to fetch the next page.
+    /// This is empty when there are no more results.
+    std::string next;
+};
 
 }
 
@@ -110,8 +110,9 @@ bool Album::setReleaseYear( unsigned int date, bool force )
             date = 0;
         }
     }
-    static const std::string req = "UPDATE " + policy::AlbumTable::Name
-            + " SET release_year = ? WHERE id_album = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::AlbumTable::Name
+            + " SET release_year = ? WHERE id_album = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, date, m_id ) == false )
         return false;
     m_releaseYear = date;
@@ -125,8 +126,9 @@ const std::string& Album::shortSummary() const
 
 bool Album::setShortSummary( const std::string& summary )
 {
-    static const std::string req = "UPDATE " + policy::AlbumTable::Name
-            + " SET short_summary = ? WHERE id_album = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::AlbumTable::Name
+            + " SET short_summary = ? WHERE id_album = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, summary, m_id ) == false )
         return false;
     m_shortSummary = summary;
@@ -140,94 +142,104 @@ const std::string& Album::artworkMrl() const
 
 bool Album::setArtworkMrl( const std::string& artworkMrl )
 {
-    static const std::string req = "UPDATE " + policy::AlbumTable::Name
-            + " SET artwork_mrl = ? WHERE id_album = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::AlbumTable::Name
+            + " SET artwork_mrl = ? WHERE id_album = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, artworkMrl, m_id ) == false )
         return false;
     m_artworkMrl = artworkMrl;
     return true;
 }
 
-std::string Album::orderTracksBy( SortingCriteria sort, bool desc )
+std::vector<sqlite::KeysetQuery::Key> Album::tracksSortKeys( SortingCriteria sort, bool desc )
 {
-    std::string req = " ORDER BY ";
     switch ( sort )
     {
     case SortingCriteria::Alpha:
-        req += "med.title";
-        break;
+        return { { "med.title", desc } };
     case SortingCriteria::Duration:
-        req += "med.duration";
-        break;
+        return { { "med.duration", desc } };
     case SortingCriteria::ReleaseDate:
-        req += "med.release_date";
-        break;
+        return { { "med.release_date", desc } };
     default:
-        if ( desc == true )
-            req += "att.disc_number DESC, att.track_number DESC, med.filename";
-        else
-            req += "att.disc_number, att.track_number, med.filename";
-        break;
+        return { { "att.disc_number", desc }, { "att.track_number", desc }, { "med.filename", desc } };
     }
-
-    if ( desc == true )
-        req += " DESC";
-    return req;
 }
 
-std::string Album::orderBy( SortingCriteria sort, bool desc )
+std::vector<sqlite::KeysetQuery::Key> Album::sortKeys( SortingCriteria sort, bool desc, const std::string& prefix )
 {
-    std::string req = " ORDER BY ";
     switch ( sort )
     {
     case SortingCriteria::ReleaseDate:
-        if ( desc == true )
-            req += "release_year DESC, title";
-        else
-            req += "release_year, title";
-        break;
+        return { { prefix + "release_year", desc }, { prefix + "title", false } };
     case SortingCriteria::Duration:
-        req += "duration";
-        if ( desc == true )
-            req += " DESC";
-        break;
+        return { { prefix + "duration", desc } };
     default:
-        req += "title";
-        if ( desc == true )
-            req += " DESC";
-        break;
+        return { { prefix + "title", desc } };
     }
-    return req;
 }
 
 std::vector<MediaPtr> Album::tracks( SortingCriteria sort, bool desc ) const
+{
+    return tracks( sort, desc, 0, {} ).items;
+}
+
+const sqlite::QueryTable& Album::tracksTable()
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        return sqlite::KeysetQuery( "med.*",
+                policy::MediaTable::Name + " med "
+                    " INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.media_id = med.id_media ",
+                "att.album_id = ? AND med.is_present = 1",
+                tracksSortKeys( sort, desc ), "med.id_media", sort, desc );
+    });
+    return table;
+}
+
+Page<IMedia> Album::tracks( SortingCriteria sort, bool desc, uint32_t pageSize,
+                            const std::string& continuation ) const
 {
     // This doesn't return the cached version, because it would be fairly complicated, if not impossible or
     // counter productive, to maintain a cache that respects all orderings.
-    std::string req = "SELECT med.* FROM " + policy::MediaTable::Name + " med "
-        " INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.media_id = med.id_media "
-        " WHERE att.album_id = ? AND med.is_present = 1";
-    req += orderTracksBy( sort, desc );
-    return Media::fetchAll<IMedia>( m_ml, req, m_id );
+    return Media::fetchPage<IMedia>( m_ml, tracksTable(), sort, desc, pageSize, continuation, m_id );
+}
+
+std::vector<int64_t> Album::trackIds( SortingCriteria sort, bool desc ) const
+{
+    return Media::fetchIds( m_ml, tracksTable(), sort, desc, m_id );
 }
 
 std::vector<MediaPtr> Album::tracks( GenrePtr genre, SortingCriteria sort, bool desc ) const
+{
+    return tracks( std::move( genre ), sort, desc, 0, {} ).items;
+}
+
+Page<IMedia> Album::tracks( GenrePtr genre, SortingCriteria sort, bool desc, uint32_t pageSize,
+                            const std::string& continuation ) const
 {
     if ( genre == nullptr )
         return {};
-    std::string req = "SELECT med.* FROM " + policy::MediaTable::Name + " med "
-            " INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.media_id = med.id_media "
-            " WHERE att.album_id = ? AND med.is_present = 1"
-            " AND genre_id = ?";
-    req += orderTracksBy( sort, desc );
-    return Media::fetchAll<IMedia>( m_ml, req, m_id, genre->id() );
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        return sqlite::KeysetQuery( "med.*",
+                policy::MediaTable::Name + " med "
+                    " INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.media_id = med.id_media ",
+                "att.album_id = ? AND med.is_present = 1 AND genre_id = ?",
+                tracksSortKeys( sort, desc ), "med.id_media", sort, desc );
+    });
+    return Media::fetchPage<IMedia>( m_ml, table, sort, desc, pageSize, continuation,
+                                     m_id, genre->id() );
 }
 
 std::vector<MediaPtr> Album::cachedTracks() const
 {
-    auto lock = m_tracks.lock();
     if ( m_tracks.isCached() == false )
-        m_tracks = tracks( SortingCriteria::Default, false );
+    {
+        m_tracks.load( [this]() {
+            return tracks( SortingCriteria::Default, false );
+        });
+    }
+    // addTrack appends to the cached tracks, so copy them with the lock held
+    auto lock = m_tracks.lock();
     return m_tracks.get();
 }
 
@@ -255,6 +267,8 @@ std::shared_ptr<AlbumTrack> Album::addTrack( std::shared_ptr<Media> media, unsig
         m_tracks.markCached();
     if ( m_tracks.isCached() == true )
         m_tracks.get().push_back( media );
+    else
+        m_tracks.markModified();
     return track;
 }
 
@@ -272,9 +286,8 @@ ArtistPtr Album::albumArtist() const
 {
     if ( m_artistId == 0 )
         return nullptr;
-    auto lock = m_albumArtist.lock();
     if ( m_albumArtist.isCached() == false )
-        m_albumArtist = Artist::fetch( m_ml, m_artistId );
+        return m_albumArtist.initialize( Artist::fetch( m_ml, m_artistId ) );
     return m_albumArtist.get();
 }
 
@@ -284,8 +297,9 @@ bool Album::setAlbumArtist( std::shared_ptr<Artist> artist )
         return true;
     if ( artist->id() == 0 )
         return false;
-    static const std::string req = "UPDATE " + policy::AlbumTable::Name + " SET "
-            "artist_id = ? WHERE id_album = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::AlbumTable::Name + " SET "
+            "artist_id = ? WHERE id_album = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, artist->id(), m_id ) == false )
         return false;
     if ( m_artistId != 0 )
@@ -297,25 +311,35 @@ bool Album::setAlbumArtist( std::shared_ptr<Artist> artist )
     m_artistId = artist->id();
     m_albumArtist = artist;
     artist->updateNbAlbum( 1 );
-    static const std::string ftsReq = "UPDATE " + policy::AlbumTable::Name + "Fts SET "
-            " artist = ? WHERE rowid = ?";
+    static const auto ftsReq = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::AlbumTable::Name + "Fts SET "
+            " artist = ? WHERE rowid = ?" );
     sqlite::Tools::executeUpdate( m_ml->getConn(), ftsReq, artist->name(), m_id );
     return true;
 }
 
 std::vector<ArtistPtr> Album::artists( bool desc ) const
 {
-    std::string req = "SELECT art.* FROM " + policy::ArtistTable::Name + " art "
-            "INNER JOIN AlbumArtistRelation aar ON aar.artist_id = art.id_artist "
-            "WHERE aar.album_id = ? ORDER BY art.name";
-    if ( desc == true )
-        req += " DESC";
-    return Artist::fetchAll<IArtist>( m_ml, req, m_id );
+    return artists( desc, 0, {} ).items;
+}
+
+Page<IArtist> Album::artists( bool desc, uint32_t pageSize, const std::string& continuation ) const
+{
+    static const sqlite::QueryTable table( []( SortingCriteria, bool desc ) {
+        return sqlite::KeysetQuery( "art.*",
+                policy::ArtistTable::Name + " art "
+                    "INNER JOIN AlbumArtistRelation aar ON aar.artist_id = art.id_artist",
+                "aar.album_id = ?", { { "art.name", desc } }, "art.id_artist",
+                SortingCriteria::Default, desc );
+    });
+    return Artist::fetchPage<IArtist>( m_ml, table, SortingCriteria::Default, desc,
+                                       pageSize, continuation, m_id );
 }
 
 bool Album::addArtist( std::shared_ptr<Artist> artist )
 {
-    static const std::string req = "INSERT OR IGNORE INTO AlbumArtistRelation VALUES(?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT OR IGNORE INTO AlbumArtistRelation VALUES(?, ?)" );
     if ( m_id == 0 || artist->id() == 0 )
     {
         LOG_ERROR("Both artist & album need to be inserted in database before being linked together" );
@@ -326,11 +350,17 @@ bool Album::addArtist( std::shared_ptr<Artist> artist )
 
 bool Album::removeArtist(Artist* artist)
 {
-    static const std::string req = "DELETE FROM AlbumArtistRelation WHERE album_id = ? "
-            "AND id_artist = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "DELETE FROM AlbumArtistRelation WHERE album_id = ? "
+            "AND id_artist = ?" );
     return sqlite::Tools::executeDelete( m_ml->getConn(), req, m_id, artist->id() );
 }
 
+size_t Album::dynamicMemoryUsage() const
+{
+    return m_title.capacity() + m_shortSummary.capacity() + m_artworkMrl.capacity();
+}
+
 bool Album::createTable(DBConnection dbConnection )
 {
     const std::string req = "CREATE TABLE IF NOT EXISTS " +
@@ -370,6 +400,14 @@ bool Album::createTable(DBConnection dbConnection )
             sqlite::Tools::executeRequest( dbConnection, indexReq );
 }
 
+bool Album::createIndexes( DBConnection dbConnection )
+{
+    // Used to find the album a track belongs to, for each parsed track
+    const std::string titleIndexReq = "CREATE INDEX IF NOT EXISTS album_title_idx ON " +
+            policy::AlbumTable::Name + "(title)";
+    return sqlite::Tools::executeRequest( dbConnection, titleIndexReq );
+}
+
 bool Album::createTriggers(DBConnection dbConnection)
 {
     static const std::string triggerReq = "CREATE TRIGGER IF NOT EXISTS is_album_present AFTER UPDATE OF "
@@ -422,8 +460,9 @@ bool Album::createTriggers(DBConnection dbConnection)
 std::shared_ptr<Album> Album::create( MediaLibraryPtr ml, const std::string& title, const std::string& artworkMrl )
 {
     auto album = std::make_shared<Album>( ml, title, artworkMrl );
-    static const std::string req = "INSERT INTO " + policy::AlbumTable::Name +
-            "(id_album, title, artwork_mrl) VALUES(NULL, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::AlbumTable::Name +
+            "(id_album, title, artwork_mrl) VALUES(NULL, ?, ?)" );
     if ( insert( ml, album, req, title, artworkMrl ) == false )
         return nullptr;
     return album;
@@ -432,8 +471,9 @@ std::shared_ptr<Album> Album::create( MediaLibraryPtr ml, const std::string& tit
 std::shared_ptr<Album> Album::createUnknownAlbum( MediaLibraryPtr ml, const Artist* artist )
 {
     auto album = std::make_shared<Album>( ml, artist );
-    static const std::string req = "INSERT INTO " + policy::AlbumTable::Name +
-            "(id_album, artist_id) VALUES(NULL, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::AlbumTable::Name +
+            "(id_album, artist_id) VALUES(NULL, ?)" );
     if ( insert( ml, album, req, artist->id() ) == false )
         return nullptr;
     return album;
@@ -441,64 +481,98 @@ std::shared_ptr<Album> Album::createUnknownAlbum( MediaLibraryPtr ml, const Arti
 
 std::vector<AlbumPtr> Album::search( MediaLibraryPtr ml, const std::string& pattern )
 {
-    static const std::string req = "SELECT * FROM " + policy::AlbumTable::Name + " WHERE id_album IN "
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::AlbumTable::Name + " WHERE id_album IN "
             "(SELECT rowid FROM " + policy::AlbumTable::Name + "Fts WHERE " +
             policy::AlbumTable::Name + "Fts MATCH '*' || ? || '*')"
-            "AND is_present = 1";
+            "AND is_present = 1" );
     return fetchAll<IAlbum>( ml, req, pattern );
 }
 
 std::vector<AlbumPtr> Album::fromArtist( MediaLibraryPtr ml, int64_t artistId, SortingCriteria sort, bool desc )
 {
-    std::string req = "SELECT * FROM " + policy::AlbumTable::Name + " alb "
-                    "WHERE artist_id = ? AND is_present=1 ORDER BY ";
-    switch ( sort )
-    {
-    case SortingCriteria::Alpha:
-        req += "title";
-        if ( desc == true )
-            req += " DESC";
-        break;
-    default:
-        // When listing albums of an artist, default order is by descending year (with album title
-        // discrimination in case 2+ albums went out the same year)
-        // This leads to DESC being used for "non-desc" case
-        if ( desc == true )
-            req += "release_year, title";
-        else
-            req += "release_year DESC, title";
-        break;
-    }
+    return fromArtist( ml, artistId, sort, desc, 0, {} ).items;
+}
 
-    return fetchAll<IAlbum>( ml, req, artistId );
+Page<IAlbum> Album::fromArtist( MediaLibraryPtr ml, int64_t artistId, SortingCriteria sort, bool desc,
+                                uint32_t pageSize, const std::string& continuation )
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        std::vector<sqlite::KeysetQuery::Key> keys;
+        switch ( sort )
+        {
+        case SortingCriteria::Alpha:
+            keys = { { "title", desc } };
+            break;
+        default:
+            // When listing albums of an artist, default order is by descending year (with album title
+            // discrimination in case 2+ albums went out the same year)
+            // This leads to DESC being used for "non-desc" case
+            keys = { { "release_year", !desc }, { "title", false } };
+            break;
+        }
+        return sqlite::KeysetQuery( "*", policy::AlbumTable::Name + " alb",
+                                    "artist_id = ? AND is_present=1",
+                                    std::move( keys ), "id_album", sort, desc );
+    });
+    return fetchPage<IAlbum>( ml, table, sort, desc, pageSize, continuation, artistId );
 }
 
 std::vector<AlbumPtr> Album::fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc)
 {
-    std::string req = "SELECT a.* FROM " + policy::AlbumTable::Name + " a "
-            "INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.album_id = a.id_album "
-            "WHERE att.genre_id = ? GROUP BY att.album_id";
-    req += orderBy( sort, desc );
-    return fetchAll<IAlbum>( ml, req, genreId );
+    return fromGenre( ml, genreId, sort, desc, 0, {} ).items;
+}
+
+Page<IAlbum> Album::fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc,
+                               uint32_t pageSize, const std::string& continuation )
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        sqlite::KeysetQuery query( "a.*",
+                policy::AlbumTable::Name + " a "
+                    "INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.album_id = a.id_album",
+                "att.genre_id = ?", sortKeys( sort, desc, "a." ), "a.id_album", sort, desc );
+        query.groupBy( "att.album_id" );
+        return query;
+    });
+    return fetchPage<IAlbum>( ml, table, sort, desc, pageSize, continuation, genreId );
 }
 
 std::vector<AlbumPtr> Album::listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc )
 {
-    if ( sort == SortingCriteria::Artist )
-    {
-        std::string req = "SELECT alb.* FROM " + policy::AlbumTable::Name + " alb "
-                "INNER JOIN " + policy::ArtistTable::Name + " art ON alb.artist_id = art.id_artist "
-                "WHERE alb.is_present = 1 "
-                "ORDER BY art.name ";
-        if ( desc == true )
-            req += "DESC ";
-        req += ", alb.title";
-        return fetchAll<IAlbum>( ml, req );
-    }
-    std::string req = "SELECT * FROM " + policy::AlbumTable::Name +
-                    " WHERE is_present=1";
-    req += orderBy( sort, desc );
-    return fetchAll<IAlbum>( ml, req );
+    return listAll( ml, sort, desc, 0, {} ).items;
+}
+
+const sqlite::QueryTable& Album::listAllTable()
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        if ( sort == SortingCriteria::Artist )
+        {
+            return sqlite::KeysetQuery( "alb.*",
+                    policy::AlbumTable::Name + " alb "
+                        "INNER JOIN " + policy::ArtistTable::Name + " art ON alb.artist_id = art.id_artist",
+                    "alb.is_present = 1", { { "art.name", desc }, { "alb.title", false } },
+                    "alb.id_album", sort, desc );
+        }
+        return sqlite::KeysetQuery( "*", policy::AlbumTable::Name, "is_present=1",
+                                    sortKeys( sort, desc, "" ), "id_album", sort, desc );
+    });
+    return table;
+}
+
+Page<IAlbum> Album::listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                             uint32_t pageSize, const std::string& continuation )
+{
+    return fetchPage<IAlbum>( ml, listAllTable(), sort, desc, pageSize, continuation );
+}
+
+std::vector<int64_t> Album::listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc )
+{
+    return fetchIds( ml, listAllTable(), sort, desc );
+}
+
+uint32_t Album::count( MediaLibraryPtr ml )
+{
+    return fetchCount( ml, listAllTable() );
 }
 
 }
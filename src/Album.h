@@ -75,7 +75,12 @@ class Album : public IAlbum, public DatabaseHelpers<Album, policy::AlbumTable>
         virtual const std::string& artworkMrl() const override;
         bool setArtworkMrl( const std::string& artworkMrl );
         virtual std::vector<MediaPtr> tracks( SortingCriteria sort, bool desc ) const override;
+        virtual Page<IMedia> tracks( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation ) const override;
+        virtual std::vector<int64_t> trackIds( SortingCriteria sort, bool desc ) const override;
         virtual std::vector<MediaPtr> tracks( GenrePtr genre, SortingCriteria sort, bool desc ) const override;
+        virtual Page<IMedia> tracks( GenrePtr genre, SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation ) const override;
         ///
         /// \brief cachedTracks Returns a cached list of tracks
         /// This has no warranty of ordering, validity, or anything else.
@@ -95,10 +100,15 @@ class Album : public IAlbum, public DatabaseHelpers<Album, policy::AlbumTable>
         virtual ArtistPtr albumArtist() const override;
         bool setAlbumArtist( std::shared_ptr<Artist> artist );
         virtual std::vector<ArtistPtr> artists(bool desc) const override;
+        virtual Page<IArtist> artists( bool desc, uint32_t pageSize,
+                                       const std::string& continuation ) const override;
         bool addArtist( std::shared_ptr<Artist> artist );
         bool removeArtist( Artist* artist );
 
+        size_t dynamicMemoryUsage() const;
+
         static bool createTable( DBConnection dbConnection );
+        static bool createIndexes( DBConnection dbConnection );
         static bool createTriggers( DBConnection dbConnection );
         static std::shared_ptr<Album> create( MediaLibraryPtr ml, const std::string& title, const std::string& artworkMrl );
         static std::shared_ptr<Album> createUnknownAlbum( MediaLibraryPtr ml, const Artist* artist );
@@ -109,12 +119,23 @@ class Album : public IAlbum, public DatabaseHelpers<Album, policy::AlbumTable>
         ///
         static std::vector<AlbumPtr> search( MediaLibraryPtr ml, const std::string& pattern );
         static std::vector<AlbumPtr> fromArtist( MediaLibraryPtr ml, int64_t artistId, SortingCriteria sort, bool desc );
+        static Page<IAlbum> fromArtist( MediaLibraryPtr ml, int64_t artistId, SortingCriteria sort, bool desc,
+                                        uint32_t pageSize, const std::string& continuation );
         static std::vector<AlbumPtr> fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc );
+        static Page<IAlbum> fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc,
+                                       uint32_t pageSize, const std::string& continuation );
         static std::vector<AlbumPtr> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+        static Page<IAlbum> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                                     uint32_t pageSize, const std::string& continuation );
+        static std::vector<int64_t> listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+        static uint32_t count( MediaLibraryPtr ml );
 
     private:
-        static std::string orderTracksBy( SortingCriteria sort, bool desc );
-        static std::string orderBy( SortingCriteria sort, bool desc );
+        static const sqlite::QueryTable& listAllTable();
+        static const sqlite::QueryTable& tracksTable();
+        static std::vector<sqlite::KeysetQuery::Key> tracksSortKeys( SortingCriteria sort, bool desc );
+        static std::vector<sqlite::KeysetQuery::Key> sortKeys( SortingCriteria sort, bool desc,
+                                                               const std::string& prefix );
     protected:
         MediaLibraryPtr m_ml;
         int64_t m_id;
@@ -73,22 +73,25 @@ int64_t AlbumTrack::id() const
     return m_id;
 }
 
+int64_t AlbumTrack::mediaId() const
+{
+    return m_mediaId;
+}
+
 ArtistPtr AlbumTrack::artist() const
 {
     if ( m_artistId == 0 )
         return nullptr;
-    auto lock = m_artist.lock();
     if ( m_artist.isCached() == false )
-    {
-        m_artist = Artist::fetch( m_ml, m_artistId );
-    }
+        return m_artist.initialize( Artist::fetch( m_ml, m_artistId ) );
     return m_artist.get();
 }
 
 bool AlbumTrack::setArtist( std::shared_ptr<Artist> artist )
 {
-    static const std::string req = "UPDATE " + policy::AlbumTrackTable::Name +
-            " SET artist_id = ? WHERE id_track = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::AlbumTrackTable::Name +
+            " SET artist_id = ? WHERE id_track = ?" );
     if ( artist->id() == m_artistId )
         return true;
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, artist->id(), m_id ) == false )
@@ -131,14 +134,28 @@ bool AlbumTrack::createTable( DBConnection dbConnection )
             sqlite::Tools::executeRequest( dbConnection, indexReq );
 }
 
+bool AlbumTrack::createIndexes( DBConnection dbConnection )
+{
+    // The composite index can't be used when looking up by album or genre,
+    // since those aren't its leftmost columns. The album index also covers
+    // the default tracks ordering.
+    const std::string albumIndexReq = "CREATE INDEX IF NOT EXISTS album_track_album_idx ON " +
+            policy::AlbumTrackTable::Name + "(album_id, disc_number, track_number, media_id)";
+    const std::string genreIndexReq = "CREATE INDEX IF NOT EXISTS album_track_genre_idx ON " +
+            policy::AlbumTrackTable::Name + "(genre_id, media_id)";
+    return sqlite::Tools::executeRequest( dbConnection, albumIndexReq ) &&
+            sqlite::Tools::executeRequest( dbConnection, genreIndexReq );
+}
+
 std::shared_ptr<AlbumTrack> AlbumTrack::create( MediaLibraryPtr ml, int64_t albumId,
                                                 std::shared_ptr<Media> media, unsigned int trackNb,
                                                 unsigned int discNumber, int64_t artistId, int64_t genreId,
                                                 int64_t duration )
 {
     auto self = std::make_shared<AlbumTrack>( ml, media->id(), artistId, genreId, trackNb, albumId, discNumber );
-    static const std::string req = "INSERT INTO " + policy::AlbumTrackTable::Name
-            + "(media_id, duration, artist_id, genre_id, track_number, album_id, disc_number) VALUES(?, ?, ?, ?, ?, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::AlbumTrackTable::Name
+            + "(media_id, duration, artist_id, genre_id, track_number, album_id, disc_number) VALUES(?, ?, ?, ?, ?, ?, ?)" );
     if ( insert( ml, self, req, media->id(), duration >= 0 ? duration : 0, sqlite::ForeignKey( artistId ),
                  sqlite::ForeignKey( genreId ), trackNb, albumId, discNumber ) == false )
         return nullptr;
@@ -148,50 +165,53 @@ std::shared_ptr<AlbumTrack> AlbumTrack::create( MediaLibraryPtr ml, int64_t albu
 
 AlbumTrackPtr AlbumTrack::fromMedia( MediaLibraryPtr ml, int64_t mediaId )
 {
-    static const std::string req = "SELECT * FROM " + policy::AlbumTrackTable::Name +
-            " WHERE media_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::AlbumTrackTable::Name +
+            " WHERE media_id = ?" );
     return fetch( ml, req, mediaId );
 }
 
 std::vector<MediaPtr> AlbumTrack::fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc )
 {
-    std::string req = "SELECT m.* FROM " + policy::MediaTable::Name + " m"
-            " INNER JOIN " + policy::AlbumTrackTable::Name + " t ON m.id_media = t.media_id"
-            " WHERE t.genre_id = ? ORDER BY ";
-    switch ( sort )
-    {
-    case SortingCriteria::Duration:
-        req += "m.duration";
-        break;
-    case SortingCriteria::InsertionDate:
-        req += "m.insertion_date";
-        break;
-    case SortingCriteria::ReleaseDate:
-        req += "m.release_date";
-        break;
-    case SortingCriteria::Alpha:
-        req += "m.title";
-        break;
-    default:
-        if ( desc == true )
-            req += "t.artist_id DESC, t.album_id DESC, t.disc_number DESC, t.track_number DESC, m.filename";
-        else
-            req += "t.artist_id, t.album_id, t.disc_number, t.track_number, m.filename";
-        break;
-    }
+    return fromGenre( ml, genreId, sort, desc, 0, {} ).items;
+}
 
-    if ( desc == true )
-        req += " DESC";
-    return Media::fetchAll<IMedia>( ml, req, genreId );
+Page<IMedia> AlbumTrack::fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc,
+                                    uint32_t pageSize, const std::string& continuation )
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        std::vector<sqlite::KeysetQuery::Key> keys;
+        switch ( sort )
+        {
+        case SortingCriteria::Duration:
+            keys = { { "m.duration", desc } };
+            break;
+        case SortingCriteria::InsertionDate:
+            keys = { { "m.insertion_date", desc } };
+            break;
+        case SortingCriteria::ReleaseDate:
+            keys = { { "m.release_date", desc } };
+            break;
+        case SortingCriteria::Alpha:
+            keys = { { "m.title", desc } };
+            break;
+        default:
+            keys = { { "t.artist_id", desc }, { "t.album_id", desc }, { "t.disc_number", desc },
+                     { "t.track_number", desc }, { "m.filename", desc } };
+            break;
+        }
+        return sqlite::KeysetQuery( "m.*",
+                policy::MediaTable::Name + " m"
+                    " INNER JOIN " + policy::AlbumTrackTable::Name + " t ON m.id_media = t.media_id",
+                "t.genre_id = ?", std::move( keys ), "m.id_media", sort, desc );
+    });
+    return Media::fetchPage<IMedia>( ml, table, sort, desc, pageSize, continuation, genreId );
 }
 
 GenrePtr AlbumTrack::genre()
 {
-    auto l = m_genre.lock();
     if ( m_genre.isCached() == false )
-    {
-        m_genre = Genre::fetch( m_ml, m_genreId );
-    }
+        return m_genre.initialize( Genre::fetch( m_ml, m_genreId ) );
     return m_genre.get();
 }
 
@@ -199,24 +219,18 @@ bool AlbumTrack::setGenre( std::shared_ptr<Genre> genre )
 {
     // We need to fetch the old genre entity now, in case it gets deleted through
     // the nbTracks reaching 0 trigger.
-    if ( m_genreId > 0 )
-    {
-        auto l = m_genre.lock();
-        if ( m_genre.isCached() == false )
-            m_genre = Genre::fetch( m_ml, m_genreId );
-    }
-    static const std::string req = "UPDATE " + policy::AlbumTrackTable::Name
-            + " SET genre_id = ? WHERE id_track = ?";
+    if ( m_genreId > 0 && m_genre.isCached() == false )
+        m_genre.initialize( Genre::fetch( m_ml, m_genreId ) );
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::AlbumTrackTable::Name
+            + " SET genre_id = ? WHERE id_track = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req,
                                        sqlite::ForeignKey( genre != nullptr ? genre->id() : 0 ),
                                        m_id ) == false )
         return false;
-    {
-        auto l = m_genre.lock();
-        if ( m_genreId > 0 )
-            m_genre.get()->updateCachedNbTracks( -1 );
-        m_genre = genre;
-    }
+    if ( m_genreId > 0 )
+        m_genre.get()->updateCachedNbTracks( -1 );
+    m_genre = genre;
     if ( genre != nullptr )
     {
         genre->updateCachedNbTracks( 1 );
@@ -237,25 +251,48 @@ unsigned int AlbumTrack::discNumber() const
     return m_discNumber;
 }
 
+void AlbumTrack::prefetchRelations( MediaLibraryPtr ml, const std::vector<std::shared_ptr<AlbumTrack>>& tracks )
+{
+    std::vector<AlbumTrack*> missingArtist;
+    std::vector<AlbumTrack*> missingAlbum;
+    std::vector<int64_t> artistIds;
+    std::vector<int64_t> albumIds;
+    for ( const auto& t : tracks )
+    {
+        if ( t->m_artistId != 0 && t->m_artist.isCached() == false )
+        {
+            missingArtist.push_back( t.get() );
+            artistIds.push_back( t->m_artistId );
+        }
+        if ( t->m_albumId != 0 && t->m_album.isCached() == false )
+        {
+            missingAlbum.push_back( t.get() );
+            albumIds.push_back( t->m_albumId );
+        }
+    }
+    auto artists = Artist::fetchByIds( ml, artistIds );
+    for ( auto i = 0u; i < missingArtist.size(); ++i )
+        missingArtist[i]->m_artist.initialize( artists[i] );
+    auto albums = Album::fetchByIds( ml, albumIds );
+    for ( auto i = 0u; i < missingAlbum.size(); ++i )
+        missingAlbum[i]->m_album.initialize( albums[i] );
+}
+
 std::shared_ptr<IAlbum> AlbumTrack::album()
 {
     // "Fail" early in case there's no album to fetch
     if ( m_albumId == 0 )
         return nullptr;
 
-    auto lock = m_album.lock();
     if ( m_album.isCached() == false )
-        m_album = Album::fetch( m_ml, m_albumId );
+        return m_album.initialize( Album::fetch( m_ml, m_albumId ) ).lock();
     return m_album.get().lock();
 }
 
 std::shared_ptr<IMedia> AlbumTrack::media()
 {
-    auto lock = m_media.lock();
     if ( m_media.isCached() == false )
-    {
-        m_media = Media::fetch( m_ml, m_mediaId );
-    }
+        return m_media.initialize( Media::fetch( m_ml, m_mediaId ) ).lock();
     return m_media.get().lock();
 }
 
@@ -51,7 +51,7 @@ struct AlbumTrackTable
 };
 }
 
-class AlbumTrack : public IAlbumTrack, public DatabaseHelpers<AlbumTrack, policy::AlbumTrackTable>
+class AlbumTrack : public IAlbumTrack, public DatabaseHelpers<AlbumTrack, policy::AlbumTrackTable, cachepolicy::Lru<AlbumTrack>>
 {
     public:
         AlbumTrack( MediaLibraryPtr ml, sqlite::Row& row );
@@ -59,6 +59,7 @@ class AlbumTrack : public IAlbumTrack, public DatabaseHelpers<AlbumTrack, policy
                     unsigned int trackNumber, int64_t albumId, unsigned int discNumber );
 
         virtual int64_t id() const override;
+        int64_t mediaId() const;
         virtual ArtistPtr artist() const override;
         bool setArtist( std::shared_ptr<Artist> artist );
         virtual GenrePtr genre() override;
@@ -69,13 +70,21 @@ class AlbumTrack : public IAlbumTrack, public DatabaseHelpers<AlbumTrack, policy
         virtual std::shared_ptr<IMedia> media() override;
 
         static bool createTable( DBConnection dbConnection );
+        static bool createIndexes( DBConnection dbConnection );
         static std::shared_ptr<AlbumTrack> create(MediaLibraryPtr ml, int64_t albumId,
                                     std::shared_ptr<Media> media, unsigned int trackNb,
                                     unsigned int discNumber, int64_t artistId, int64_t genreId,
                                     int64_t duration );
         static AlbumTrackPtr fromMedia( MediaLibraryPtr ml, int64_t mediaId );
         static std::vector<MediaPtr> fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc );
+        static Page<IMedia> fromGenre( MediaLibraryPtr ml, int64_t genreId, SortingCriteria sort, bool desc,
+                                       uint32_t pageSize, const std::string& continuation );
         static std::vector<MediaPtr> search(DBConnection dbConn, const std::string& title );
+        ///
+        /// \brief prefetchRelations Loads the artists & albums of the provided tracks
+        /// with one request each, instead of one per track
+        ///
+        static void prefetchRelations( MediaLibraryPtr ml, const std::vector<std::shared_ptr<AlbumTrack>>& tracks );
 
     private:
         MediaLibraryPtr m_ml;
@@ -76,8 +76,9 @@ const std::string &Artist::shortBio() const
 
 bool Artist::setShortBio(const std::string &shortBio)
 {
-    static const std::string req = "UPDATE " + policy::ArtistTable::Name
-            + " SET shortbio = ? WHERE id_artist = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ArtistTable::Name
+            + " SET shortbio = ? WHERE id_artist = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, shortBio, m_id ) == false )
         return false;
     m_shortBio = shortBio;
@@ -89,35 +90,65 @@ std::vector<AlbumPtr> Artist::albums( SortingCriteria sort, bool desc ) const
     return Album::fromArtist( m_ml, m_id, sort, desc );
 }
 
+Page<IAlbum> Artist::albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                             const std::string& continuation ) const
+{
+    return Album::fromArtist( m_ml, m_id, sort, desc, pageSize, continuation );
+}
+
 std::vector<MediaPtr> Artist::media( SortingCriteria sort, bool desc ) const
 {
-    std::string req = "SELECT med.* FROM " + policy::MediaTable::Name + " med "
-            "INNER JOIN MediaArtistRelation mar ON mar.media_id = med.id_media "
-            "WHERE mar.artist_id = ? AND med.is_present = 1 ORDER BY ";
-    switch ( sort )
-    {
-    case SortingCriteria::Duration:
-        req += "med.duration";
-        break;
-    case SortingCriteria::InsertionDate:
-        req += "med.insertion_date";
-        break;
-    case SortingCriteria::ReleaseDate:
-        req += "med.release_date";
-        break;
-    default:
-        req += "med.title";
-        break;
-    }
+    return media( sort, desc, 0, {} ).items;
+}
 
-    if ( desc == true )
-        req += " DESC";
-    return Media::fetchAll<IMedia>( m_ml, req, m_id );
+const sqlite::QueryTable& Artist::mediaTable()
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        std::string key;
+        switch ( sort )
+        {
+        case SortingCriteria::Duration:
+            key = "med.duration";
+            break;
+        case SortingCriteria::InsertionDate:
+            key = "med.insertion_date";
+            break;
+        case SortingCriteria::ReleaseDate:
+            key = "med.release_date";
+            break;
+        default:
+            key = "med.title";
+            break;
+        }
+        return sqlite::KeysetQuery( "med.*",
+                policy::MediaTable::Name + " med "
+                    "INNER JOIN MediaArtistRelation mar ON mar.media_id = med.id_media",
+                "mar.artist_id = ? AND med.is_present = 1",
+                { { std::move( key ), desc } }, "med.id_media", sort, desc );
+    });
+    return table;
+}
+
+Page<IMedia> Artist::media( SortingCriteria sort, bool desc, uint32_t pageSize,
+                            const std::string& continuation ) const
+{
+    return Media::fetchPage<IMedia>( m_ml, mediaTable(), sort, desc, pageSize, continuation, m_id );
+}
+
+std::vector<int64_t> Artist::mediaIds( SortingCriteria sort, bool desc ) const
+{
+    return Media::fetchIds( m_ml, mediaTable(), sort, desc, m_id );
+}
+
+uint32_t Artist::nbMedia() const
+{
+    return Media::fetchCount( m_ml, mediaTable(), m_id );
 }
 
 bool Artist::addMedia( Media& media )
 {
-    static const std::string req = "INSERT INTO MediaArtistRelation VALUES(?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO MediaArtistRelation VALUES(?, ?)" );
     // If track's ID is 0, the request will fail due to table constraints
     sqlite::ForeignKey artistForeignKey( m_id );
     return sqlite::Tools::executeInsert( m_ml->getConn(), req, media.id(), artistForeignKey ) != 0;
@@ -132,8 +163,9 @@ bool Artist::setArtworkMrl( const std::string& artworkMrl )
 {
     if ( m_artworkMrl == artworkMrl )
         return true;
-    static const std::string req = "UPDATE " + policy::ArtistTable::Name +
-            " SET artwork_mrl = ? WHERE id_artist = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ArtistTable::Name +
+            " SET artwork_mrl = ? WHERE id_artist = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, artworkMrl, m_id ) == false )
         return false;
     m_artworkMrl = artworkMrl;
@@ -145,8 +177,9 @@ bool Artist::updateNbAlbum( int increment )
     assert( increment != 0 );
     assert( increment > 0 || ( increment < 0 && m_nbAlbums >= 1 ) );
 
-    static const std::string req = "UPDATE " + policy::ArtistTable::Name +
-            " SET nb_albums = nb_albums + ? WHERE id_artist = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ArtistTable::Name +
+            " SET nb_albums = nb_albums + ? WHERE id_artist = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, increment, m_id ) == false )
         return false;
     m_nbAlbums += increment;
@@ -155,8 +188,9 @@ bool Artist::updateNbAlbum( int increment )
 
 std::shared_ptr<Album> Artist::unknownAlbum()
 {
-    static const std::string req = "SELECT * FROM " + policy::AlbumTable::Name +
-                        " WHERE artist_id = ? AND title IS NULL";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::AlbumTable::Name +
+                        " WHERE artist_id = ? AND title IS NULL" );
     auto album = Album::fetch( m_ml, req, m_id );
     if ( album == nullptr )
     {
@@ -179,8 +213,9 @@ const std::string& Artist::musicBrainzId() const
 
 bool Artist::setMusicBrainzId( const std::string& mbId )
 {
-    static const std::string req = "UPDATE " + policy::ArtistTable::Name
-            + " SET mb_id = ? WHERE id_artist = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ArtistTable::Name
+            + " SET mb_id = ? WHERE id_artist = ?" );
     if ( mbId == m_mbId )
         return true;
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, mbId, m_id ) == false )
@@ -189,6 +224,11 @@ bool Artist::setMusicBrainzId( const std::string& mbId )
     return true;
 }
 
+size_t Artist::dynamicMemoryUsage() const
+{
+    return m_name.capacity() + m_shortBio.capacity() + m_artworkMrl.capacity() + m_mbId.capacity();
+}
+
 bool Artist::createTable( DBConnection dbConnection )
 {
     const std::string req = "CREATE TABLE IF NOT EXISTS " +
@@ -220,6 +260,15 @@ bool Artist::createTable( DBConnection dbConnection )
             sqlite::Tools::executeRequest( dbConnection, reqFts );
 }
 
+bool Artist::createIndexes( DBConnection dbConnection )
+{
+    // The relation primary key starts with the media, which doesn't help
+    // listing an artist's media.
+    const std::string relIndexReq = "CREATE INDEX IF NOT EXISTS media_artist_rel_artist_idx ON "
+            "MediaArtistRelation(artist_id, media_id)";
+    return sqlite::Tools::executeRequest( dbConnection, relIndexReq );
+}
+
 bool Artist::createTriggers(DBConnection dbConnection)
 {
     static const std::string triggerReq = "CREATE TRIGGER IF NOT EXISTS has_album_present AFTER UPDATE OF "
@@ -265,8 +314,9 @@ bool Artist::createDefaultArtists( DBConnection dbConnection )
 {
     // Don't rely on Artist::create, since we want to insert or do nothing here.
     // This will skip the cache for those new entities, but they will be inserted soon enough anyway.
-    static const std::string req = "INSERT OR IGNORE INTO " + policy::ArtistTable::Name +
-            "(id_artist) VALUES(?),(?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT OR IGNORE INTO " + policy::ArtistTable::Name +
+            "(id_artist) VALUES(?),(?)" );
     sqlite::Tools::executeInsert( dbConnection, req, UnknownArtistID,
                                           VariousArtistID );
     // Always return true. The insertion might succeed, but we consider it a failure when 0 row
@@ -277,8 +327,9 @@ bool Artist::createDefaultArtists( DBConnection dbConnection )
 std::shared_ptr<Artist> Artist::create( MediaLibraryPtr ml, const std::string &name )
 {
     auto artist = std::make_shared<Artist>( ml, name );
-    static const std::string req = "INSERT INTO " + policy::ArtistTable::Name +
-            "(id_artist, name) VALUES(NULL, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::ArtistTable::Name +
+            "(id_artist, name) VALUES(NULL, ?)" );
     if ( insert( ml, artist, req, name ) == false )
         return nullptr;
     return artist;
@@ -286,24 +337,42 @@ std::shared_ptr<Artist> Artist::create( MediaLibraryPtr ml, const std::string &n
 
 std::vector<ArtistPtr> Artist::search( MediaLibraryPtr ml, const std::string& name )
 {
-    static const std::string req = "SELECT * FROM " + policy::ArtistTable::Name + " WHERE id_artist IN "
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::ArtistTable::Name + " WHERE id_artist IN "
             "(SELECT rowid FROM " + policy::ArtistTable::Name + "Fts WHERE name MATCH '*' || ? || '*')"
-            "AND is_present != 0";
+            "AND is_present != 0" );
     return fetchAll<IArtist>( ml, req, name );
 }
 
 std::vector<ArtistPtr> Artist::listAll(MediaLibraryPtr ml, SortingCriteria sort, bool desc)
 {
-    std::string req = "SELECT * FROM " + policy::ArtistTable::Name +
-            " WHERE nb_albums > 0 AND is_present = 1 ORDER BY ";
-    switch ( sort )
-    {
-    default:
-        req += "name";
-    }
-    if ( desc == true )
-        req +=  " DESC";
-    return fetchAll<IArtist>( ml, req );
+    return listAll( ml, sort, desc, 0, {} ).items;
+}
+
+const sqlite::QueryTable& Artist::listAllTable()
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        return sqlite::KeysetQuery( "*", policy::ArtistTable::Name,
+                                    "nb_albums > 0 AND is_present = 1",
+                                    { { "name", desc } }, "id_artist", sort, desc );
+    });
+    return table;
+}
+
+Page<IArtist> Artist::listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                               uint32_t pageSize, const std::string& continuation )
+{
+    return fetchPage<IArtist>( ml, listAllTable(), sort, desc, pageSize, continuation );
+}
+
+std::vector<int64_t> Artist::listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc )
+{
+    return fetchIds( ml, listAllTable(), sort, desc );
+}
+
+uint32_t Artist::count( MediaLibraryPtr ml )
+{
+    return fetchCount( ml, listAllTable() );
 }
 
 }
@@ -54,7 +54,13 @@ public:
     virtual const std::string& shortBio() const override;
     bool setShortBio( const std::string& shortBio );
     virtual std::vector<AlbumPtr> albums( SortingCriteria sort, bool desc ) const override;
+    virtual Page<IAlbum> albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation ) const override;
     virtual std::vector<MediaPtr> media(SortingCriteria sort, bool desc) const override;
+    virtual Page<IMedia> media( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                const std::string& continuation ) const override;
+    virtual std::vector<int64_t> mediaIds( SortingCriteria sort, bool desc ) const override;
+    virtual uint32_t nbMedia() const override;
     bool addMedia( Media& media );
     virtual const std::string& artworkMrl() const override;
     bool setArtworkMrl( const std::string& artworkMrl );
@@ -63,14 +69,24 @@ public:
     virtual const std::string& musicBrainzId() const override;
     bool setMusicBrainzId( const std::string& musicBrainzId );
 
+    size_t dynamicMemoryUsage() const;
+
     static bool createTable( DBConnection dbConnection );
+    static bool createIndexes( DBConnection dbConnection );
     static bool createTriggers( DBConnection dbConnection );
     static bool createDefaultArtists( DBConnection dbConnection );
     static std::shared_ptr<Artist> create( MediaLibraryPtr ml, const std::string& name );
     static std::vector<ArtistPtr> search( MediaLibraryPtr ml, const std::string& name );
     static std::vector<ArtistPtr> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+    static Page<IArtist> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                                  uint32_t pageSize, const std::string& continuation );
+    static std::vector<int64_t> listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+    static uint32_t count( MediaLibraryPtr ml );
 
 private:
+    static const sqlite::QueryTable& listAllTable();
+    static const sqlite::QueryTable& mediaTable();
+
     MediaLibraryPtr m_ml;
     int64_t m_id;
     std::string m_name;
@@ -123,8 +123,9 @@ std::shared_ptr<AudioTrack> AudioTrack::create( MediaLibraryPtr ml, const std::s
                                                 unsigned int bitrate, unsigned int sampleRate, unsigned int nbChannels,
                                                 const std::string& language, const std::string& desc, int64_t mediaId )
 {
-    static const std::string req = "INSERT INTO " + policy::AudioTrackTable::Name
-            + "(codec, bitrate, samplerate, nb_channels, language, description, media_id) VALUES(?, ?, ?, ?, ?, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::AudioTrackTable::Name
+            + "(codec, bitrate, samplerate, nb_channels, language, description, media_id) VALUES(?, ?, ?, ?, ?, ?, ?)" );
     auto track = std::make_shared<AudioTrack>( ml, codec, bitrate, sampleRate, nbChannels, language, desc, mediaId );
     if ( insert( ml, track, req, codec, bitrate, sampleRate, nbChannels, language, desc, mediaId ) == false )
         return nullptr;
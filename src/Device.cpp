@@ -78,8 +78,9 @@ bool Device::isPresent() const
 
 void Device::setPresent(bool value)
 {
-    static const std::string req = "UPDATE " + policy::DeviceTable::Name +
-            " SET is_present = ? WHERE id_device = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::DeviceTable::Name +
+            " SET is_present = ? WHERE id_device = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, value, m_id ) == false )
         return;
     m_isPresent = value;
@@ -92,8 +93,9 @@ const std::string& Device::scheme() const
 
 std::shared_ptr<Device> Device::create( MediaLibraryPtr ml, const std::string& uuid, const std::string& scheme, bool isRemovable )
 {
-    static const std::string req = "INSERT INTO " + policy::DeviceTable::Name
-            + "(uuid, scheme, is_removable, is_present) VALUES(?, ?, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::DeviceTable::Name
+            + "(uuid, scheme, is_removable, is_present) VALUES(?, ?, ?, ?)" );
     auto self = std::make_shared<Device>( ml, uuid, scheme, isRemovable );
     if ( insert( ml, self, req, uuid, scheme, isRemovable, self->isPresent() ) == false )
         return nullptr;
@@ -114,8 +116,9 @@ bool Device::createTable(DBConnection connection)
 
 std::shared_ptr<Device> Device::fromUuid( MediaLibraryPtr ml, const std::string& uuid )
 {
-    static const std::string req = "SELECT * FROM " + policy::DeviceTable::Name +
-            " WHERE uuid = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::DeviceTable::Name +
+            " WHERE uuid = ?" );
     return fetch( ml, req, uuid );
 }
 
@@ -97,14 +97,12 @@ const std::string& File::mrl() const
     if ( m_isRemovable == false )
         return m_mrl;
 
-    auto lock = m_fullPath.lock();
     if ( m_fullPath.isCached() )
-        return m_fullPath;
+        return m_fullPath.get();
     auto folder = Folder::fetch( m_ml, m_folderId );
     if ( folder == nullptr )
         return m_mrl;
-    m_fullPath = folder->mrl() + m_mrl;
-    return m_fullPath;
+    return m_fullPath.initialize( folder->mrl() + m_mrl );
 }
 
 IFile::Type File::type() const
@@ -141,9 +139,10 @@ void File::markStepUncompleted(File::ParserStep step)
 
 bool File::saveParserStep()
 {
-    static const std::string req = "UPDATE " + policy::FileTable::Name + " SET parser_step = ?, "
-            "parser_retries = 0 WHERE id_file = ?";
-    if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, m_parserSteps, m_id ) == false )
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::FileTable::Name + " SET parser_step = ?, "
+            "parser_retries = 0 WHERE id_file = ?" );
+    if ( executeDeferredUpdate( m_ml, m_id, req, m_parserSteps, m_id ) == false )
         return false;
     return true;
 }
@@ -155,19 +154,19 @@ File::ParserStep File::parserStep() const
 
 void File::startParserStep()
 {
-    static const std::string req = "UPDATE " + policy::FileTable::Name + " SET "
-            "parser_retries = parser_retries + 1 WHERE id_file = ?";
-    sqlite::Tools::executeUpdate( m_ml->getConn(), req, m_id );
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::FileTable::Name + " SET "
+            "parser_retries = parser_retries + 1 WHERE id_file = ?" );
+    executeDeferredUpdate( m_ml, m_id, req, m_id );
 }
 
 std::shared_ptr<Media> File::media() const
 {
-    auto lock = m_media.lock();
     if ( m_media.isCached() == false )
     {
         auto media = Media::fetch( m_ml, m_mediaId );
         assert( isDeleted() == true || media != nullptr );
-        m_media = media;
+        return m_media.initialize( media ).lock();
     }
     return m_media.get().lock();
 }
@@ -182,6 +181,16 @@ int64_t File::folderId()
     return m_folderId;
 }
 
+int64_t File::mediaId() const
+{
+    return m_mediaId;
+}
+
+size_t File::dynamicMemoryUsage() const
+{
+    return m_mrl.capacity();
+}
+
 bool File::createTable( DBConnection dbConnection )
 {
     std::string req = "CREATE TABLE IF NOT EXISTS " + policy::FileTable::Name + "("
@@ -218,32 +227,57 @@ bool File::createTable( DBConnection dbConnection )
             sqlite::Tools::executeRequest( dbConnection, folderIndexReq );
 }
 
+const sqlite::PrecompiledRequest& File::insertRequest()
+{
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::FileTable::Name +
+            "(media_id, mrl, type, folder_id, last_modification_date, size, is_removable, is_external) VALUES(?, ?, ?, ?, ?, ?, ?, 0)" );
+    return req;
+}
+
 std::shared_ptr<File> File::create( MediaLibraryPtr ml, int64_t mediaId, Type type, const fs::IFile& fileFs, int64_t folderId, bool isRemovable )
 {
     auto self = std::make_shared<File>( ml, mediaId, type, fileFs, folderId, isRemovable );
-    static const std::string req = "INSERT INTO " + policy::FileTable::Name +
-            "(media_id, mrl, type, folder_id, last_modification_date, size, is_removable, is_external) VALUES(?, ?, ?, ?, ?, ?, ?, 0)";
-
-    if ( insert( ml, self, req, mediaId, self->m_mrl, type, sqlite::ForeignKey( folderId ),
+    if ( insert( ml, self, insertRequest(), mediaId, self->m_mrl, type, sqlite::ForeignKey( folderId ),
                          self->m_lastModificationDate, self->m_size, isRemovable ) == false )
         return nullptr;
     self->m_fullPath = fileFs.mrl();
     return self;
 }
 
+std::vector<std::shared_ptr<File>> File::createBatch( MediaLibraryPtr ml, const std::vector<int64_t>& mediaIds, Type type,
+                                                     const std::vector<std::shared_ptr<fs::IFile>>& filesFs,
+                                                     int64_t folderId, bool isRemovable )
+{
+    assert( mediaIds.size() == filesFs.size() );
+    std::vector<std::shared_ptr<File>> files;
+    files.reserve( filesFs.size() );
+    for ( auto i = 0u; i < filesFs.size(); ++i )
+        files.push_back( std::make_shared<File>( ml, mediaIds[i], type, *filesFs[i], folderId, isRemovable ) );
+    insertBatch( ml, files, insertRequest(), []( sqlite::Statement& stmt, const std::shared_ptr<File>& f ) {
+        stmt.execute( f->m_mediaId, f->m_mrl, f->m_type, sqlite::ForeignKey( f->m_folderId ),
+                      f->m_lastModificationDate, f->m_size, f->m_isRemovable );
+    });
+    for ( auto i = 0u; i < filesFs.size(); ++i )
+        files[i]->m_fullPath = filesFs[i]->mrl();
+    return files;
+}
+
 std::shared_ptr<File> File::create( MediaLibraryPtr ml, int64_t mediaId, IFile::Type type, const std::string& mrl )
 {
     // Sqlite won't ensure uniqueness for (folder_id, mrl) when folder_id is null, so we have to ensure
     // of it ourselves
-    static const std::string existingReq = "SELECT * FROM " + policy::FileTable::Name +
-            " WHERE folder_id IS NULL AND mrl = ?";
+    static const auto existingReq = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FileTable::Name +
+            " WHERE folder_id IS NULL AND mrl = ?" );
     auto existing = fetch( ml, existingReq, mrl );
     if ( existing != nullptr )
         return nullptr;
 
     auto self = std::make_shared<File>( ml, mediaId, type, mrl );
-    static const std::string req = "INSERT INTO " + policy::FileTable::Name +
-            "(media_id, mrl, type, folder_id, is_removable, is_external) VALUES(?, ?, ?, NULL, 0, 1)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::FileTable::Name +
+            "(media_id, mrl, type, folder_id, is_removable, is_external) VALUES(?, ?, ?, NULL, 0, 1)" );
 
     if ( insert( ml, self, req, mediaId, mrl, type ) == false )
         return nullptr;
@@ -252,7 +286,8 @@ std::shared_ptr<File> File::create( MediaLibraryPtr ml, int64_t mediaId, IFile::
 
 std::shared_ptr<File> File::fromMrl( MediaLibraryPtr ml, const std::string& mrl )
 {
-    static const std::string req = "SELECT * FROM " + policy::FileTable::Name +  " WHERE mrl = ? AND folder_id IS NOT NULL";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FileTable::Name +  " WHERE mrl = ? AND folder_id IS NOT NULL" );
     auto file = fetch( ml, req, mrl );
     if ( file == nullptr )
         return nullptr;
@@ -265,8 +300,9 @@ std::shared_ptr<File> File::fromMrl( MediaLibraryPtr ml, const std::string& mrl
 
 std::shared_ptr<File> File::fromFileName( MediaLibraryPtr ml, const std::string& fileName, int64_t folderId )
 {
-    static const std::string req = "SELECT * FROM " + policy::FileTable::Name +  " WHERE mrl = ? "
-            "AND folder_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FileTable::Name +  " WHERE mrl = ? "
+            "AND folder_id = ?" );
     auto file = fetch( ml, req, fileName, folderId );
     if ( file == nullptr )
         return nullptr;
@@ -276,8 +312,9 @@ std::shared_ptr<File> File::fromFileName( MediaLibraryPtr ml, const std::string&
 
 std::shared_ptr<File> File::fromExternalMrl( MediaLibraryPtr ml, const std::string& mrl )
 {
-    static const std::string req = "SELECT * FROM " + policy::FileTable::Name +  " WHERE mrl = ? "
-            "AND folder_id IS NULL";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FileTable::Name +  " WHERE mrl = ? "
+            "AND folder_id IS NULL" );
     auto file = fetch( ml, req, mrl );
     if ( file == nullptr )
         return nullptr;
@@ -287,15 +324,17 @@ std::shared_ptr<File> File::fromExternalMrl( MediaLibraryPtr ml, const std::stri
 
 std::vector<std::shared_ptr<File>> File::fetchUnparsed( MediaLibraryPtr ml )
 {
-    static const std::string req = "SELECT * FROM " + policy::FileTable::Name
-            + " WHERE parser_step != ? AND is_present = 1 AND folder_id IS NOT NULL AND parser_retries < 3";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FileTable::Name
+            + " WHERE parser_step != ? AND is_present = 1 AND folder_id IS NOT NULL AND parser_retries < 3" );
     return File::fetchAll<File>( ml, req, File::ParserStep::Completed );
 }
 
 void File::resetRetryCount( MediaLibraryPtr ml )
 {
-    static const std::string req = "UPDATE " + policy::FileTable::Name + " SET "
-            "parser_retries = 0 WHERE parser_step != ? AND is_present = 1 AND folder_id IS NOT NULL";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::FileTable::Name + " SET "
+            "parser_retries = 0 WHERE parser_step != ? AND is_present = 1 AND folder_id IS NOT NULL" );
     sqlite::Tools::executeUpdate( ml->getConn(), req, ParserStep::Completed );
 }
 
@@ -45,7 +45,7 @@ struct FileTable
 };
 }
 
-class File : public IFile, public DatabaseHelpers<File, policy::FileTable>
+class File : public IFile, public DatabaseHelpers<File, policy::FileTable, cachepolicy::Lru<File>>
 {
 public:
     enum class ParserStep : uint8_t
@@ -83,13 +83,24 @@ public:
      */
     void startParserStep();
     std::shared_ptr<Media> media() const;
+    int64_t mediaId() const;
     bool destroy();
     int64_t folderId();
 
+    size_t dynamicMemoryUsage() const;
+
     static bool createTable( DBConnection dbConnection );
     static std::shared_ptr<File> create( MediaLibraryPtr ml, int64_t mediaId, Type type,
                                          const fs::IFile& file, int64_t folderId, bool isRemovable );
     static std::shared_ptr<File> create( MediaLibraryPtr ml, int64_t mediaId, Type type, const std::string& mrl );
+    ///
+    /// \brief createBatch Creates a file for each provided filesystem file
+    /// filesFs[i] is associated with the media mediaIds[i]. All files belong
+    /// to the same folder.
+    ///
+    static std::vector<std::shared_ptr<File>> createBatch( MediaLibraryPtr ml, const std::vector<int64_t>& mediaIds,
+                                                           Type type, const std::vector<std::shared_ptr<fs::IFile>>& filesFs,
+                                                           int64_t folderId, bool isRemovable );
     /**
      * @brief fromPath  Attempts to fetch a file using its mrl
      * This will only work if the file was stored on a non removable device
@@ -117,6 +128,10 @@ public:
     static std::vector<std::shared_ptr<File>> fetchUnparsed( MediaLibraryPtr ml );
     static void resetRetryCount( MediaLibraryPtr ml );
 
+private:
+    // The request inserting a file from a folder, shared by create & createBatch
+    static const sqlite::PrecompiledRequest& insertRequest();
+
 private:
     MediaLibraryPtr m_ml;
 
@@ -111,14 +111,14 @@ std::shared_ptr<Folder> Folder::create( MediaLibraryPtr ml, const std::string& m
     else
         path = mrl;
     auto self = std::make_shared<Folder>( ml, path, parentId, device.id(), device.isRemovable() );
-    static const std::string req = "INSERT INTO " + policy::FolderTable::Name +
-            "(path, parent_id, device_id, is_removable) VALUES(?, ?, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::FolderTable::Name +
+            "(path, parent_id, device_id, is_removable) VALUES(?, ?, ?, ?)" );
     if ( insert( ml, self, req, path, sqlite::ForeignKey( parentId ), device.id(), device.isRemovable() ) == false )
         return nullptr;
     if ( device.isRemovable() == true )
     {
-        self->m_deviceMountpoint = deviceFs.mountpoint();
-        self->m_fullPath = self->m_deviceMountpoint.get() + path;
+        self->m_fullPath = deviceFs.mountpoint() + path;
     }
     return self;
 }
@@ -126,7 +126,7 @@ std::shared_ptr<Folder> Folder::create( MediaLibraryPtr ml, const std::string& m
 bool Folder::blacklist( MediaLibraryPtr ml, const std::string& mrl )
 {
     // Ensure we delete the existing folder if any & blacklist the folder in an "atomic" way
-    return sqlite::Tools::withRetries( 3, [ml, &mrl]() {
+    return sqlite::Tools::withRetries( ml->getConn(), 3, [ml, &mrl]() {
         auto t = ml->getConn()->newTransaction();
 
         auto f = fromMrl( ml, mrl, BannedType::Any );
@@ -157,8 +157,9 @@ bool Folder::blacklist( MediaLibraryPtr ml, const std::string& mrl )
             path = utils::file::removePath( mrl, deviceFs->mountpoint() );
         else
             path = mrl;
-        static const std::string req = "INSERT INTO " + policy::FolderTable::Name +
-                "(path, parent_id, is_blacklisted, device_id, is_removable) VALUES(?, ?, ?, ?, ?)";
+        static const auto req = sqlite::StatementCache::registerRequest(
+                "INSERT INTO " + policy::FolderTable::Name +
+                "(path, parent_id, is_blacklisted, device_id, is_removable) VALUES(?, ?, ?, ?, ?)" );
         auto res = sqlite::Tools::executeInsert( ml->getConn(), req, path, nullptr, true, device->id(), deviceFs->isRemovable() ) != 0;
         t->commit();
         return res;
@@ -215,8 +216,11 @@ std::shared_ptr<Folder> Folder::fromMrl( MediaLibraryPtr ml, const std::string&
     }
     if ( folder == nullptr )
         return nullptr;
-    folder->m_deviceMountpoint = deviceFs->mountpoint();
-    folder->m_fullPath = folder->m_deviceMountpoint.get() + path;
+    // The folder is likely to be cached already, don't stack a new value
+    // unless the device was mounted elsewhere
+    auto fullPath = deviceFs->mountpoint() + path;
+    if ( folder->m_fullPath.isCached() == false || folder->m_fullPath.get() != fullPath )
+        folder->m_fullPath = std::move( fullPath );
     return folder;
 }
 
@@ -230,9 +234,8 @@ const std::string& Folder::mrl() const
     if ( m_isRemovable == false )
         return m_path;
 
-    auto lock = m_deviceMountpoint.lock();
-    if ( m_deviceMountpoint.isCached() == true )
-        return m_fullPath;
+    if ( m_fullPath.isCached() == true )
+        return m_fullPath.get();
 
     // We can't compute the full path of a folder if it's removable and the device isn't present.
     // When there's no device, we don't know the mountpoint, therefor we don't know the full path
@@ -240,29 +243,29 @@ const std::string& Folder::mrl() const
     if ( isPresent() == false )
     {
         assert( !"Device isn't present" );
-        m_fullPath = "";
-        return m_fullPath;
+        static const std::string empty;
+        return empty;
     }
 
     auto fsFactory = m_ml->fsFactoryForMrl( m_device.get()->scheme() );
     assert( fsFactory != nullptr );
     auto deviceFs = fsFactory->createDevice( m_device.get()->uuid() );
-    m_deviceMountpoint = deviceFs->mountpoint();
-    m_fullPath = m_deviceMountpoint.get() + m_path;
-    return m_fullPath;
+    return m_fullPath.initialize( deviceFs->mountpoint() + m_path );
 }
 
 std::vector<std::shared_ptr<File>> Folder::files()
 {
-    static const std::string req = "SELECT * FROM " + policy::FileTable::Name +
-        " WHERE folder_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FileTable::Name +
+        " WHERE folder_id = ?" );
     return File::fetchAll<File>( m_ml, req, m_id );
 }
 
 std::vector<std::shared_ptr<Folder>> Folder::folders()
 {
-    static const std::string req = "SELECT * FROM " + policy::FolderTable::Name
-            + " WHERE parent_id = ? AND is_blacklisted = 0 AND is_present = 1";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FolderTable::Name
+            + " WHERE parent_id = ? AND is_blacklisted = 0 AND is_present = 1" );
     return DatabaseHelpers::fetchAll<Folder>( m_ml, req, m_id );
 }
 
@@ -278,9 +281,8 @@ int64_t Folder::deviceId() const
 
 bool Folder::isPresent() const
 {
-    auto deviceLock = m_device.lock();
     if ( m_device.isCached() == false )
-        m_device = Device::fetch( m_ml, m_deviceId );
+        m_device.initialize( Device::fetch( m_ml, m_deviceId ) );
     assert( m_device.get() != nullptr );
     return m_device.get()->isPresent();
 }
@@ -292,9 +294,26 @@ bool Folder::isRootFolder() const
 
 std::vector<std::shared_ptr<Folder>> Folder::fetchRootFolders( MediaLibraryPtr ml )
 {
-    static const std::string req = "SELECT * FROM " + policy::FolderTable::Name
-            + " WHERE parent_id IS NULL AND is_blacklisted = 0 AND is_present = 1";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FolderTable::Name
+            + " WHERE parent_id IS NULL AND is_blacklisted = 0 AND is_present = 1" );
     return DatabaseHelpers::fetchAll<Folder>( ml, req );
 }
 
+std::vector<int64_t> Folder::subtreeMediaIds( MediaLibraryPtr ml, int64_t folderId )
+{
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "WITH RECURSIVE subtree(id) AS ("
+                "SELECT ? UNION ALL "
+                "SELECT f.id_folder FROM " + policy::FolderTable::Name + " f "
+                "INNER JOIN subtree ON f.parent_id = subtree.id"
+            ") SELECT DISTINCT media_id FROM " + policy::FileTable::Name +
+            " WHERE folder_id IN subtree" );
+    std::vector<int64_t> res;
+    sqlite::Tools::forEachRow( ml, req, [&res]( sqlite::Row& row ) {
+        res.push_back( row.load<int64_t>( 0 ) );
+    }, folderId );
+    return res;
+}
+
 }
@@ -64,6 +64,11 @@ public:
     static std::shared_ptr<Folder> create( MediaLibraryPtr ml, const std::string& mrl, int64_t parentId, Device& device, fs::IDevice& deviceFs );
     static bool blacklist( MediaLibraryPtr ml, const std::string& mrl );
     static std::vector<std::shared_ptr<Folder>> fetchRootFolders( MediaLibraryPtr ml );
+    ///
+    /// \brief subtreeMediaIds Returns the ids of the media having a file in
+    /// the provided folder or in any of its subfolders
+    ///
+    static std::vector<int64_t> subtreeMediaIds( MediaLibraryPtr ml, int64_t folderId );
 
     static std::shared_ptr<Folder> fromMrl(MediaLibraryPtr ml, const std::string& mrl );
     static std::shared_ptr<Folder> blacklistedFolder(MediaLibraryPtr ml, const std::string& mrl );
@@ -99,11 +104,10 @@ private:
     int64_t m_deviceId;
     bool m_isRemovable;
 
-    mutable Cache<std::string> m_deviceMountpoint;
     mutable Cache<std::shared_ptr<Device>> m_device;
     // This contains the full path, including device mountpoint (and mrl scheme,
     // as its part of the mountpoint
-    mutable std::string m_fullPath;
+    mutable Cache<std::string> m_fullPath;
 
     friend struct policy::FolderTable;
 };
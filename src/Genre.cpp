@@ -76,15 +76,23 @@ void Genre::updateCachedNbTracks( int increment )
     m_nbTracks += increment;
 }
 
-std::vector<ArtistPtr> Genre::artists( SortingCriteria, bool desc ) const
+std::vector<ArtistPtr> Genre::artists( SortingCriteria sort, bool desc ) const
 {
-    std::string req = "SELECT a.* FROM " + policy::ArtistTable::Name + " a "
-            "INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.artist_id = a.id_artist "
-            "WHERE att.genre_id = ? GROUP BY att.artist_id"
-            " ORDER BY a.name";
-    if ( desc == true )
-        req += " DESC";
-    return Artist::fetchAll<IArtist>( m_ml, req, m_id );
+    return artists( sort, desc, 0, {} ).items;
+}
+
+Page<IArtist> Genre::artists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                              const std::string& continuation ) const
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        sqlite::KeysetQuery query( "a.*",
+                policy::ArtistTable::Name + " a "
+                    "INNER JOIN " + policy::AlbumTrackTable::Name + " att ON att.artist_id = a.id_artist",
+                "att.genre_id = ?", { { "a.name", desc } }, "a.id_artist", sort, desc );
+        query.groupBy( "att.artist_id" );
+        return query;
+    });
+    return Artist::fetchPage<IArtist>( m_ml, table, sort, desc, pageSize, continuation, m_id );
 }
 
 std::vector<MediaPtr> Genre::tracks( SortingCriteria sort, bool desc ) const
@@ -92,11 +100,23 @@ std::vector<MediaPtr> Genre::tracks( SortingCriteria sort, bool desc ) const
     return AlbumTrack::fromGenre( m_ml, m_id, sort, desc );
 }
 
+Page<IMedia> Genre::tracks( SortingCriteria sort, bool desc, uint32_t pageSize,
+                            const std::string& continuation ) const
+{
+    return AlbumTrack::fromGenre( m_ml, m_id, sort, desc, pageSize, continuation );
+}
+
 std::vector<AlbumPtr> Genre::albums( SortingCriteria sort, bool desc ) const
 {
     return Album::fromGenre( m_ml, m_id, sort, desc );
 }
 
+Page<IAlbum> Genre::albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                            const std::string& continuation ) const
+{
+    return Album::fromGenre( m_ml, m_id, sort, desc, pageSize, continuation );
+}
+
 bool Genre::createTable( DBConnection dbConn )
 {
     const std::string req = "CREATE TABLE IF NOT EXISTS " + policy::GenreTable::Name +
@@ -156,8 +176,9 @@ bool Genre::createTriggers( DBConnection dbConn )
 
 std::shared_ptr<Genre> Genre::create( MediaLibraryPtr ml, const std::string& name )
 {
-    static const std::string req = "INSERT INTO " + policy::GenreTable::Name + "(name)"
-            "VALUES(?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::GenreTable::Name + "(name)"
+            "VALUES(?)" );
     auto self = std::make_shared<Genre>( ml, name );
     if ( insert( ml, self, req, name ) == false )
         return nullptr;
@@ -166,23 +187,47 @@ std::shared_ptr<Genre> Genre::create( MediaLibraryPtr ml, const std::string& nam
 
 std::shared_ptr<Genre> Genre::fromName( MediaLibraryPtr ml, const std::string& name )
 {
-    static const std::string req = "SELECT * FROM " + policy::GenreTable::Name + " WHERE name = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::GenreTable::Name + " WHERE name = ?" );
     return fetch( ml, req, name );
 }
 
 std::vector<GenrePtr> Genre::search( MediaLibraryPtr ml, const std::string& name )
 {
-    static const std::string req = "SELECT * FROM " + policy::GenreTable::Name + " WHERE id_genre IN "
-            "(SELECT rowid FROM " + policy::GenreTable::Name + "Fts WHERE name MATCH '*' || ? || '*')";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::GenreTable::Name + " WHERE id_genre IN "
+            "(SELECT rowid FROM " + policy::GenreTable::Name + "Fts WHERE name MATCH '*' || ? || '*')" );
     return fetchAll<IGenre>( ml, req, name );
 }
 
-std::vector<GenrePtr> Genre::listAll( MediaLibraryPtr ml, SortingCriteria, bool desc )
+std::vector<GenrePtr> Genre::listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc )
+{
+    return listAll( ml, sort, desc, 0, {} ).items;
+}
+
+const sqlite::QueryTable& Genre::listAllTable()
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        return sqlite::KeysetQuery( "*", policy::GenreTable::Name, {},
+                                    { { "name", desc } }, "id_genre", sort, desc );
+    });
+    return table;
+}
+
+Page<IGenre> Genre::listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                             uint32_t pageSize, const std::string& continuation )
+{
+    return fetchPage<IGenre>( ml, listAllTable(), sort, desc, pageSize, continuation );
+}
+
+std::vector<int64_t> Genre::listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc )
+{
+    return fetchIds( ml, listAllTable(), sort, desc );
+}
+
+uint32_t Genre::count( MediaLibraryPtr ml )
 {
-    std::string req = "SELECT * FROM " + policy::GenreTable::Name + " ORDER BY name";
-    if ( desc == true )
-        req += " DESC";
-    return fetchAll<IGenre>( ml, req );
+    return fetchCount( ml, listAllTable() );
 }
 
 }
@@ -51,8 +51,14 @@ public:
     virtual uint32_t nbTracks() const override;
     void updateCachedNbTracks( int increment );
     virtual std::vector<ArtistPtr> artists( SortingCriteria sort, bool desc ) const override;
+    virtual Page<IArtist> artists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                   const std::string& continuation ) const override;
     virtual std::vector<MediaPtr> tracks(SortingCriteria sort, bool desc) const override;
+    virtual Page<IMedia> tracks( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation ) const override;
     virtual std::vector<AlbumPtr> albums( SortingCriteria sort, bool desc ) const override;
+    virtual Page<IAlbum> albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                 const std::string& continuation ) const override;
 
     static bool createTable( DBConnection dbConn );
     static bool createTriggers( DBConnection dbConn );
@@ -60,8 +66,14 @@ public:
     static std::shared_ptr<Genre> fromName( MediaLibraryPtr ml, const std::string& name );
     static std::vector<GenrePtr> search( MediaLibraryPtr ml, const std::string& name );
     static std::vector<GenrePtr> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+    static Page<IGenre> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                                 uint32_t pageSize, const std::string& continuation );
+    static std::vector<int64_t> listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+    static uint32_t count( MediaLibraryPtr ml );
 
 private:
+    static const sqlite::QueryTable& listAllTable();
+
     MediaLibraryPtr m_ml;
 
     int64_t m_id;
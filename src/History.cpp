@@ -72,22 +72,25 @@ bool History::createTable( DBConnection dbConnection )
 
 bool History::insert( DBConnection dbConn, int64_t mediaId )
 {
-    static const std::string req = "INSERT OR REPLACE INTO " + policy::HistoryTable::Name +
-            "(id_media, insertion_date) VALUES(?, strftime('%s', 'now'))";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT OR REPLACE INTO " + policy::HistoryTable::Name +
+            "(id_media, insertion_date) VALUES(?, strftime('%s', 'now'))" );
     return sqlite::Tools::executeInsert( dbConn, req, mediaId ) != 0;
 }
 
 std::vector<HistoryPtr> History::fetch( MediaLibraryPtr ml )
 {
-    static const std::string req = "SELECT f.*, h.insertion_date FROM " + policy::MediaTable::Name + " f "
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT f.*, h.insertion_date FROM " + policy::MediaTable::Name + " f "
             "INNER JOIN " + policy::HistoryTable::Name + " h ON h.id_media = f.id_media "
-            "ORDER BY h.insertion_date DESC";
+            "ORDER BY h.insertion_date DESC" );
     return fetchAll<IHistoryEntry>( ml, req );
 }
 
 bool History::clearStreams( MediaLibraryPtr ml )
 {
-    static const std::string req = "DELETE FROM " + policy::HistoryTable::Name;
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "DELETE FROM " + policy::HistoryTable::Name );
     return sqlite::Tools::executeRequest( ml->getConn(), req );
 }
 
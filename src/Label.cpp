@@ -65,9 +65,10 @@ const std::string& Label::name() const
 
 std::vector<MediaPtr> Label::files()
 {
-    static const std::string req = "SELECT f.* FROM " + policy::MediaTable::Name + " f "
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT f.* FROM " + policy::MediaTable::Name + " f "
             "INNER JOIN LabelFileRelation lfr ON lfr.media_id = f.id_media "
-            "WHERE lfr.label_id = ?";
+            "WHERE lfr.label_id = ?" );
     return Media::fetchAll<IMedia>( m_ml, req, m_id );
 }
 
@@ -29,6 +29,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <unordered_map>
 
 #include "Album.h"
 #include "AlbumTrack.h"
@@ -98,28 +99,42 @@ Media::Media( MediaLibraryPtr ml, const std::string& title, Type type )
 std::shared_ptr<Media> Media::create( MediaLibraryPtr ml, Type type, const std::string& fileName )
 {
     auto self = std::make_shared<Media>( ml, fileName, type );
-    static const std::string req = "INSERT INTO " + policy::MediaTable::Name +
-            "(type, insertion_date, title, filename) VALUES(?, ?, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::MediaTable::Name +
+            "(type, insertion_date, title, filename) VALUES(?, ?, ?, ?)" );
 
     if ( insert( ml, self, req, type, self->m_insertionDate, self->m_title, self->m_filename ) == false )
         return nullptr;
     return self;
 }
 
+std::vector<std::shared_ptr<Media>> Media::createBatch( MediaLibraryPtr ml, Type type,
+                                                       const std::vector<std::string>& fileNames )
+{
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::MediaTable::Name +
+            "(type, insertion_date, title, filename) VALUES(?, ?, ?, ?)" );
+    std::vector<std::shared_ptr<Media>> media;
+    media.reserve( fileNames.size() );
+    for ( const auto& fileName : fileNames )
+        media.push_back( std::make_shared<Media>( ml, fileName, type ) );
+    insertBatch( ml, media, req, []( sqlite::Statement& stmt, const std::shared_ptr<Media>& m ) {
+        stmt.execute( m->m_type, m->m_insertionDate, m->m_title, m->m_filename );
+    });
+    return media;
+}
+
 AlbumTrackPtr Media::albumTrack() const
 {
     if ( m_subType != SubType::AlbumTrack )
         return nullptr;
-    auto lock = m_albumTrack.lock();
-
     if ( m_albumTrack.isCached() == false )
-        m_albumTrack = AlbumTrack::fromMedia( m_ml, m_id );
+        return m_albumTrack.initialize( AlbumTrack::fromMedia( m_ml, m_id ) );
     return m_albumTrack.get();
 }
 
 void Media::setAlbumTrack( AlbumTrackPtr albumTrack )
 {
-    auto lock = m_albumTrack.lock();
     m_albumTrack = albumTrack;
     m_subType = SubType::AlbumTrack;
     m_changed = true;
@@ -143,15 +158,13 @@ ShowEpisodePtr Media::showEpisode() const
     if ( m_subType != SubType::ShowEpisode )
         return nullptr;
 
-    auto lock = m_showEpisode.lock();
     if ( m_showEpisode.isCached() == false )
-        m_showEpisode = ShowEpisode::fromMedia( m_ml, m_id );
+        return m_showEpisode.initialize( ShowEpisode::fromMedia( m_ml, m_id ) );
     return m_showEpisode.get();
 }
 
 void Media::setShowEpisode( ShowEpisodePtr episode )
 {
-    auto lock = m_showEpisode.lock();
     m_showEpisode = episode;
     m_subType = SubType::ShowEpisode;
     m_changed = true;
@@ -159,9 +172,10 @@ void Media::setShowEpisode( ShowEpisodePtr episode )
 
 std::vector<LabelPtr> Media::labels()
 {
-    static const std::string req = "SELECT l.* FROM " + policy::LabelTable::Name + " l "
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT l.* FROM " + policy::LabelTable::Name + " l "
             "INNER JOIN LabelFileRelation lfr ON lfr.label_id = l.id_label "
-            "WHERE lfr.media_id = ?";
+            "WHERE lfr.media_id = ?" );
     return Label::fetchAll<ILabel>( m_ml, req, m_id );
 }
 
@@ -172,10 +186,11 @@ int Media::playCount() const
 
 bool Media::increasePlayCount()
 {
-    static const std::string req = "UPDATE " + policy::MediaTable::Name + " SET "
-            "play_count = ?, last_played_date = ? WHERE id_media = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MediaTable::Name + " SET "
+            "play_count = COALESCE( play_count, 0 ) + 1, last_played_date = ? WHERE id_media = ?" );
     auto lastPlayedDate = time( nullptr );
-    if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, m_playCount + 1, lastPlayedDate, m_id ) == false )
+    if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, lastPlayedDate, m_id ) == false )
         return false;
     m_playCount++;
     m_lastPlayedDate = lastPlayedDate;
@@ -189,10 +204,11 @@ bool Media::isFavorite() const
 
 bool Media::setFavorite( bool favorite )
 {
-    static const std::string req = "UPDATE " + policy::MediaTable::Name + " SET is_favorite = ? WHERE id_media = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MediaTable::Name + " SET is_favorite = ? WHERE id_media = ?" );
     if ( m_isFavorite == favorite )
         return true;
-    if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, favorite, m_id ) == false )
+    if ( executeDeferredUpdate( m_ml, m_id, req, favorite, m_id ) == false )
         return false;
     m_isFavorite = favorite;
     return true;
@@ -200,14 +216,16 @@ bool Media::setFavorite( bool favorite )
 
 const std::vector<FilePtr>& Media::files() const
 {
-    auto lock = m_files.lock();
     if ( m_files.isCached() == false )
     {
-        static const std::string req = "SELECT * FROM " + policy::FileTable::Name
-                + " WHERE media_id = ?";
-        m_files = File::fetchAll<IFile>( m_ml, req, m_id );
+        static const auto req = sqlite::StatementCache::registerRequest(
+                "SELECT * FROM " + policy::FileTable::Name
+                + " WHERE media_id = ?" );
+        return m_files.load( [this]() {
+            return File::fetchAll<IFile>( m_ml, req, m_id );
+        });
     }
-    return m_files;
+    return m_files.get();
 }
 
 MoviePtr Media::movie() const
@@ -215,16 +233,13 @@ MoviePtr Media::movie() const
     if ( m_subType != SubType::Movie )
         return nullptr;
 
-    auto lock = m_movie.lock();
-
     if ( m_movie.isCached() == false )
-        m_movie = Movie::fromMedia( m_ml, m_id );
+        return m_movie.initialize( Movie::fromMedia( m_ml, m_id ) );
     return m_movie.get();
 }
 
 void Media::setMovie(MoviePtr movie)
 {
-    auto lock = m_movie.lock();
     m_movie = movie;
     m_subType = SubType::Movie;
     m_changed = true;
@@ -238,8 +253,9 @@ bool Media::addVideoTrack(const std::string& codec, unsigned int width, unsigned
 
 std::vector<VideoTrackPtr> Media::videoTracks()
 {
-    static const std::string req = "SELECT * FROM " + policy::VideoTrackTable::Name +
-            " WHERE media_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::VideoTrackTable::Name +
+            " WHERE media_id = ?" );
     return VideoTrack::fetchAll<IVideoTrack>( m_ml, req, m_id );
 }
 
@@ -252,8 +268,9 @@ bool Media::addAudioTrack( const std::string& codec, unsigned int bitrate,
 
 std::vector<AudioTrackPtr> Media::audioTracks()
 {
-    static const std::string req = "SELECT * FROM " + policy::AudioTrackTable::Name +
-            " WHERE media_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::AudioTrackTable::Name +
+            " WHERE media_id = ?" );
     return AudioTrack::fetchAll<IAudioTrack>( m_ml, req, m_id );
 }
 
@@ -274,24 +291,28 @@ unsigned int Media::releaseDate() const
 
 const IMediaMetadata& Media::metadata( IMedia::MetadataType type ) const
 {
-    auto lock = m_metadata.lock();
     if ( m_metadata.isCached() == false )
     {
-        std::vector<MediaMetadata> res;
-        static const std::string req = "SELECT * FROM " + policy::MediaMetadataTable::Name +
-                " WHERE id_media = ?";
-        auto conn = m_ml->getConn();
-        auto ctx = conn->acquireReadContext();
-        sqlite::Statement stmt( conn->getConn(), req );
-        stmt.execute( m_id );
-        for ( sqlite::Row row = stmt.row(); row != nullptr; row = stmt.row() )
-        {
-            assert( row.load<int64_t>( 0 ) == m_id );
-            res.emplace_back( row.load<decltype(MediaMetadata::m_type)>( 1 ),
-                              row.load<decltype(MediaMetadata::m_value)>( 2 ) );
-        }
-        m_metadata = res;
+        static const auto req = sqlite::StatementCache::registerRequest(
+                "SELECT * FROM " + policy::MediaMetadataTable::Name +
+                " WHERE id_media = ?" );
+        m_metadata.load( [this]() {
+            std::vector<MediaMetadata> res;
+            auto conn = m_ml->getConn();
+            auto ctx = conn->acquireReadContext();
+            sqlite::Statement stmt( conn, req );
+            stmt.execute( m_id );
+            for ( sqlite::Row row = stmt.row(); row != nullptr; row = stmt.row() )
+            {
+                assert( row.load<int64_t>( 0 ) == m_id );
+                res.emplace_back( row.load<decltype(MediaMetadata::m_type)>( 1 ),
+                                  row.load<decltype(MediaMetadata::m_value)>( 2 ) );
+            }
+            return res;
+        });
     }
+    // Missing metadata are inserted on the fly, so the lookup needs the lock
+    auto lock = m_metadata.lock();
     auto it = std::find_if( begin( m_metadata.get() ), end( m_metadata.get() ), [type](const MediaMetadata& m ) {
         return m.m_type == type;
     });
@@ -305,30 +326,35 @@ const IMediaMetadata& Media::metadata( IMedia::MetadataType type ) const
 
 bool Media::setMetadata( IMedia::MetadataType type, const std::string& value )
 {
-    {
-        auto lock = m_metadata.lock();
-        if ( m_metadata.isCached() == true )
-        {
-            auto it = std::find_if( begin( m_metadata.get() ), end( m_metadata.get() ), [type](const MediaMetadata& m ) {
-                return m.m_type == type;
-            });
-            if ( it != end( m_metadata.get() ) )
-                (*it).m_value = value;
-            else
-                m_metadata.get().emplace_back( type, value );
-        }
-    }
     try
     {
-        static const std::string req = "INSERT OR REPLACE INTO " + policy::MediaMetadataTable::Name +
-                "(id_media, type, value) VALUES(?, ?, ?)";
-        return sqlite::Tools::executeInsert( m_ml->getConn(), req, m_id, type, value );
+        static const auto req = sqlite::StatementCache::registerRequest(
+                "INSERT OR REPLACE INTO " + policy::MediaMetadataTable::Name +
+                "(id_media, type, value) VALUES(?, ?, ?)" );
+        if ( sqlite::Tools::executeInsert( m_ml->getConn(), req, m_id, type, value ) == 0 )
+            return false;
     }
     catch ( const sqlite::errors::Generic& ex )
     {
         LOG_ERROR( "Failed to update media metadata: ", ex.what() );
         return false;
     }
+    // Update the cache once the database was updated, so that a concurrent
+    // load either sees the new value, or gets discarded
+    auto lock = m_metadata.lock();
+    if ( m_metadata.isCached() == false )
+    {
+        m_metadata.markModified();
+        return true;
+    }
+    auto it = std::find_if( begin( m_metadata.get() ), end( m_metadata.get() ), [type](const MediaMetadata& m ) {
+        return m.m_type == type;
+    });
+    if ( it != end( m_metadata.get() ) )
+        (*it).m_value = value;
+    else
+        m_metadata.get().emplace_back( type, value );
+    return true;
 }
 
 bool Media::setMetadata( IMedia::MetadataType type, int64_t value )
@@ -355,9 +381,10 @@ void Media::setThumbnail(const std::string& thumbnail )
 
 bool Media::save()
 {
-    static const std::string req = "UPDATE " + policy::MediaTable::Name + " SET "
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MediaTable::Name + " SET "
             "type = ?, subtype = ?, duration = ?, release_date = ?,"
-            "thumbnail = ?, title = ? WHERE id_media = ?";
+            "thumbnail = ?, title = ? WHERE id_media = ?" );
     if ( m_changed == false )
         return true;
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, m_type, m_subType, m_duration,
@@ -377,6 +404,8 @@ std::shared_ptr<File> Media::addFile( const fs::IFile& fileFs, Folder& parentFol
     auto lock = m_files.lock();
     if ( m_files.isCached() )
         m_files.get().push_back( file );
+    else
+        m_files.markModified();
     return file;
 }
 
@@ -398,6 +427,8 @@ FilePtr Media::addExternalMrl( const std::string& mrl , IFile::Type type )
     auto lock = m_files.lock();
     if ( m_files.isCached() )
         m_files.get().push_back( file );
+    else
+        m_files.markModified();
     return file;
 }
 
@@ -406,7 +437,10 @@ void Media::removeFile( File& file )
     file.destroy();
     auto lock = m_files.lock();
     if ( m_files.isCached() == false )
+    {
+        m_files.markModified();
         return;
+    }
     m_files.get().erase( std::remove_if( begin( m_files.get() ), end( m_files.get() ), [&file]( const FilePtr& f ) {
         return f->id() == file.id();
     }));
@@ -414,41 +448,59 @@ void Media::removeFile( File& file )
 
 std::vector<MediaPtr> Media::listAll( MediaLibraryPtr ml, IMedia::Type type, SortingCriteria sort, bool desc )
 {
-    std::string req;
-    if ( sort == SortingCriteria::LastModificationDate || sort == SortingCriteria::FileSize )
-    {
-        req = "SELECT m.* FROM " + policy::MediaTable::Name + " m INNER JOIN "
-                + policy::FileTable::Name + " f ON m.id_media = f.media_id"
-                " WHERE m.type = ?"
-                " AND f.type = ?";
-        if ( sort == SortingCriteria::LastModificationDate )
-            req += " ORDER BY f.last_modification_date";
-        else
-            req += " ORDER BY f.size";
-        if ( desc == true )
-            req += " DESC";
-        return fetchAll<IMedia>( ml, req, type, File::Type::Main );
-    }
-    req = "SELECT * FROM " + policy::MediaTable::Name + " WHERE type = ? AND is_present = 1 ORDER BY ";
-    switch ( sort )
-    {
-    case SortingCriteria::Duration:
-        req += "duration";
-        break;
-    case SortingCriteria::InsertionDate:
-        req += "insertion_date";
-        break;
-    case SortingCriteria::ReleaseDate:
-        req += "release_date";
-        break;
-    default:
-        req += "title";
-        break;
-    }
-    if ( desc == true )
-        req += " DESC";
+    return listAll( ml, type, sort, desc, 0, {} ).items;
+}
 
-    return fetchAll<IMedia>( ml, req, type );
+const sqlite::QueryTable& Media::listAllTable()
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        if ( sort == SortingCriteria::LastModificationDate || sort == SortingCriteria::FileSize )
+        {
+            return sqlite::KeysetQuery( "m.*",
+                    policy::MediaTable::Name + " m INNER JOIN "
+                        + policy::FileTable::Name + " f ON m.id_media = f.media_id",
+                    "m.type = ? AND f.type = " +
+                        std::to_string( static_cast<int>( File::Type::Main ) ),
+                    { { sort == SortingCriteria::LastModificationDate ?
+                            "f.last_modification_date" : "f.size", desc } },
+                    "m.id_media", sort, desc );
+        }
+        std::string key;
+        switch ( sort )
+        {
+        case SortingCriteria::Duration:
+            key = "duration";
+            break;
+        case SortingCriteria::InsertionDate:
+            key = "insertion_date";
+            break;
+        case SortingCriteria::ReleaseDate:
+            key = "release_date";
+            break;
+        default:
+            key = "title";
+            break;
+        }
+        return sqlite::KeysetQuery( "*", policy::MediaTable::Name, "type = ? AND is_present = 1",
+                                    { { std::move( key ), desc } }, "id_media", sort, desc );
+    });
+    return table;
+}
+
+Page<IMedia> Media::listAll( MediaLibraryPtr ml, IMedia::Type type, SortingCriteria sort, bool desc,
+                             uint32_t pageSize, const std::string& continuation )
+{
+    return fetchPage<IMedia>( ml, listAllTable(), sort, desc, pageSize, continuation, type );
+}
+
+std::vector<int64_t> Media::listAllIds( MediaLibraryPtr ml, IMedia::Type type, SortingCriteria sort, bool desc )
+{
+    return fetchIds( ml, listAllTable(), sort, desc, type );
+}
+
+uint32_t Media::count( MediaLibraryPtr ml, IMedia::Type type )
+{
+    return fetchCount( ml, listAllTable(), type );
 }
 
 int64_t Media::id() const
@@ -481,7 +533,8 @@ const std::string &Media::title() const
 
 bool Media::setTitle( const std::string& title )
 {
-    static const std::string req = "UPDATE " + policy::MediaTable::Name + " SET title = ? WHERE id_media = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MediaTable::Name + " SET title = ? WHERE id_media = ?" );
     if ( m_title == title )
         return true;
     try
@@ -507,6 +560,11 @@ void Media::setTitleBuffered( const std::string &title )
     m_changed = true;
 }
 
+size_t Media::dynamicMemoryUsage() const
+{
+    return m_title.capacity() + m_filename.capacity() + m_thumbnail.capacity();
+}
+
 bool Media::createTable( DBConnection connection )
 {
     std::string req = "CREATE TABLE IF NOT EXISTS " + policy::MediaTable::Name + "("
@@ -543,6 +601,25 @@ bool Media::createTable( DBConnection connection )
             sqlite::Tools::executeRequest( connection, metadataReq );
 }
 
+bool Media::createIndexes( DBConnection connection )
+{
+    // Media listings filter on the type & presence, and sort on one of those
+    // columns. The primary key is implicitly part of each index, which also
+    // serves as the pagination tie breaker.
+    const std::string typeTitleIndexReq = "CREATE INDEX IF NOT EXISTS media_type_title_idx ON "
+            + policy::MediaTable::Name + "(type, is_present, title)";
+    const std::string typeDurationIndexReq = "CREATE INDEX IF NOT EXISTS media_type_duration_idx ON "
+            + policy::MediaTable::Name + "(type, is_present, duration)";
+    const std::string typeInsertionIndexReq = "CREATE INDEX IF NOT EXISTS media_type_insertion_date_idx ON "
+            + policy::MediaTable::Name + "(type, is_present, insertion_date)";
+    const std::string typeReleaseIndexReq = "CREATE INDEX IF NOT EXISTS media_type_release_date_idx ON "
+            + policy::MediaTable::Name + "(type, is_present, release_date)";
+    return sqlite::Tools::executeRequest( connection, typeTitleIndexReq ) &&
+            sqlite::Tools::executeRequest( connection, typeDurationIndexReq ) &&
+            sqlite::Tools::executeRequest( connection, typeInsertionIndexReq ) &&
+            sqlite::Tools::executeRequest( connection, typeReleaseIndexReq );
+}
+
 bool Media::createTriggers( DBConnection connection )
 {
     static const std::string triggerReq = "CREATE TRIGGER IF NOT EXISTS has_files_present AFTER UPDATE OF "
@@ -591,7 +668,7 @@ bool Media::addLabel( LabelPtr label )
     }
     try
     {
-        return sqlite::Tools::withRetries( 3, [this]( LabelPtr label ) {
+        return sqlite::Tools::withRetries( m_ml->getConn(), 3, [this]( LabelPtr label ) {
             auto t = m_ml->getConn()->newTransaction();
 
             const char* req = "INSERT INTO LabelFileRelation VALUES(?, ?)";
@@ -621,7 +698,7 @@ bool Media::removeLabel( LabelPtr label )
     }
     try
     {
-        return sqlite::Tools::withRetries( 3, [this]( LabelPtr label ) {
+        return sqlite::Tools::withRetries( m_ml->getConn(), 3, [this]( LabelPtr label ) {
             auto t = m_ml->getConn()->newTransaction();
 
             const char* req = "DELETE FROM LabelFileRelation WHERE label_id = ? AND media_id = ?";
@@ -645,34 +722,143 @@ bool Media::removeLabel( LabelPtr label )
 
 std::vector<MediaPtr> Media::search( MediaLibraryPtr ml, const std::string& title )
 {
-    static const std::string req = "SELECT * FROM " + policy::MediaTable::Name + " WHERE"
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::MediaTable::Name + " WHERE"
             " id_media IN (SELECT rowid FROM " + policy::MediaTable::Name + "Fts"
             " WHERE " + policy::MediaTable::Name + "Fts MATCH '*' || ? || '*')"
-            "AND is_present = 1";
+            "AND is_present = 1" );
     return Media::fetchAll<IMedia>( ml, req, title );
 }
 
-std::vector<MediaPtr> Media::fetchHistory( MediaLibraryPtr ml )
+std::vector<MediaPtr> Media::fetchHistory( MediaLibraryPtr ml, uint32_t nbMedia )
 {
-    static const std::string req = "SELECT * FROM " + policy::MediaTable::Name + " WHERE last_played_date IS NOT NULL"
-            " ORDER BY last_played_date DESC LIMIT 100";
-    return fetchAll<IMedia>( ml, req );
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::MediaTable::Name + " WHERE last_played_date IS NOT NULL"
+            " ORDER BY last_played_date DESC LIMIT ?" );
+    return fetchAll<IMedia>( ml, req, nbMedia );
 }
 
-void Media::clearHistory( MediaLibraryPtr ml )
+void Media::prefetch( MediaLibraryPtr ml, const std::vector<Media*>& media )
+{
+    std::vector<Media*> missingFiles;
+    std::vector<Media*> missingAlbumTracks;
+    std::vector<Media*> missingShowEpisodes;
+    std::vector<Media*> missingMovies;
+    for ( auto self : media )
+    {
+        if ( self->m_files.isCached() == false )
+            missingFiles.push_back( self );
+        switch ( self->m_subType )
+        {
+            case SubType::AlbumTrack:
+                if ( self->m_albumTrack.isCached() == false )
+                    missingAlbumTracks.push_back( self );
+                break;
+            case SubType::ShowEpisode:
+                if ( self->m_showEpisode.isCached() == false )
+                    missingShowEpisodes.push_back( self );
+                break;
+            case SubType::Movie:
+                if ( self->m_movie.isCached() == false )
+                    missingMovies.push_back( self );
+                break;
+            default:
+                break;
+        }
+    }
+    if ( missingFiles.empty() == false )
+    {
+        std::vector<int64_t> mediaIds;
+        std::vector<uint32_t> versions;
+        mediaIds.reserve( missingFiles.size() );
+        versions.reserve( missingFiles.size() );
+        for ( auto m : missingFiles )
+        {
+            mediaIds.push_back( m->m_id );
+            versions.push_back( m->m_files.version() );
+        }
+        auto files = File::fetchIn( ml, "media_id", mediaIds );
+        // Keep the order files() would have fetched them in
+        std::sort( begin( files ), end( files ), []( const std::shared_ptr<File>& a, const std::shared_ptr<File>& b ) {
+            return a->id() < b->id();
+        });
+        std::unordered_map<int64_t, std::vector<FilePtr>> filesByMedia;
+        for ( auto& f : files )
+            filesByMedia[f->mediaId()].push_back( std::move( f ) );
+        // Files added or removed meanwhile will be loaded by files() instead
+        for ( auto i = 0u; i < missingFiles.size(); ++i )
+        {
+            auto m = missingFiles[i];
+            m->m_files.initialize( std::move( filesByMedia[m->m_id] ), versions[i] );
+        }
+    }
+    auto albumTracks = prefetchSubType<AlbumTrack>( ml, missingAlbumTracks, &Media::m_albumTrack );
+    AlbumTrack::prefetchRelations( ml, albumTracks );
+    prefetchSubType<ShowEpisode>( ml, missingShowEpisodes, &Media::m_showEpisode );
+    prefetchSubType<Movie>( ml, missingMovies, &Media::m_movie );
+}
+
+std::vector<AlbumTrackPtr> Media::albumTracks( MediaLibraryPtr ml, const std::vector<MediaPtr>& media )
+{
+    std::vector<Media*> missingAlbumTracks;
+    for ( const auto& m : media )
+    {
+        auto self = static_cast<Media*>( m.get() );
+        if ( self->m_subType == SubType::AlbumTrack && self->m_albumTrack.isCached() == false )
+            missingAlbumTracks.push_back( self );
+    }
+    prefetchSubType<AlbumTrack>( ml, missingAlbumTracks, &Media::m_albumTrack );
+    std::vector<AlbumTrackPtr> res;
+    res.reserve( media.size() );
+    for ( const auto& m : media )
+        res.push_back( m->albumTrack() );
+    return res;
+}
+
+template <typename T, typename Cell>
+std::vector<std::shared_ptr<T>> Media::prefetchSubType( MediaLibraryPtr ml, const std::vector<Media*>& media,
+                                                        Cache<Cell> Media::* cell )
+{
+    if ( media.empty() == true )
+        return {};
+    std::vector<int64_t> mediaIds;
+    mediaIds.reserve( media.size() );
+    for ( auto m : media )
+        mediaIds.push_back( m->m_id );
+    auto entities = T::fetchIn( ml, "media_id", mediaIds );
+    std::unordered_map<int64_t, std::shared_ptr<T>> byMedia;
+    for ( const auto& e : entities )
+        byMedia.emplace( e->mediaId(), e );
+    // Media without a matching row get a null value, as they would by fetching it
+    for ( auto m : media )
+        ( m->*cell ).initialize( Cell( byMedia[m->m_id] ) );
+    return entities;
+}
+
+std::vector<int64_t> Media::clearHistory( MediaLibraryPtr ml )
 {
     auto dbConn = ml->getConn();
     // There should already be an active transaction, from MediaLibrary::clearHistory
     assert( sqlite::Transaction::transactionInProgress() == true );
-    static const std::string req = "UPDATE " + policy::MediaTable::Name + " SET "
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MediaTable::Name + " SET "
             "play_count = 0,"
-            "last_played_date = NULL";
-    static const std::string flushProgress = "DELETE FROM " + policy::MediaMetadataTable::Name +
-            " WHERE type = ?";
-    // Clear the entire cache since quite a few items are now containing invalid info.
-    clear();
+            "last_played_date = NULL" );
+    static const auto flushProgress = sqlite::StatementCache::registerRequest(
+            "DELETE FROM " + policy::MediaMetadataTable::Name +
+            " WHERE type = ?" );
+    static const auto idsReq = sqlite::StatementCache::registerRequest(
+            "SELECT id_media FROM " + policy::MediaTable::Name +
+            " WHERE play_count > 0 OR last_played_date IS NOT NULL"
+            " UNION SELECT id_media FROM " + policy::MediaMetadataTable::Name +
+            " WHERE type = ?" );
+    std::vector<int64_t> mediaIds;
+    sqlite::Tools::forEachRow( ml, idsReq, [&mediaIds]( sqlite::Row& row ) {
+        mediaIds.push_back( row.load<int64_t>( 0 ) );
+    }, IMedia::MetadataType::Progress );
     sqlite::Tools::executeUpdate( dbConn, req );
     sqlite::Tools::executeDelete( dbConn, flushProgress, IMedia::MetadataType::Progress );
+    return mediaIds;
 }
 
 bool Media::MediaMetadata::isSet() const
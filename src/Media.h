@@ -56,7 +56,7 @@ struct MediaMetadataTable
 };
 }
 
-class Media : public IMedia, public DatabaseHelpers<Media, policy::MediaTable>
+class Media : public IMedia, public DatabaseHelpers<Media, policy::MediaTable, cachepolicy::Lru<Media>>
 {
     class MediaMetadata : public IMediaMetadata
     {
@@ -83,7 +83,20 @@ class Media : public IMedia, public DatabaseHelpers<Media, policy::MediaTable>
         Media( MediaLibraryPtr ml, const std::string &title, Type type);
 
         static std::shared_ptr<Media> create( MediaLibraryPtr ml, Type type, const std::string& fileName );
+        ///
+        /// \brief createBatch Creates one media per provided file name
+        /// This is equivalent to calling create() for each file name, but
+        /// only compiles the insertion request once. It is expected to be
+        /// called with a transaction in progress. Failures are reported
+        /// through exceptions, in which case no media is created once the
+        /// transaction is rolled back.
+        ///
+        static std::vector<std::shared_ptr<Media>> createBatch( MediaLibraryPtr ml, Type type,
+                                                                const std::vector<std::string>& fileNames );
+        size_t dynamicMemoryUsage() const;
+
         static bool createTable( DBConnection connection );
+        static bool createIndexes( DBConnection connection );
         static bool createTriggers( DBConnection connection );
 
         virtual int64_t id() const override;
@@ -137,10 +150,33 @@ class Media : public IMedia, public DatabaseHelpers<Media, policy::MediaTable>
         void removeFile( File& file );
 
         static std::vector<MediaPtr> listAll(MediaLibraryPtr ml, Type type , SortingCriteria sort, bool desc);
+        static Page<IMedia> listAll( MediaLibraryPtr ml, Type type, SortingCriteria sort, bool desc,
+                                     uint32_t pageSize, const std::string& continuation );
+        static std::vector<int64_t> listAllIds( MediaLibraryPtr ml, Type type, SortingCriteria sort, bool desc );
+        static uint32_t count( MediaLibraryPtr ml, Type type );
         static std::vector<MediaPtr> search( MediaLibraryPtr ml, const std::string& title );
-        static std::vector<MediaPtr> fetchHistory( MediaLibraryPtr ml );
-        static void clearHistory( MediaLibraryPtr ml );
+        static std::vector<MediaPtr> fetchHistory( MediaLibraryPtr ml, uint32_t nbMedia );
+        /// Returns the ids of the media whose history was cleared
+        static std::vector<int64_t> clearHistory( MediaLibraryPtr ml );
+        ///
+        /// \brief prefetch Loads the files & sub type entities of a listing at
+        /// once.
+        /// This is invoked by DatabaseHelpers for each media listing, when
+        /// eager loading is enabled.
+        ///
+        static void prefetch( MediaLibraryPtr ml, const std::vector<Media*>& media );
+        ///
+        /// \brief albumTracks Returns the album track of each provided media,
+        /// or nullptr for the media which aren't album tracks.
+        /// The album tracks which aren't cached yet are fetched at once.
+        ///
+        static std::vector<AlbumTrackPtr> albumTracks( MediaLibraryPtr ml, const std::vector<MediaPtr>& media );
 
+private:
+        static const sqlite::QueryTable& listAllTable();
+        template <typename T, typename Cell>
+        static std::vector<std::shared_ptr<T>> prefetchSubType( MediaLibraryPtr ml, const std::vector<Media*>& media,
+                                                                Cache<Cell> Media::* cell );
 
 private:
         MediaLibraryPtr m_ml;
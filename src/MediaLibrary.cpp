@@ -41,6 +41,7 @@
 #include "History.h"
 #include "Media.h"
 #include "MediaLibrary.h"
+#include "Migrations.h"
 #include "Label.h"
 #include "logging/Logger.h"
 #include "Movie.h"
@@ -50,6 +51,7 @@
 #include "ShowEpisode.h"
 #include "database/SqliteTools.h"
 #include "database/SqliteConnection.h"
+#include "database/SqliteReadSnapshot.h"
 #include "utils/Filename.h"
 #include "VideoTrack.h"
 
@@ -85,8 +87,14 @@ const char* const MediaLibrary::supportedExtensions[] = {
 const size_t MediaLibrary::NbSupportedExtensions = sizeof(supportedExtensions) / sizeof(supportedExtensions[0]);
 
 MediaLibrary::MediaLibrary()
-    : m_callback( nullptr )
+    : m_cacheStatsLogger( [this]() { logCacheStats(); } )
+    // Asynchronous requests are expected to come from a UI, a couple of
+    // threads are enough to avoid a slow request delaying the next ones.
+    , m_readExecutor( 2 )
+    , m_callback( nullptr )
     , m_verbosity( LogLevel::Error )
+    , m_preloadPolicy{ true, true, true, 100 }
+    , m_eagerLoading( false )
     , m_initialized( false )
     , m_discovererIdle( true )
     , m_parserIdle( true )
@@ -96,27 +104,20 @@ MediaLibrary::MediaLibrary()
 
 MediaLibrary::~MediaLibrary()
 {
+    // Asynchronous requests may be running on our behalf, ensure they are
+    // completed before tearing anything down.
+    m_readExecutor.stop();
+    m_cacheStatsLogger.stop();
     // Explicitely stop the discoverer, to avoid it writting while tearing down.
     if ( m_discovererWorker != nullptr )
         m_discovererWorker->stop();
     if ( m_parser != nullptr )
         m_parser->stop();
-    Media::clear();
-    Folder::clear();
-    Label::clear();
-    Album::clear();
-    AlbumTrack::clear();
-    Show::clear();
-    ShowEpisode::clear();
-    Movie::clear();
-    VideoTrack::clear();
-    AudioTrack::clear();
-    Artist::clear();
-    Device::clear();
-    File::clear();
-    Playlist::clear();
-    History::clear();
-    Genre::clear();
+    // Commit the deferred updates while the entities they refer to, and the
+    // caches they evict them from, are still around.
+    if ( m_dbConnection != nullptr )
+        m_dbConnection->flush();
+    m_caches.clear();
 }
 
 bool MediaLibrary::createAllTables()
@@ -149,7 +150,8 @@ bool MediaLibrary::createAllTables()
         Genre::createTriggers( m_dbConnection.get() ) &&
         Playlist::createTriggers( m_dbConnection.get() ) &&
         History::createTable( m_dbConnection.get() ) &&
-        Settings::createTable( m_dbConnection.get() );
+        Settings::createTable( m_dbConnection.get() ) &&
+        createAllIndexes();
     if ( res == false )
         return false;
     t->commit();
@@ -157,11 +159,20 @@ bool MediaLibrary::createAllTables()
 }
 
 template <typename T>
-static void propagateDeletionToCache( SqliteConnection::HookReason reason, int64_t rowId )
+static SqliteConnection::DeletionHookCb propagateDeletionToCache( MediaLibraryPtr ml )
 {
-    if ( reason != SqliteConnection::HookReason::Delete )
-        return;
-    T::removeFromCache( rowId );
+    return [ml]( const std::vector<int64_t>& rowIds ) {
+        T::removeFromCache( ml, rowIds );
+    };
+}
+
+bool MediaLibrary::createAllIndexes()
+{
+    return Media::createIndexes( m_dbConnection.get() ) &&
+        Album::createIndexes( m_dbConnection.get() ) &&
+        AlbumTrack::createIndexes( m_dbConnection.get() ) &&
+        Artist::createIndexes( m_dbConnection.get() ) &&
+        Playlist::createIndexes( m_dbConnection.get() );
 }
 
 void MediaLibrary::registerEntityHooks()
@@ -169,51 +180,41 @@ void MediaLibrary::registerEntityHooks()
     if ( m_modificationNotifier == nullptr )
         return;
 
-    m_dbConnection->registerUpdateHook( policy::MediaTable::Name,
-                                        [this]( SqliteConnection::HookReason reason, int64_t rowId ) {
-        if ( reason != SqliteConnection::HookReason::Delete )
-            return;
-        Media::removeFromCache( rowId );
-        m_modificationNotifier->notifyMediaRemoval( rowId );
+    m_dbConnection->registerDeletionHook( policy::MediaTable::Name,
+                                          [this]( const std::vector<int64_t>& rowIds ) {
+        Media::removeFromCache( this, rowIds );
+        m_modificationNotifier->notifyMediaRemoval( rowIds );
     });
-    m_dbConnection->registerUpdateHook( policy::ArtistTable::Name,
-                                        [this]( SqliteConnection::HookReason reason, int64_t rowId ) {
-        if ( reason != SqliteConnection::HookReason::Delete )
-            return;
-        Artist::removeFromCache( rowId );
-        m_modificationNotifier->notifyArtistRemoval( rowId );
+    m_dbConnection->registerDeletionHook( policy::ArtistTable::Name,
+                                          [this]( const std::vector<int64_t>& rowIds ) {
+        Artist::removeFromCache( this, rowIds );
+        m_modificationNotifier->notifyArtistRemoval( rowIds );
     });
-    m_dbConnection->registerUpdateHook( policy::AlbumTable::Name,
-                                        [this]( SqliteConnection::HookReason reason, int64_t rowId ) {
-        if ( reason != SqliteConnection::HookReason::Delete )
-            return;
-        Album::removeFromCache( rowId );
-        m_modificationNotifier->notifyAlbumRemoval( rowId );
+    m_dbConnection->registerDeletionHook( policy::AlbumTable::Name,
+                                          [this]( const std::vector<int64_t>& rowIds ) {
+        Album::removeFromCache( this, rowIds );
+        m_modificationNotifier->notifyAlbumRemoval( rowIds );
     });
-    m_dbConnection->registerUpdateHook( policy::AlbumTrackTable::Name,
-                                        [this]( SqliteConnection::HookReason reason, int64_t rowId ) {
-        if ( reason != SqliteConnection::HookReason::Delete )
-            return;
-        AlbumTrack::removeFromCache( rowId );
-        m_modificationNotifier->notifyAlbumTrackRemoval( rowId );
+    m_dbConnection->registerDeletionHook( policy::AlbumTrackTable::Name,
+                                          [this]( const std::vector<int64_t>& rowIds ) {
+        AlbumTrack::removeFromCache( this, rowIds );
+        m_modificationNotifier->notifyAlbumTrackRemoval( rowIds );
     });
-    m_dbConnection->registerUpdateHook( policy::PlaylistTable::Name,
-                                        [this]( SqliteConnection::HookReason reason, int64_t rowId ) {
-        if ( reason != SqliteConnection::HookReason::Delete )
-            return;
-        Playlist::removeFromCache( rowId );
-        m_modificationNotifier->notifyPlaylistRemoval( rowId );
+    m_dbConnection->registerDeletionHook( policy::PlaylistTable::Name,
+                                          [this]( const std::vector<int64_t>& rowIds ) {
+        Playlist::removeFromCache( this, rowIds );
+        m_modificationNotifier->notifyPlaylistRemoval( rowIds );
     });
-    m_dbConnection->registerUpdateHook( policy::DeviceTable::Name, &propagateDeletionToCache<Device> );
-    m_dbConnection->registerUpdateHook( policy::FileTable::Name, &propagateDeletionToCache<File> );
-    m_dbConnection->registerUpdateHook( policy::FolderTable::Name, &propagateDeletionToCache<Folder> );
-    m_dbConnection->registerUpdateHook( policy::GenreTable::Name, &propagateDeletionToCache<Genre> );
-    m_dbConnection->registerUpdateHook( policy::LabelTable::Name, &propagateDeletionToCache<Label> );
-    m_dbConnection->registerUpdateHook( policy::MovieTable::Name, &propagateDeletionToCache<Movie> );
-    m_dbConnection->registerUpdateHook( policy::ShowTable::Name, &propagateDeletionToCache<Show> );
-    m_dbConnection->registerUpdateHook( policy::ShowEpisodeTable::Name, &propagateDeletionToCache<ShowEpisode> );
-    m_dbConnection->registerUpdateHook( policy::AudioTrackTable::Name, &propagateDeletionToCache<AudioTrack> );
-    m_dbConnection->registerUpdateHook( policy::VideoTrackTable::Name, &propagateDeletionToCache<VideoTrack> );
+    m_dbConnection->registerDeletionHook( policy::DeviceTable::Name, propagateDeletionToCache<Device>( this ) );
+    m_dbConnection->registerDeletionHook( policy::FileTable::Name, propagateDeletionToCache<File>( this ) );
+    m_dbConnection->registerDeletionHook( policy::FolderTable::Name, propagateDeletionToCache<Folder>( this ) );
+    m_dbConnection->registerDeletionHook( policy::GenreTable::Name, propagateDeletionToCache<Genre>( this ) );
+    m_dbConnection->registerDeletionHook( policy::LabelTable::Name, propagateDeletionToCache<Label>( this ) );
+    m_dbConnection->registerDeletionHook( policy::MovieTable::Name, propagateDeletionToCache<Movie>( this ) );
+    m_dbConnection->registerDeletionHook( policy::ShowTable::Name, propagateDeletionToCache<Show>( this ) );
+    m_dbConnection->registerDeletionHook( policy::ShowEpisodeTable::Name, propagateDeletionToCache<ShowEpisode>( this ) );
+    m_dbConnection->registerDeletionHook( policy::AudioTrackTable::Name, propagateDeletionToCache<AudioTrack>( this ) );
+    m_dbConnection->registerDeletionHook( policy::VideoTrackTable::Name, propagateDeletionToCache<VideoTrack>( this ) );
 }
 
 bool MediaLibrary::validateSearchPattern( const std::string& pattern )
@@ -262,12 +263,10 @@ bool MediaLibrary::initialize( const std::string& dbPath, const std::string& thu
 
     try
     {
-        if ( createAllTables() == false )
-        {
-            LOG_ERROR( "Failed to create database structure" );
-            return false;
-        }
-        if ( m_settings.load( m_dbConnection.get() ) == false )
+        // Existing databases must be migrated before creating the missing
+        // tables, which always use the latest model.
+        if ( Settings::createTable( m_dbConnection.get() ) == false ||
+             m_settings.load( m_dbConnection.get() ) == false )
         {
             LOG_ERROR( "Failed to load settings" );
             return false;
@@ -280,6 +279,11 @@ bool MediaLibrary::initialize( const std::string& dbPath, const std::string& thu
                 return false;
             }
         }
+        if ( createAllTables() == false )
+        {
+            LOG_ERROR( "Failed to create database structure" );
+            return false;
+        }
     }
     catch ( const sqlite::errors::Generic& ex )
     {
@@ -300,6 +304,7 @@ bool MediaLibrary::start()
         refreshDevices( *fsFactory );
     startDiscoverer();
     startParser();
+    startPreload();
     return true;
 }
 
@@ -365,7 +370,7 @@ MediaPtr MediaLibrary::addMedia( const std::string& mrl )
 {
     try
     {
-        return sqlite::Tools::withRetries( 3, [this, &mrl]() -> MediaPtr {
+        return sqlite::Tools::withRetries( getConn(), 3, [this, &mrl]() -> MediaPtr {
             auto t = m_dbConnection->newTransaction();
             auto media = Media::create( this, IMedia::Type::Unknown, utils::file::fileName( mrl ) );
             if ( media == nullptr )
@@ -388,19 +393,48 @@ std::vector<MediaPtr> MediaLibrary::audioFiles( SortingCriteria sort, bool desc
     return Media::listAll( this, IMedia::Type::Audio, sort, desc );
 }
 
+Page<IMedia> MediaLibrary::audioFiles( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                       const std::string& continuation ) const
+{
+    return Media::listAll( this, IMedia::Type::Audio, sort, desc, pageSize, continuation );
+}
+
 std::vector<MediaPtr> MediaLibrary::videoFiles( SortingCriteria sort, bool desc ) const
 {
     return Media::listAll( this, IMedia::Type::Video, sort, desc );
 }
 
+Page<IMedia> MediaLibrary::videoFiles( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                       const std::string& continuation ) const
+{
+    return Media::listAll( this, IMedia::Type::Video, sort, desc, pageSize, continuation );
+}
+
+uint32_t MediaLibrary::nbAudioFiles() const
+{
+    return Media::count( this, IMedia::Type::Audio );
+}
+
+uint32_t MediaLibrary::nbVideoFiles() const
+{
+    return Media::count( this, IMedia::Type::Video );
+}
+
+std::vector<int64_t> MediaLibrary::audioFileIds( SortingCriteria sort, bool desc ) const
+{
+    return Media::listAllIds( this, IMedia::Type::Audio, sort, desc );
+}
+
+std::vector<int64_t> MediaLibrary::videoFileIds( SortingCriteria sort, bool desc ) const
+{
+    return Media::listAllIds( this, IMedia::Type::Video, sort, desc );
+}
+
 std::shared_ptr<Media> MediaLibrary::addFile( const fs::IFile& fileFs, Folder& parentFolder, fs::IDirectory& parentFolderFs )
 {
     auto type = IMedia::Type::Unknown;
 
-    if ( std::binary_search( std::begin( supportedExtensions ), std::end( supportedExtensions ),
-                             fileFs.extension().c_str(),
-                             [](const char* l, const char* r) { return strcasecmp( l, r ) < 0; }
-                            ) == false )
+    if ( isExtensionSupported( fileFs ) == false )
     {
         LOG_INFO( "Rejecting file ", fileFs.mrl(), " due to its extension" );
         return nullptr;
@@ -426,11 +460,55 @@ std::shared_ptr<Media> MediaLibrary::addFile( const fs::IFile& fileFs, Folder& p
     return mptr;
 }
 
+std::vector<std::shared_ptr<Media>> MediaLibrary::addFiles( const std::vector<std::shared_ptr<fs::IFile>>& filesFs,
+                                                            Folder& parentFolder, fs::IDirectory& parentFolderFs )
+{
+    std::vector<std::shared_ptr<fs::IFile>> acceptedFiles;
+    std::vector<std::string> fileNames;
+    for ( const auto& fileFs : filesFs )
+    {
+        if ( isExtensionSupported( *fileFs ) == false )
+        {
+            LOG_INFO( "Rejecting file ", fileFs->mrl(), " due to its extension" );
+            continue;
+        }
+        LOG_INFO( "Adding ", fileFs->mrl() );
+        acceptedFiles.push_back( fileFs );
+        fileNames.push_back( fileFs->name() );
+    }
+    if ( acceptedFiles.empty() == true )
+        return {};
+    auto media = Media::createBatch( this, IMedia::Type::Unknown, fileNames );
+    std::vector<int64_t> mediaIds;
+    mediaIds.reserve( media.size() );
+    for ( const auto& m : media )
+        mediaIds.push_back( m->id() );
+    // For now, assume all media are made of a single file
+    auto files = File::createBatch( this, mediaIds, File::Type::Main, acceptedFiles,
+                                    parentFolder.id(), parentFolderFs.device()->isRemovable() );
+    if ( m_parser != nullptr )
+    {
+        for ( auto i = 0u; i < media.size(); ++i )
+            m_parser->parse( media[i], files[i] );
+    }
+    return media;
+}
+
+bool MediaLibrary::isExtensionSupported( const fs::IFile& fileFs )
+{
+    return std::binary_search( std::begin( supportedExtensions ), std::end( supportedExtensions ),
+                               fileFs.extension().c_str(),
+                               [](const char* l, const char* r) { return strcasecmp( l, r ) < 0; } );
+}
+
 bool MediaLibrary::deleteFolder( const Folder& folder )
 {
+    // Media left without any file are deleted, and evicted through the
+    // deletion hook. The others have to be refetched along with their files.
+    auto mediaIds = Folder::subtreeMediaIds( this, folder.id() );
     if ( Folder::destroy( this, folder.id() ) == false )
         return false;
-    Media::clear();
+    Media::invalidate( this, mediaIds );
     return true;
 }
 
@@ -475,11 +553,43 @@ std::vector<AlbumPtr> MediaLibrary::albums( SortingCriteria sort, bool desc ) co
     return Album::listAll( this, sort, desc );
 }
 
+Page<IAlbum> MediaLibrary::albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                   const std::string& continuation ) const
+{
+    return Album::listAll( this, sort, desc, pageSize, continuation );
+}
+
+uint32_t MediaLibrary::nbAlbums() const
+{
+    return Album::count( this );
+}
+
+std::vector<int64_t> MediaLibrary::albumIds( SortingCriteria sort, bool desc ) const
+{
+    return Album::listAllIds( this, sort, desc );
+}
+
 std::vector<GenrePtr> MediaLibrary::genres( SortingCriteria sort, bool desc ) const
 {
     return Genre::listAll( this, sort, desc );
 }
 
+Page<IGenre> MediaLibrary::genres( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                   const std::string& continuation ) const
+{
+    return Genre::listAll( this, sort, desc, pageSize, continuation );
+}
+
+uint32_t MediaLibrary::nbGenres() const
+{
+    return Genre::count( this );
+}
+
+std::vector<int64_t> MediaLibrary::genreIds( SortingCriteria sort, bool desc ) const
+{
+    return Genre::listAllIds( this, sort, desc );
+}
+
 GenrePtr MediaLibrary::genre( int64_t id ) const
 {
     return Genre::fetch( this, id );
@@ -487,8 +597,9 @@ GenrePtr MediaLibrary::genre( int64_t id ) const
 
 ShowPtr MediaLibrary::show( const std::string& name ) const
 {
-    static const std::string req = "SELECT * FROM " + policy::ShowTable::Name
-            + " WHERE name = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::ShowTable::Name
+            + " WHERE name = ?" );
     return Show::fetch( this, req, name );
 }
 
@@ -499,8 +610,9 @@ std::shared_ptr<Show> MediaLibrary::createShow( const std::string& name )
 
 MoviePtr MediaLibrary::movie( const std::string& title ) const
 {
-    static const std::string req = "SELECT * FROM " + policy::MovieTable::Name
-            + " WHERE title = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::MovieTable::Name
+            + " WHERE title = ?" );
     return Movie::fetch( this, req, title );
 }
 
@@ -519,8 +631,9 @@ ArtistPtr MediaLibrary::artist( int64_t id ) const
 
 ArtistPtr MediaLibrary::artist( const std::string& name )
 {
-    static const std::string req = "SELECT * FROM " + policy::ArtistTable::Name
-            + " WHERE name = ? AND is_present = 1";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::ArtistTable::Name
+            + " WHERE name = ? AND is_present = 1" );
     return Artist::fetch( this, req, name );
 }
 
@@ -542,6 +655,22 @@ std::vector<ArtistPtr> MediaLibrary::artists( SortingCriteria sort, bool desc )
     return Artist::listAll( this, sort, desc );
 }
 
+Page<IArtist> MediaLibrary::artists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation ) const
+{
+    return Artist::listAll( this, sort, desc, pageSize, continuation );
+}
+
+uint32_t MediaLibrary::nbArtists() const
+{
+    return Artist::count( this );
+}
+
+std::vector<int64_t> MediaLibrary::artistIds( SortingCriteria sort, bool desc ) const
+{
+    return Artist::listAllIds( this, sort, desc );
+}
+
 PlaylistPtr MediaLibrary::createPlaylist( const std::string& name )
 {
     try
@@ -560,6 +689,22 @@ std::vector<PlaylistPtr> MediaLibrary::playlists( SortingCriteria sort, bool des
     return Playlist::listAll( this, sort, desc );
 }
 
+Page<IPlaylist> MediaLibrary::playlists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                         const std::string& continuation )
+{
+    return Playlist::listAll( this, sort, desc, pageSize, continuation );
+}
+
+uint32_t MediaLibrary::nbPlaylists() const
+{
+    return Playlist::count( this );
+}
+
+std::vector<int64_t> MediaLibrary::playlistIds( SortingCriteria sort, bool desc ) const
+{
+    return Playlist::listAllIds( this, sort, desc );
+}
+
 PlaylistPtr MediaLibrary::playlist( int64_t id ) const
 {
     return Playlist::fetch( this, id );
@@ -578,6 +723,109 @@ bool MediaLibrary::deletePlaylist( int64_t playlistId )
     }
 }
 
+void MediaLibrary::setQueryProfiling( bool enabled )
+{
+    m_dbConnection->profiler().setEnabled( enabled );
+}
+
+QueryProfile MediaLibrary::queryProfile( bool explain ) const
+{
+    auto profile = m_dbConnection->profiler().profile();
+    profile.busy = m_dbConnection->busyHandler().stats();
+    if ( explain == false )
+        return profile;
+    auto ctx = m_dbConnection->acquireReadContext();
+    auto dbConn = m_dbConnection->getConn();
+    for ( auto& q : profile.queries )
+        q.queryPlan = sqlite::QueryProfiler::explain( dbConn, q.sql );
+    return profile;
+}
+
+void MediaLibrary::resetQueryProfile()
+{
+    m_dbConnection->profiler().reset();
+    m_dbConnection->busyHandler().reset();
+}
+
+void MediaLibrary::setBusyPolicy( const BusyPolicy& policy )
+{
+    m_dbConnection->busyHandler().setPolicy( policy );
+}
+
+void MediaLibrary::setPreloadPolicy( const PreloadPolicy& policy )
+{
+    m_preloadPolicy = policy;
+}
+
+std::vector<CacheStats> MediaLibrary::cacheStats() const
+{
+    return m_caches.stats();
+}
+
+void MediaLibrary::setCacheBudget( uint32_t maxEntities )
+{
+    m_caches.setCapacity( maxEntities );
+}
+
+void MediaLibrary::setCacheBudget( const std::string& entity, uint32_t maxEntities,
+                                   uint64_t maxBytes )
+{
+    m_caches.setBudget( entity, maxEntities, static_cast<size_t>( maxBytes ) );
+}
+
+void MediaLibrary::setCacheStatsLogging( std::chrono::seconds interval )
+{
+    m_cacheStatsLogger.start( interval );
+}
+
+void MediaLibrary::setEagerLoading( bool enabled )
+{
+    m_eagerLoading = enabled;
+}
+
+bool MediaLibrary::isEagerLoadingEnabled() const
+{
+    return m_eagerLoading.load( std::memory_order_relaxed );
+}
+
+void MediaLibrary::logCacheStats() const
+{
+    for ( const auto& s : m_caches.stats() )
+    {
+        LOG_INFO( s.entity, " cache: ", s.nbEntities, " entities (~", s.nbBytes / 1024, "KiB), ",
+                  s.nbHits, " hits, ", s.nbMisses, " misses, ", s.nbInserts, " inserts, ",
+                  s.nbEvictions, " evictions" );
+    }
+}
+
+void MediaLibrary::preloadCaches()
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t nbEntities = 0;
+    try
+    {
+        // Each fetchAll call loads its entities in cache with a single scan
+        if ( m_preloadPolicy.artists == true )
+            nbEntities += Artist::fetchAll<IArtist>( this ).size();
+        if ( m_preloadPolicy.albums == true )
+            nbEntities += Album::fetchAll<IAlbum>( this ).size();
+        if ( m_preloadPolicy.genres == true )
+            nbEntities += Genre::fetchAll<IGenre>( this ).size();
+        if ( m_preloadPolicy.nbRecentMedia > 0 )
+            nbEntities += Media::fetchHistory( this, m_preloadPolicy.nbRecentMedia ).size();
+    }
+    catch ( const std::exception& ex )
+    {
+        LOG_ERROR( "Failed to preload entities: ", ex.what() );
+        return;
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start );
+    LOG_INFO( "Preloaded ", nbEntities, " entities in ", duration.count(), "ms" );
+    if ( m_callback != nullptr )
+        m_callback->onCachePreloaded( duration );
+}
+
 bool MediaLibrary::addToStreamHistory( MediaPtr media )
 {
     try
@@ -598,21 +846,27 @@ std::vector<HistoryPtr> MediaLibrary::lastStreamsPlayed() const
 
 std::vector<MediaPtr> MediaLibrary::lastMediaPlayed() const
 {
-    return Media::fetchHistory( this );
+    return Media::fetchHistory( this, 100 );
 }
 
 bool MediaLibrary::clearHistory()
 {
     try
     {
-        return sqlite::Tools::withRetries( 3, [this]() {
+        std::vector<int64_t> mediaIds;
+        auto res = sqlite::Tools::withRetries( getConn(), 3, [this, &mediaIds]() {
             auto t = getConn()->newTransaction();
-            Media::clearHistory( this );
+            mediaIds = Media::clearHistory( this );
             if ( History::clearStreams( this ) == false )
                 return false;
             t->commit();
             return true;
         });
+        // Only evict once the transaction is committed, so a concurrent fetch
+        // can't cache the media back with their former history
+        if ( res == true )
+            Media::invalidate( this, mediaIds );
+        return res;
     }
     catch ( sqlite::errors::Generic& ex )
     {
@@ -687,6 +941,106 @@ SearchAggregate MediaLibrary::search( const std::string& pattern ) const
     return res;
 }
 
+template <typename T, typename F>
+std::future<T> MediaLibrary::runAsync( const std::string& key, F f ) const
+{
+    // std::function requires a copyable callable, hence the shared promise
+    auto p = std::make_shared<std::promise<T>>();
+    auto res = p->get_future();
+    m_readExecutor.run( [p, f]() {
+        try
+        {
+            p->set_value( f() );
+        }
+        catch ( ... )
+        {
+            p->set_exception( std::current_exception() );
+        }
+    }, key );
+    return res;
+}
+
+std::future<MediaPtr> MediaLibrary::mediaAsync( int64_t mediaId ) const
+{
+    return runAsync<MediaPtr>( {}, [this, mediaId]() {
+        return media( mediaId );
+    });
+}
+
+std::future<std::vector<MediaPtr>> MediaLibrary::audioFilesAsync( SortingCriteria sort, bool desc,
+                                                                  const std::string& key ) const
+{
+    return runAsync<std::vector<MediaPtr>>( key, [this, sort, desc]() {
+        return audioFiles( sort, desc );
+    });
+}
+
+std::future<std::vector<MediaPtr>> MediaLibrary::videoFilesAsync( SortingCriteria sort, bool desc,
+                                                                  const std::string& key ) const
+{
+    return runAsync<std::vector<MediaPtr>>( key, [this, sort, desc]() {
+        return videoFiles( sort, desc );
+    });
+}
+
+std::future<std::vector<AlbumPtr>> MediaLibrary::albumsAsync( SortingCriteria sort, bool desc,
+                                                              const std::string& key ) const
+{
+    return runAsync<std::vector<AlbumPtr>>( key, [this, sort, desc]() {
+        return albums( sort, desc );
+    });
+}
+
+std::future<std::vector<ArtistPtr>> MediaLibrary::artistsAsync( SortingCriteria sort, bool desc,
+                                                                const std::string& key ) const
+{
+    return runAsync<std::vector<ArtistPtr>>( key, [this, sort, desc]() {
+        return artists( sort, desc );
+    });
+}
+
+std::future<std::vector<GenrePtr>> MediaLibrary::genresAsync( SortingCriteria sort, bool desc,
+                                                              const std::string& key ) const
+{
+    return runAsync<std::vector<GenrePtr>>( key, [this, sort, desc]() {
+        return genres( sort, desc );
+    });
+}
+
+std::future<std::vector<PlaylistPtr>> MediaLibrary::playlistsAsync( SortingCriteria sort, bool desc,
+                                                                    const std::string& key )
+{
+    return runAsync<std::vector<PlaylistPtr>>( key, [this, sort, desc]() {
+        return playlists( sort, desc );
+    });
+}
+
+std::future<MediaSearchAggregate> MediaLibrary::searchMediaAsync( const std::string& pattern,
+                                                                  const std::string& key ) const
+{
+    return runAsync<MediaSearchAggregate>( key, [this, pattern]() {
+        return searchMedia( pattern );
+    });
+}
+
+std::future<SearchAggregate> MediaLibrary::searchAsync( const std::string& pattern,
+                                                        const std::string& key ) const
+{
+    return runAsync<SearchAggregate>( key, [this, pattern]() {
+        return search( pattern );
+    });
+}
+
+void MediaLibrary::cancelAsync( const std::string& key ) const
+{
+    m_readExecutor.cancel( key );
+}
+
+ReadSnapshotPtr MediaLibrary::acquireReadSnapshot() const
+{
+    return ReadSnapshotPtr{ new sqlite::ReadSnapshot( m_dbConnection.get() ) };
+}
+
 void MediaLibrary::startParser()
 {
     m_parser.reset( new Parser( this ) );
@@ -700,6 +1054,13 @@ void MediaLibrary::startParser()
     m_parser->start();
 }
 
+void MediaLibrary::startPreload()
+{
+    m_readExecutor.run( [this]() {
+        preloadCaches();
+    }, "preload" );
+}
+
 void MediaLibrary::startDiscoverer()
 {
     m_discovererWorker.reset( new DiscovererWorker( this ) );
@@ -721,9 +1082,8 @@ void MediaLibrary::addLocalFsFactory()
 bool MediaLibrary::updateDatabaseModel( unsigned int previousVersion )
 {
     LOG_INFO( "Updating database model from ", previousVersion, " to ", Settings::DbModelVersion );
-    // Up until model 3, it's safer (and potentially more efficient with index changes) to drop the DB
-    // It's also way simpler to implement
-    if ( previousVersion <= 3 )
+    // Anything more recent than model 3 is migrated in place, see Migrations
+    if ( previousVersion < Migrations::OldestMigratableModel )
     {
         // Way too much differences, introduction of devices, and almost unused in the wild, just drop everything
         std::string req = "PRAGMA writable_schema = 1;"
@@ -733,15 +1093,11 @@ bool MediaLibrary::updateDatabaseModel( unsigned int previousVersion )
             return false;
         if ( createAllTables() == false )
             return false;
-        previousVersion = 3;
+        // The settings were dropped as well, reloading them will store the
+        // current model version, which is the one we just created.
+        return m_settings.load( getConn() );
     }
-    // To be continued in the future!
-
-    // Safety check: ensure we didn't forget a migration along the way
-    assert( previousVersion == Settings::DbModelVersion );
-    m_settings.setDbModelVersion( Settings::DbModelVersion );
-    m_settings.save();
-    return true;
+    return Migrations::run( getConn(), m_settings, Settings::DbModelVersion );
 }
 
 void MediaLibrary::reload()
@@ -811,6 +1167,11 @@ DBConnection MediaLibrary::getConn() const
     return m_dbConnection.get();
 }
 
+EntityCaches& MediaLibrary::caches() const
+{
+    return m_caches;
+}
+
 IMediaLibraryCb* MediaLibrary::getCb() const
 {
     return m_callback;
@@ -863,8 +1224,9 @@ void MediaLibrary::setDiscoverNetworkEnabled( bool enabled )
 
 std::vector<FolderPtr> MediaLibrary::entryPoints() const
 {
-    static const std::string req = "SELECT * FROM " + policy::FolderTable::Name + " WHERE parent_id IS NULL"
-            " AND is_blacklisted = 0";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::FolderTable::Name + " WHERE parent_id IS NULL"
+            " AND is_blacklisted = 0" );
     return Folder::fetchAll<IFolder>( this, req );
 }
 
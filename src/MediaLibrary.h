@@ -26,6 +26,9 @@
 #include "medialibrary/IMediaLibrary.h"
 #include "logging/Logger.h"
 #include "Settings.h"
+#include "database/EntityCaches.h"
+#include "utils/PeriodicTask.h"
+#include "utils/ReadExecutor.h"
 
 #include "medialibrary/IDeviceLister.h"
 
@@ -70,9 +73,25 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
         virtual MediaPtr media( const std::string& path ) const override;
         virtual MediaPtr addMedia( const std::string& mrl ) override;
         virtual std::vector<MediaPtr> audioFiles( SortingCriteria sort, bool desc) const override;
+        virtual Page<IMedia> audioFiles( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                         const std::string& continuation ) const override;
         virtual std::vector<MediaPtr> videoFiles( SortingCriteria sort, bool desc) const override;
+        virtual Page<IMedia> videoFiles( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                         const std::string& continuation ) const override;
+        virtual uint32_t nbAudioFiles() const override;
+        virtual uint32_t nbVideoFiles() const override;
+        virtual std::vector<int64_t> audioFileIds( SortingCriteria sort, bool desc ) const override;
+        virtual std::vector<int64_t> videoFileIds( SortingCriteria sort, bool desc ) const override;
 
         std::shared_ptr<Media> addFile( const fs::IFile& fileFs, Folder& parentFolder, fs::IDirectory& parentFolderFs );
+        ///
+        /// \brief addFiles Adds a batch of files from the same folder
+        /// This is equivalent to calling addFile() for each file, but inserts
+        /// all media and files using a single compiled request for each table.
+        /// It is meant to be called with a transaction in progress.
+        ///
+        std::vector<std::shared_ptr<Media>> addFiles( const std::vector<std::shared_ptr<fs::IFile>>& filesFs,
+                                                      Folder& parentFolder, fs::IDirectory& parentFolderFs );
 
         bool deleteFolder(const Folder& folder );
 
@@ -82,8 +101,16 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
         virtual AlbumPtr album( int64_t id ) const override;
         std::shared_ptr<Album> createAlbum( const std::string& title, const std::string& artworkMrl );
         virtual std::vector<AlbumPtr> albums(SortingCriteria sort, bool desc) const override;
+        virtual Page<IAlbum> albums( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation ) const override;
+        virtual uint32_t nbAlbums() const override;
+        virtual std::vector<int64_t> albumIds( SortingCriteria sort, bool desc ) const override;
 
         virtual std::vector<GenrePtr> genres( SortingCriteria sort, bool desc ) const override;
+        virtual Page<IGenre> genres( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation ) const override;
+        virtual uint32_t nbGenres() const override;
+        virtual std::vector<int64_t> genreIds( SortingCriteria sort, bool desc ) const override;
         virtual GenrePtr genre( int64_t id ) const override;
 
         virtual ShowPtr show( const std::string& name ) const override;
@@ -96,12 +123,38 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
         ArtistPtr artist( const std::string& name );
         std::shared_ptr<Artist> createArtist( const std::string& name );
         virtual std::vector<ArtistPtr> artists( SortingCriteria sort, bool desc ) const override;
+        virtual Page<IArtist> artists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                       const std::string& continuation ) const override;
+        virtual uint32_t nbArtists() const override;
+        virtual std::vector<int64_t> artistIds( SortingCriteria sort, bool desc ) const override;
 
         virtual PlaylistPtr createPlaylist( const std::string& name ) override;
         virtual std::vector<PlaylistPtr> playlists( SortingCriteria sort, bool desc ) override;
+        virtual Page<IPlaylist> playlists( SortingCriteria sort, bool desc, uint32_t pageSize,
+                                           const std::string& continuation ) override;
+        virtual uint32_t nbPlaylists() const override;
+        virtual std::vector<int64_t> playlistIds( SortingCriteria sort, bool desc ) const override;
         virtual PlaylistPtr playlist( int64_t id ) const override;
         virtual bool deletePlaylist( int64_t playlistId ) override;
 
+        virtual void setQueryProfiling( bool enabled ) override;
+        virtual QueryProfile queryProfile( bool explain ) const override;
+        virtual void resetQueryProfile() override;
+        virtual void setBusyPolicy( const BusyPolicy& policy ) override;
+        virtual void setPreloadPolicy( const PreloadPolicy& policy ) override;
+        virtual std::vector<CacheStats> cacheStats() const override;
+        virtual void setCacheBudget( uint32_t maxEntities ) override;
+        virtual void setCacheBudget( const std::string& entity, uint32_t maxEntities,
+                                     uint64_t maxBytes ) override;
+        virtual void setCacheStatsLogging( std::chrono::seconds interval ) override;
+        virtual void setEagerLoading( bool enabled ) override;
+        bool isEagerLoadingEnabled() const;
+        ///
+        /// \brief preloadCaches Loads the entities selected by the preload
+        /// policy in cache. This is run in the background after start()
+        ///
+        void preloadCaches();
+
         virtual bool addToStreamHistory( MediaPtr media ) override;
         virtual std::vector<HistoryPtr> lastStreamsPlayed() const override;
         virtual std::vector<MediaPtr> lastMediaPlayed() const override;
@@ -114,6 +167,26 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
         virtual std::vector<ArtistPtr> searchArtists( const std::string& name ) const override;
         virtual SearchAggregate search( const std::string& pattern ) const override;
 
+        virtual std::future<MediaPtr> mediaAsync( int64_t mediaId ) const override;
+        virtual std::future<std::vector<MediaPtr>> audioFilesAsync( SortingCriteria sort, bool desc,
+                                                                    const std::string& key ) const override;
+        virtual std::future<std::vector<MediaPtr>> videoFilesAsync( SortingCriteria sort, bool desc,
+                                                                    const std::string& key ) const override;
+        virtual std::future<std::vector<AlbumPtr>> albumsAsync( SortingCriteria sort, bool desc,
+                                                                const std::string& key ) const override;
+        virtual std::future<std::vector<ArtistPtr>> artistsAsync( SortingCriteria sort, bool desc,
+                                                                  const std::string& key ) const override;
+        virtual std::future<std::vector<GenrePtr>> genresAsync( SortingCriteria sort, bool desc,
+                                                                const std::string& key ) const override;
+        virtual std::future<std::vector<PlaylistPtr>> playlistsAsync( SortingCriteria sort, bool desc,
+                                                                      const std::string& key ) override;
+        virtual std::future<MediaSearchAggregate> searchMediaAsync( const std::string& pattern,
+                                                                    const std::string& key ) const override;
+        virtual std::future<SearchAggregate> searchAsync( const std::string& pattern,
+                                                          const std::string& key ) const override;
+        virtual void cancelAsync( const std::string& key ) const override;
+        virtual ReadSnapshotPtr acquireReadSnapshot() const override;
+
         virtual void discover( const std::string& entryPoint ) override;
         virtual void setDiscoverNetworkEnabled( bool enabled ) override;
         virtual std::vector<FolderPtr> entryPoints() const override;
@@ -134,6 +207,7 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
         void onParserIdleChanged( bool idle );
 
         DBConnection getConn() const;
+        EntityCaches& caches() const;
         IMediaLibraryCb* getCb() const;
         std::shared_ptr<ModificationNotifier> getNotifier() const;
 
@@ -145,16 +219,22 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
     protected:
         // Allow access to unit test MediaLibrary implementations
         static const char* const supportedExtensions[];
+        static bool isExtensionSupported( const fs::IFile& fileFs );
         static const size_t NbSupportedExtensions;
 
     private:
         virtual void startParser();
         virtual void startDiscoverer();
+        virtual void startPreload();
         virtual void startDeletionNotifier();
         bool updateDatabaseModel( unsigned int previousVersion );
         bool createAllTables();
+        bool createAllIndexes();
         void registerEntityHooks();
         static bool validateSearchPattern( const std::string& pattern );
+        void logCacheStats() const;
+        template <typename T, typename F>
+        std::future<T> runAsync( const std::string& key, F f ) const;
         // Returns true if the device actually changed
         bool onDeviceChanged( factory::IFileSystem& fsFactory, Device& device );
 
@@ -169,6 +249,11 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
 
     protected:
         std::unique_ptr<SqliteConnection> m_dbConnection;
+        // Mutable since entities are cached when loaded from const member functions
+        mutable EntityCaches m_caches;
+        PeriodicTask m_cacheStatsLogger;
+        // Mutable since asynchronous requests are queued from const member functions
+        mutable ReadExecutor m_readExecutor;
         std::vector<std::shared_ptr<factory::IFileSystem>> m_fsFactories;
         std::string m_thumbnailPath;
         IMediaLibraryCb* m_callback;
@@ -186,6 +271,8 @@ class MediaLibrary : public IMediaLibrary, public IDeviceListerCb
         std::shared_ptr<ModificationNotifier> m_modificationNotifier;
         LogLevel m_verbosity;
         Settings m_settings;
+        PreloadPolicy m_preloadPolicy;
+        std::atomic_bool m_eagerLoading;
         bool m_initialized;
         std::atomic_bool m_discovererIdle;
         std::atomic_bool m_parserIdle;
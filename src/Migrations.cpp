@@ -0,0 +1,109 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "Migrations.h"
+
+#include "Album.h"
+#include "AlbumTrack.h"
+#include "Artist.h"
+#include "Media.h"
+#include "Playlist.h"
+#include "Settings.h"
+#include "database/SqliteTools.h"
+#include "database/SqliteTransaction.h"
+#include "logging/Logger.h"
+
+namespace medialibrary
+{
+
+const uint32_t Migrations::OldestMigratableModel = 3u;
+
+Migrations::Step Migrations::step( uint32_t from )
+{
+    switch ( from )
+    {
+    case 3:
+        return &migrate3to4;
+    default:
+        return nullptr;
+    }
+}
+
+bool Migrations::runStep( DBConnection dbConn, Settings& settings, uint32_t from )
+{
+    auto s = step( from );
+    if ( s == nullptr )
+    {
+        LOG_ERROR( "No migration from database model ", from );
+        return false;
+    }
+    auto chrono = std::chrono::steady_clock::now();
+    try
+    {
+        auto t = dbConn->newTransaction();
+        if ( s( dbConn ) == false )
+            return false;
+        settings.setDbModelVersion( from + 1 );
+        if ( settings.save() == false )
+        {
+            settings.setDbModelVersion( from );
+            return false;
+        }
+        t->commit();
+    }
+    catch ( const sqlite::errors::Generic& )
+    {
+        // The version might have been saved before the commit failed
+        settings.setDbModelVersion( from );
+        throw;
+    }
+    auto duration = std::chrono::steady_clock::now() - chrono;
+    LOG_INFO( "Migrated database model from ", from, " to ", from + 1, " in ",
+              std::chrono::duration_cast<std::chrono::milliseconds>( duration ).count(), "ms" );
+    return true;
+}
+
+bool Migrations::run( DBConnection dbConn, Settings& settings, uint32_t to )
+{
+    while ( settings.dbModelVersion() < to )
+    {
+        if ( runStep( dbConn, settings, settings.dbModelVersion() ) == false )
+            return false;
+    }
+    return settings.dbModelVersion() == to;
+}
+
+bool Migrations::migrate3to4( DBConnection dbConn )
+{
+    // Model 4 only adds indexes for the most common lookups & listings
+    return Media::createIndexes( dbConn ) &&
+            Album::createIndexes( dbConn ) &&
+            AlbumTrack::createIndexes( dbConn ) &&
+            Artist::createIndexes( dbConn ) &&
+            Playlist::createIndexes( dbConn );
+}
+
+}
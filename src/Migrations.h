@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef MIGRATIONS_H
+#define MIGRATIONS_H
+
+#include "Types.h"
+
+#include <cstdint>
+
+namespace medialibrary
+{
+
+class Settings;
+
+///
+/// \brief The Migrations class upgrades an existing database model in place.
+///
+/// Each step migrates the database from one model version to the next one,
+/// by altering the tables, backfilling the new columns and rebuilding the
+/// indexes, without touching the existing content. Steps run in order, each
+/// in its own transaction along with the model version bump, so an
+/// interrupted upgrade resumes from the last completed step.
+///
+class Migrations
+{
+public:
+    using Step = bool(*)( DBConnection dbConn );
+
+    /// The oldest model which can be migrated in place. Older databases have
+    /// to be recreated from scratch.
+    static const uint32_t OldestMigratableModel;
+
+    ///
+    /// \brief step Returns the step migrating from model \p from to from + 1
+    /// \return The migration function, or nullptr if there is no such step.
+    ///
+    static Step step( uint32_t from );
+    ///
+    /// \brief runStep Runs a single step, and commits the new model version
+    /// along with the changes.
+    ///
+    static bool runStep( DBConnection dbConn, Settings& settings, uint32_t from );
+    ///
+    /// \brief run Runs all the steps required to upgrade the database from
+    /// the settings' model version to \p to
+    ///
+    static bool run( DBConnection dbConn, Settings& settings, uint32_t to );
+
+private:
+    static bool migrate3to4( DBConnection dbConn );
+};
+
+}
+
+#endif // MIGRATIONS_H
@@ -59,6 +59,11 @@ int64_t Movie::id() const
     return m_id;
 }
 
+int64_t Movie::mediaId() const
+{
+    return m_mediaId;
+}
+
 const std::string&Movie::title() const
 {
     return m_title;
@@ -71,8 +76,9 @@ const std::string& Movie::shortSummary() const
 
 bool Movie::setShortSummary( const std::string& summary )
 {
-    static const std::string req = "UPDATE " + policy::MovieTable::Name
-            + " SET summary = ? WHERE id_movie = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MovieTable::Name
+            + " SET summary = ? WHERE id_movie = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, summary, m_id ) == false )
         return false;
     m_summary = summary;
@@ -86,8 +92,9 @@ const std::string&Movie::artworkMrl() const
 
 bool Movie::setArtworkMrl( const std::string& artworkMrl )
 {
-    static const std::string req = "UPDATE " + policy::MovieTable::Name
-            + " SET artwork_mrl = ? WHERE id_movie = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MovieTable::Name
+            + " SET artwork_mrl = ? WHERE id_movie = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, artworkMrl, m_id ) == false )
         return false;
     m_artworkMrl = artworkMrl;
@@ -101,8 +108,9 @@ const std::string& Movie::imdbId() const
 
 bool Movie::setImdbId( const std::string& imdbId )
 {
-    static const std::string req = "UPDATE " + policy::MovieTable::Name
-            + " SET imdb_id = ? WHERE id_movie = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::MovieTable::Name
+            + " SET imdb_id = ? WHERE id_movie = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, imdbId, m_id ) == false )
         return false;
     m_imdbId = imdbId;
@@ -111,8 +119,9 @@ bool Movie::setImdbId( const std::string& imdbId )
 
 std::vector<MediaPtr> Movie::files()
 {
-    static const std::string req = "SELECT * FROM " + policy::MediaTable::Name
-            + " WHERE movie_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::MediaTable::Name
+            + " WHERE movie_id = ?" );
     return Media::fetchAll<IMedia>( m_ml, req, m_id );
 }
 
@@ -138,8 +147,9 @@ bool Movie::createTable( DBConnection dbConnection )
 std::shared_ptr<Movie> Movie::create(MediaLibraryPtr ml, int64_t mediaId, const std::string& title )
 {
     auto movie = std::make_shared<Movie>( ml, mediaId, title );
-    static const std::string req = "INSERT INTO " + policy::MovieTable::Name
-            + "(media_id, title) VALUES(?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::MovieTable::Name
+            + "(media_id, title) VALUES(?, ?)" );
     if ( insert( ml, movie, req, mediaId, title ) == false )
         return nullptr;
     return movie;
@@ -147,7 +157,8 @@ std::shared_ptr<Movie> Movie::create(MediaLibraryPtr ml, int64_t mediaId, const
 
 MoviePtr Movie::fromMedia( MediaLibraryPtr ml, int64_t mediaId )
 {
-    static const std::string req = "SELECT * FROM " + policy::MovieTable::Name + " WHERE media_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::MovieTable::Name + " WHERE media_id = ?" );
     return fetch( ml, req, mediaId );
 }
 
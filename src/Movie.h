@@ -49,6 +49,7 @@ class Movie : public IMovie, public DatabaseHelpers<Movie, policy::MovieTable>
         Movie( MediaLibraryPtr ml, int64_t mediaId, const std::string& title );
 
         virtual int64_t id() const override;
+        int64_t mediaId() const;
         virtual const std::string& title() const override;
         virtual const std::string& shortSummary() const override;
         bool setShortSummary(const std::string& summary);
@@ -57,8 +57,9 @@ Playlist::Playlist( MediaLibraryPtr ml, const std::string& name )
 std::shared_ptr<Playlist> Playlist::create( MediaLibraryPtr ml, const std::string& name )
 {
     auto self = std::make_shared<Playlist>( ml, name );
-    static const std::string req = "INSERT INTO " + policy::PlaylistTable::Name + \
-            "(name, creation_date) VALUES(?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::PlaylistTable::Name + \
+            "(name, creation_date) VALUES(?, ?)" );
     try
     {
         if ( insert( ml, self, req, name, self->m_creationDate ) == false )
@@ -86,7 +87,8 @@ bool Playlist::setName( const std::string& name )
 {
     if ( name == m_name )
         return true;
-    static const std::string req = "UPDATE " + policy::PlaylistTable::Name + " SET name = ? WHERE id_playlist = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::PlaylistTable::Name + " SET name = ? WHERE id_playlist = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, name, m_id ) == false )
         return false;
     m_name = name;
@@ -100,11 +102,20 @@ unsigned int Playlist::creationDate() const
 
 std::vector<MediaPtr> Playlist::media() const
 {
-    static const std::string req = "SELECT m.* FROM " + policy::MediaTable::Name + " m "
-            "LEFT JOIN PlaylistMediaRelation pmr ON pmr.media_id = m.id_media "
-            "WHERE pmr.playlist_id = ? AND m.is_present = 1 "
-            "ORDER BY pmr.position";
-    return Media::fetchAll<IMedia>( m_ml, req, m_id );
+    return media( 0, {} ).items;
+}
+
+Page<IMedia> Playlist::media( uint32_t pageSize, const std::string& continuation ) const
+{
+    static const sqlite::QueryTable table( []( SortingCriteria, bool ) {
+        return sqlite::KeysetQuery( "m.*",
+                policy::MediaTable::Name + " m "
+                    "LEFT JOIN PlaylistMediaRelation pmr ON pmr.media_id = m.id_media",
+                "pmr.playlist_id = ? AND m.is_present = 1",
+                { { "pmr.position", false } }, "m.id_media", SortingCriteria::Default, false );
+    });
+    return Media::fetchPage<IMedia>( m_ml, table, SortingCriteria::Default, false,
+                                     pageSize, continuation, m_id );
 }
 
 bool Playlist::append( int64_t mediaId )
@@ -114,7 +125,8 @@ bool Playlist::append( int64_t mediaId )
 
 bool Playlist::add( int64_t mediaId, unsigned int position )
 {
-    static const std::string req = "INSERT INTO PlaylistMediaRelation(media_id, playlist_id, position) VALUES(?, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO PlaylistMediaRelation(media_id, playlist_id, position) VALUES(?, ?, ?)" );
     // position isn't a foreign key, but we want it to be passed as NULL if it equals to 0
     // When the position is NULL, the insertion triggers takes care of counting the number of records to auto append.
     try
@@ -132,14 +144,16 @@ bool Playlist::move( int64_t mediaId, unsigned int position )
 {
     if ( position == 0 )
         return false;
-    static const std::string req = "UPDATE PlaylistMediaRelation SET position = ? WHERE "
-            "playlist_id = ? AND media_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE PlaylistMediaRelation SET position = ? WHERE "
+            "playlist_id = ? AND media_id = ?" );
     return sqlite::Tools::executeUpdate( m_ml->getConn(), req, position, m_id, mediaId );
 }
 
 bool Playlist::remove( int64_t mediaId )
 {
-    static const std::string req = "DELETE FROM PlaylistMediaRelation WHERE playlist_id = ? AND media_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "DELETE FROM PlaylistMediaRelation WHERE playlist_id = ? AND media_id = ?" );
     return sqlite::Tools::executeDelete( m_ml->getConn(), req, m_id, mediaId );
 }
 
@@ -170,6 +184,13 @@ bool Playlist::createTable( DBConnection dbConn )
             sqlite::Tools::executeRequest( dbConn, vtableReq );
 }
 
+bool Playlist::createIndexes( DBConnection dbConn )
+{
+    const std::string relIndexReq = "CREATE INDEX IF NOT EXISTS playlist_media_rel_position_idx ON "
+            "PlaylistMediaRelation(playlist_id, position, media_id)";
+    return sqlite::Tools::executeRequest( dbConn, relIndexReq );
+}
+
 bool Playlist::createTriggers( DBConnection dbConn )
 {
     static const std::string req = "CREATE TRIGGER IF NOT EXISTS update_playlist_order AFTER UPDATE OF position"
@@ -223,26 +244,50 @@ bool Playlist::createTriggers( DBConnection dbConn )
 
 std::vector<PlaylistPtr> Playlist::search( MediaLibraryPtr ml, const std::string& name )
 {
-    static const std::string req = "SELECT * FROM " + policy::PlaylistTable::Name + " WHERE id_playlist IN "
-            "(SELECT rowid FROM " + policy::PlaylistTable::Name + "Fts WHERE name MATCH '*' || ? || '*')";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::PlaylistTable::Name + " WHERE id_playlist IN "
+            "(SELECT rowid FROM " + policy::PlaylistTable::Name + "Fts WHERE name MATCH '*' || ? || '*')" );
     return fetchAll<IPlaylist>( ml, req, name );
 }
 
 std::vector<PlaylistPtr> Playlist::listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc )
 {
-    std::string req = "SELECT * FROM " + policy::PlaylistTable::Name + " ORDER BY ";
-    switch ( sort )
-    {
-    case SortingCriteria::InsertionDate:
-        req += "creation_date";
-        break;
-    default:
-        req += "name";
-        break;
-    }
-    if ( desc == true )
-        req += " DESC";
-    return fetchAll<IPlaylist>( ml, req );
+    return listAll( ml, sort, desc, 0, {} ).items;
+}
+
+const sqlite::QueryTable& Playlist::listAllTable()
+{
+    static const sqlite::QueryTable table( []( SortingCriteria sort, bool desc ) {
+        std::string key;
+        switch ( sort )
+        {
+        case SortingCriteria::InsertionDate:
+            key = "creation_date";
+            break;
+        default:
+            key = "name";
+            break;
+        }
+        return sqlite::KeysetQuery( "*", policy::PlaylistTable::Name, {},
+                                    { { std::move( key ), desc } }, "id_playlist", sort, desc );
+    });
+    return table;
+}
+
+Page<IPlaylist> Playlist::listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                                   uint32_t pageSize, const std::string& continuation )
+{
+    return fetchPage<IPlaylist>( ml, listAllTable(), sort, desc, pageSize, continuation );
+}
+
+std::vector<int64_t> Playlist::listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc )
+{
+    return fetchIds( ml, listAllTable(), sort, desc );
+}
+
+uint32_t Playlist::count( MediaLibraryPtr ml )
+{
+    return fetchCount( ml, listAllTable() );
 }
 
 }
@@ -56,17 +56,25 @@ public:
     virtual bool setName( const std::string& name ) override;
     virtual unsigned int creationDate() const override;
     virtual std::vector<MediaPtr> media() const override;
+    virtual Page<IMedia> media( uint32_t pageSize, const std::string& continuation ) const override;
     virtual bool append( int64_t mediaId ) override;
     virtual bool add( int64_t mediaId, unsigned int position ) override;
     virtual bool move( int64_t mediaId, unsigned int position ) override;
     virtual bool remove( int64_t mediaId ) override;
 
     static bool createTable( DBConnection dbConn );
+    static bool createIndexes( DBConnection dbConn );
     static bool createTriggers( DBConnection dbConn );
     static std::vector<PlaylistPtr> search( MediaLibraryPtr ml, const std::string& name );
     static std::vector<PlaylistPtr> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+    static Page<IPlaylist> listAll( MediaLibraryPtr ml, SortingCriteria sort, bool desc,
+                                    uint32_t pageSize, const std::string& continuation );
+    static std::vector<int64_t> listAllIds( MediaLibraryPtr ml, SortingCriteria sort, bool desc );
+    static uint32_t count( MediaLibraryPtr ml );
 
 private:
+    static const sqlite::QueryTable& listAllTable();
+
     MediaLibraryPtr m_ml;
 
     int64_t m_id;
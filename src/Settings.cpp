@@ -32,7 +32,7 @@
 namespace medialibrary
 {
 
-const uint32_t Settings::DbModelVersion = 3u;
+const uint32_t Settings::DbModelVersion = 4u;
 
 Settings::Settings()
     : m_dbConn( nullptr )
@@ -44,21 +44,26 @@ Settings::Settings()
 bool Settings::load( DBConnection dbConn )
 {
     m_dbConn = dbConn;
-    sqlite::Statement s( m_dbConn->getConn(), "SELECT * FROM Settings" );
-    auto row = s.row();
+    bool found;
+    {
+        auto ctx = m_dbConn->acquireReadContext();
+        sqlite::Statement s( m_dbConn, "SELECT * FROM Settings" );
+        auto row = s.row();
+        found = row != nullptr;
+        if ( found == true )
+        {
+            row >> m_dbModelVersion;
+            // safety check: there sould only be one row
+            assert( s.row() == nullptr );
+        }
+    }
     // First launch: no settings
-    if ( row == nullptr )
+    if ( found == false )
     {
         if ( sqlite::Tools::executeInsert( m_dbConn, "INSERT INTO Settings VALUES(?)", DbModelVersion ) == false )
             return false;
         m_dbModelVersion = DbModelVersion;
     }
-    else
-    {
-        row >> m_dbModelVersion;
-        // safety check: there sould only be one row
-        assert( s.row() == nullptr );
-    }
     return true;
 }
 
@@ -69,7 +74,8 @@ uint32_t Settings::dbModelVersion() const
 
 bool Settings::save()
 {
-    static const std::string req = "UPDATE Settings SET db_model_version = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE Settings SET db_model_version = ?" );
     if ( m_changed == false )
         return true;
     if ( sqlite::Tools::executeUpdate( m_dbConn, req, m_dbModelVersion ) == true )
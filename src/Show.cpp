@@ -75,8 +75,9 @@ time_t Show::releaseDate() const
 
 bool Show::setReleaseDate( time_t date )
 {
-    static const std::string req = "UPDATE " + policy::ShowTable::Name
-            + " SET release_date = ? WHERE id_show = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowTable::Name
+            + " SET release_date = ? WHERE id_show = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, date, m_id ) == false )
         return false;
     m_releaseDate = date;
@@ -90,8 +91,9 @@ const std::string& Show::shortSummary() const
 
 bool Show::setShortSummary( const std::string& summary )
 {
-    static const std::string req = "UPDATE " + policy::ShowTable::Name
-            + " SET short_summary = ? WHERE id_show = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowTable::Name
+            + " SET short_summary = ? WHERE id_show = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, summary, m_id ) == false )
         return false;
     m_shortSummary = summary;
@@ -105,8 +107,9 @@ const std::string& Show::artworkMrl() const
 
 bool Show::setArtworkMrl( const std::string& artworkMrl )
 {
-    static const std::string req = "UPDATE " + policy::ShowTable::Name
-            + " SET artwork_mrl = ? WHERE id_show = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowTable::Name
+            + " SET artwork_mrl = ? WHERE id_show = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, artworkMrl, m_id ) == false )
         return false;
     m_artworkMrl = artworkMrl;
@@ -120,8 +123,9 @@ const std::string& Show::tvdbId()
 
 bool Show::setTvdbId( const std::string& tvdbId )
 {
-    static const std::string req = "UPDATE " + policy::ShowTable::Name
-            + " SET tvdb_id = ? WHERE id_show = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowTable::Name
+            + " SET tvdb_id = ? WHERE id_show = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, tvdbId, m_id ) == false )
         return false;
     m_tvdbId = tvdbId;
@@ -138,8 +142,9 @@ std::shared_ptr<ShowEpisode> Show::addEpisode( Media& media, const std::string&
 
 std::vector<ShowEpisodePtr> Show::episodes()
 {
-    static const std::string req = "SELECT * FROM " + policy::ShowEpisodeTable::Name
-            + " WHERE show_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::ShowEpisodeTable::Name
+            + " WHERE show_id = ?" );
     return ShowEpisode::fetchAll<IShowEpisode>( m_ml, req, m_id );
 }
 
@@ -159,8 +164,9 @@ bool Show::createTable( DBConnection dbConnection )
 std::shared_ptr<Show> Show::create( MediaLibraryPtr ml, const std::string& name )
 {
     auto show = std::make_shared<Show>( ml, name );
-    static const std::string req = "INSERT INTO " + policy::ShowTable::Name
-            + "(name) VALUES(?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::ShowTable::Name
+            + "(name) VALUES(?)" );
     if ( insert( ml, show, req, name ) == false )
         return nullptr;
     return show;
@@ -66,6 +66,11 @@ int64_t ShowEpisode::id() const
     return m_id;
 }
 
+int64_t ShowEpisode::mediaId() const
+{
+    return m_mediaId;
+}
+
 const std::string& ShowEpisode::artworkMrl() const
 {
     return m_artworkMrl;
@@ -73,8 +78,9 @@ const std::string& ShowEpisode::artworkMrl() const
 
 bool ShowEpisode::setArtworkMrl( const std::string& artworkMrl )
 {
-    static const std::string req = "UPDATE " + policy::ShowEpisodeTable::Name
-            + " SET artwork_mrl = ? WHERE id_episode = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowEpisodeTable::Name
+            + " SET artwork_mrl = ? WHERE id_episode = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, artworkMrl, m_id ) == false )
         return false;
     m_artworkMrl = artworkMrl;
@@ -98,8 +104,9 @@ unsigned int ShowEpisode::seasonNumber() const
 
 bool ShowEpisode::setSeasonNumber( unsigned int seasonNumber )
 {
-    static const std::string req = "UPDATE " + policy::ShowEpisodeTable::Name
-            + " SET season_number = ? WHERE id_episode = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowEpisodeTable::Name
+            + " SET season_number = ? WHERE id_episode = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, seasonNumber, m_id ) == false )
         return false;
     m_seasonNumber = seasonNumber;
@@ -113,8 +120,9 @@ const std::string& ShowEpisode::shortSummary() const
 
 bool ShowEpisode::setShortSummary( const std::string& summary )
 {
-    static const std::string req = "UPDATE " + policy::ShowEpisodeTable::Name
-            + " SET episode_summary = ? WHERE id_episode = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowEpisodeTable::Name
+            + " SET episode_summary = ? WHERE id_episode = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, summary, m_id ) == false )
         return false;
     m_shortSummary = summary;
@@ -128,8 +136,9 @@ const std::string& ShowEpisode::tvdbId() const
 
 bool ShowEpisode::setTvdbId( const std::string& tvdbId )
 {
-    static const std::string req = "UPDATE " + policy::ShowEpisodeTable::Name
-            + " SET tvdb_id = ? WHERE id_episode = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "UPDATE " + policy::ShowEpisodeTable::Name
+            + " SET tvdb_id = ? WHERE id_episode = ?" );
     if ( sqlite::Tools::executeUpdate( m_ml->getConn(), req, tvdbId, m_id ) == false )
         return false;
     m_tvdbId = tvdbId;
@@ -147,8 +156,9 @@ std::shared_ptr<IShow> ShowEpisode::show()
 
 std::vector<MediaPtr> ShowEpisode::files()
 {
-    static const std::string req = "SELECT * FROM " + policy::MediaTable::Name
-            + " WHERE show_episode_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::MediaTable::Name
+            + " WHERE show_episode_id = ?" );
     return Media::fetchAll<IMedia>( m_ml, req, m_id );
 }
 
@@ -179,8 +189,9 @@ bool ShowEpisode::createTable( DBConnection dbConnection )
 std::shared_ptr<ShowEpisode> ShowEpisode::create( MediaLibraryPtr ml, int64_t mediaId, const std::string& title, unsigned int episodeNumber, int64_t showId )
 {
     auto episode = std::make_shared<ShowEpisode>( ml, mediaId, title, episodeNumber, showId );
-    static const std::string req = "INSERT INTO " + policy::ShowEpisodeTable::Name
-            + "(media_id, episode_number, title, show_id) VALUES(?, ? , ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::ShowEpisodeTable::Name
+            + "(media_id, episode_number, title, show_id) VALUES(?, ? , ?, ?)" );
     if ( insert( ml, episode, req, mediaId, episodeNumber, title, showId ) == false )
         return nullptr;
     return episode;
@@ -188,7 +199,8 @@ std::shared_ptr<ShowEpisode> ShowEpisode::create( MediaLibraryPtr ml, int64_t me
 
 ShowEpisodePtr ShowEpisode::fromMedia( MediaLibraryPtr ml, int64_t mediaId )
 {
-    static const std::string req = "SELECT * FROM " + policy::ShowEpisodeTable::Name + " WHERE media_id = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::ShowEpisodeTable::Name + " WHERE media_id = ?" );
     return fetch( ml, req, mediaId );
 }
 
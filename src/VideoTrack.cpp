@@ -98,8 +98,9 @@ std::shared_ptr<VideoTrack> VideoTrack::create( MediaLibraryPtr ml, const std::s
                                                 unsigned int height, float fps, int64_t mediaId,
                                                 const std::string& language, const std::string& description )
 {
-    static const std::string req  = "INSERT INTO " + policy::VideoTrackTable::Name
-            + "(codec, width, height, fps, media_id, language, description) VALUES(?, ?, ?, ?, ?, ?, ?)";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "INSERT INTO " + policy::VideoTrackTable::Name
+            + "(codec, width, height, fps, media_id, language, description) VALUES(?, ?, ?, ?, ?, ?, ?)" );
     auto track = std::make_shared<VideoTrack>( ml, codec, width, height, fps, mediaId, language, description );
     if ( insert( ml, track, req, codec, width, height, fps, mediaId, language, description ) == false )
         return nullptr;
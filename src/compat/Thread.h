@@ -216,11 +216,12 @@ namespace this_thread
     template <typename Rep, typename Period>
     inline void sleep_for( const std::chrono::duration<Rep, Period>& duration )
     {
-        auto d = std::chrono::duration_cast<std::chrono::milliseconds>( duration );
 #ifdef _WIN32
+        auto d = std::chrono::duration_cast<std::chrono::milliseconds>( duration );
         Sleep( d.count() );
 #else
-        usleep( d.count() * 1000 );
+        auto d = std::chrono::duration_cast<std::chrono::microseconds>( duration );
+        usleep( d.count() );
 #endif
     }
 }
@@ -22,11 +22,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <list>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "compat/Mutex.h"
+#include "SqliteKeysetQuery.h"
+#include "SqliteQueryTable.h"
+#include "SqliteReadSnapshot.h"
 #include "SqliteTools.h"
 #include "SqliteTransaction.h"
 
@@ -36,99 +41,554 @@ namespace medialibrary
 namespace cachepolicy
 {
 
+namespace details
+{
+
+constexpr unsigned DefaultNbShards = 16;
+
+// Entities can report the memory they use on top of their own size, mostly
+// for the strings they hold, through a dynamicMemoryUsage() member function
+template <typename T>
+auto dynamicMemoryUsage( const T& t, int ) -> decltype( t.dynamicMemoryUsage() )
+{
+    return t.dynamicMemoryUsage();
+}
+
+template <typename T>
+size_t dynamicMemoryUsage( const T&, long )
+{
+    return 0;
+}
+
+template <typename T>
+size_t memoryUsage( const T& t )
+{
+    return sizeof( T ) + dynamicMemoryUsage( t, 0 );
+}
+
+///
+/// \brief MapStore Unbounded store, keeping every entity ever loaded
+///
 template <typename T>
-struct Cached
+class MapStore
 {
 private:
-    using Lock = std::unique_lock<compat::Mutex>;
-    static std::unordered_map<int64_t, std::shared_ptr<T>> Store;
-    static compat::Mutex Mutex;
+    struct Entry
+    {
+        std::shared_ptr<T> value;
+        size_t nbBytes;
+    };
+
+public:
+    bool contains( int64_t key ) const
+    {
+        return m_store.find( key ) != end( m_store );
+    }
+
+    void save( int64_t key, std::shared_ptr<T> value )
+    {
+        auto& entry = m_store[key];
+        m_nbBytes -= entry.nbBytes;
+        entry.nbBytes = memoryUsage( *value );
+        entry.value = std::move( value );
+        m_nbBytes += entry.nbBytes;
+    }
+
+    std::shared_ptr<T> remove( int64_t key )
+    {
+        auto it = m_store.find( key );
+        if ( it == end( m_store ) )
+            return nullptr;
+        auto value = std::move( it->second.value );
+        m_nbBytes -= it->second.nbBytes;
+        m_store.erase( it );
+        return value;
+    }
+
+    std::shared_ptr<T> load( int64_t key )
+    {
+        auto it = m_store.find( key );
+        if ( it == end( m_store ) )
+            return nullptr;
+        return it->second.value;
+    }
+
+    std::shared_ptr<T> peek( int64_t key ) const
+    {
+        auto it = m_store.find( key );
+        if ( it == end( m_store ) )
+            return nullptr;
+        return it->second.value;
+    }
+
+    void clear()
+    {
+        m_store.clear();
+        m_nbBytes = 0;
+    }
+
+    size_t size() const
+    {
+        return m_store.size();
+    }
+
+    size_t nbBytes() const
+    {
+        return m_nbBytes;
+    }
+
+    uint64_t nbEvictions() const
+    {
+        return 0;
+    }
+
+    // The store is unbounded
+    void setCapacity( size_t )
+    {
+    }
+
+    void setMaxBytes( size_t )
+    {
+    }
+
+private:
+    std::unordered_map<int64_t, Entry> m_store;
+    size_t m_nbBytes = 0;
+};
+
+///
+/// \brief LruStore Bounded store, evicting the least recently used entities
+/// once more than its capacity of them are stored.
+/// Entities which are still referenced outside of the store are never evicted,
+/// so that a given record keeps being represented by a single instance while
+/// it is in use. This means the store can temporarily grow over its capacity.
+///
+template <typename T, size_t DefaultCapacity>
+class LruStore
+{
+private:
+    struct Entry
+    {
+        int64_t key;
+        std::shared_ptr<T> value;
+        size_t nbBytes;
+    };
+
+    // Maximum number of entities to look at for each eviction. This bounds
+    // the cost of an insertion when most of the stored entities are in use
+    static constexpr unsigned MaxEvictionScan = 8;
 
 public:
-    static Lock lock()
+    // 0 restores the default capacity
+    void setCapacity( size_t capacity )
+    {
+        m_capacity = capacity != 0 ? capacity : DefaultCapacity;
+        evict();
+    }
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    // 0 disables the memory limit
+    void setMaxBytes( size_t maxBytes )
     {
-        return Lock{ Mutex };
+        m_maxBytes = maxBytes;
+        evict();
     }
 
-    static void insert( int64_t key, std::shared_ptr<T> value )
+    bool contains( int64_t key ) const
+    {
+        return m_index.find( key ) != end( m_index );
+    }
+
+    void save( int64_t key, std::shared_ptr<T> value )
+    {
+        auto nbBytes = memoryUsage( *value );
+        auto it = m_index.find( key );
+        if ( it != end( m_index ) )
+        {
+            m_nbBytes -= it->second->nbBytes;
+            it->second->value = std::move( value );
+            it->second->nbBytes = nbBytes;
+            m_nbBytes += nbBytes;
+            m_entries.splice( begin( m_entries ), m_entries, it->second );
+            evict();
+            return;
+        }
+        m_entries.push_front( Entry{ key, std::move( value ), nbBytes } );
+        m_index.emplace( key, begin( m_entries ) );
+        m_nbBytes += nbBytes;
+        evict();
+    }
+
+    std::shared_ptr<T> remove( int64_t key )
+    {
+        auto it = m_index.find( key );
+        if ( it == end( m_index ) )
+            return nullptr;
+        auto value = std::move( it->second->value );
+        m_nbBytes -= it->second->nbBytes;
+        m_entries.erase( it->second );
+        m_index.erase( it );
+        return value;
+    }
+
+    std::shared_ptr<T> load( int64_t key )
+    {
+        auto it = m_index.find( key );
+        if ( it == end( m_index ) )
+            return nullptr;
+        m_entries.splice( begin( m_entries ), m_entries, it->second );
+        return it->second->value;
+    }
+
+    // Same as load, without marking the entity as recently used
+    std::shared_ptr<T> peek( int64_t key ) const
+    {
+        auto it = m_index.find( key );
+        if ( it == end( m_index ) )
+            return nullptr;
+        return it->second->value;
+    }
+
+    void clear()
+    {
+        m_index.clear();
+        m_entries.clear();
+        m_nbBytes = 0;
+    }
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    size_t nbBytes() const
+    {
+        return m_nbBytes;
+    }
+
+    uint64_t nbEvictions() const
+    {
+        return m_nbEvictions;
+    }
+
+private:
+    void evict()
+    {
+        auto nbScanned = 0u;
+        auto it = end( m_entries );
+        while ( ( m_entries.size() > m_capacity ||
+                  ( m_maxBytes != 0 && m_nbBytes > m_maxBytes ) ) &&
+                it != begin( m_entries ) && nbScanned++ < MaxEvictionScan )
+        {
+            --it;
+            if ( it->value.use_count() > 1 )
+                continue;
+            m_nbBytes -= it->nbBytes;
+            m_index.erase( it->key );
+            it = m_entries.erase( it );
+            ++m_nbEvictions;
+        }
+    }
+
+private:
+    // Most recently used entities come first
+    std::list<Entry> m_entries;
+    std::unordered_map<int64_t, typename std::list<Entry>::iterator> m_index;
+    size_t m_capacity = DefaultCapacity;
+    size_t m_maxBytes = 0;
+    size_t m_nbBytes = 0;
+    uint64_t m_nbEvictions = 0;
+};
+
+template <typename T, size_t DefaultCapacity>
+constexpr unsigned LruStore<T, DefaultCapacity>::MaxEvictionScan;
+
+///
+/// \brief Sharded Spreads the cached entities over NbShards stores, each one
+/// with its own mutex, so that loading entities with different ids from
+/// multiple threads doesn't serialize on a single lock.
+///
+template <typename T, typename Store, unsigned NbShards>
+class Sharded
+{
+private:
+    using Lock = std::unique_lock<compat::Mutex>;
+
+    struct Shard
+    {
+        compat::Mutex mutex;
+        Store store;
+        uint64_t nbHits = 0;
+        uint64_t nbMisses = 0;
+        uint64_t nbInserts = 0;
+    };
+
+    Shard& shard( int64_t key )
+    {
+        // Primary keys are sequential, which spreads them evenly
+        return m_shards[static_cast<uint64_t>( key ) % NbShards];
+    }
+
+    void save( int64_t key, std::shared_ptr<T> value )
+    {
+        auto& s = shard( key );
+        Lock l{ s.mutex };
+        assert( s.store.contains( key ) == false );
+        s.store.save( key, std::move( value ) );
+        ++s.nbInserts;
+    }
+
+public:
+    static constexpr unsigned ShardCount = NbShards;
+
+    void insert( int64_t key, std::shared_ptr<T> value )
     {
-        assert( Store.find( key ) == end( Store ) );
         if ( sqlite::Transaction::transactionInProgress() == true )
         {
-            sqlite::Transaction::onCurrentTransactionFailure( [key](){
-                auto l = lock();
-                auto removed = remove( key );
-                assert( removed != nullptr );
+            // The entity might have been evicted already
+            sqlite::Transaction::onCurrentTransactionFailure( [this, key](){
+                remove( key );
             });
         }
         save( key, std::move( value ) );
     }
 
-    static void save( int64_t key, std::shared_ptr<T> value )
+    ///
+    /// \brief insert Caches a batch of newly inserted records
+    /// Only one rollback handler is registered for the whole batch
+    ///
+    void insert( const std::vector<int64_t>& keys, const std::vector<std::shared_ptr<T>>& values )
     {
-        Store[key] = std::move( value );
+        assert( keys.size() == values.size() );
+        if ( sqlite::Transaction::transactionInProgress() == true )
+        {
+            sqlite::Transaction::onCurrentTransactionFailure( [this, keys](){
+                for ( auto key : keys )
+                    remove( key );
+            });
+        }
+        for ( auto i = 0u; i < keys.size(); ++i )
+            save( keys[i], values[i] );
     }
 
-    static std::shared_ptr<T> remove( int64_t key )
+    ///
+    /// \brief load Returns the cached entity, or caches & returns the one
+    /// provided by create() if there is none.
+    /// create() is invoked with the shard locked, so concurrent loads of the
+    /// same record yield the same instance.
+    ///
+    template <typename F>
+    std::shared_ptr<T> load( int64_t key, F&& create )
     {
-        auto it = Store.find( key );
-        if ( it != end( Store ) )
+        auto& s = shard( key );
+        Lock l{ s.mutex };
+        auto res = s.store.load( key );
+        if ( res != nullptr )
         {
-            auto value = std::move( it->second );
-            Store.erase( it );
-            return value;
+            ++s.nbHits;
+            return res;
         }
-        return nullptr;
+        ++s.nbMisses;
+        res = create();
+        s.store.save( key, res );
+        ++s.nbInserts;
+        return res;
     }
 
-    static void clear()
+    ///
+    /// \brief load Returns the cached entity if any
+    /// Not finding the entity isn't accounted as a miss, since the caller is
+    /// expected to load it from the database, which will account for it.
+    ///
+    std::shared_ptr<T> load( int64_t key )
     {
-        Store.clear();
+        auto& s = shard( key );
+        Lock l{ s.mutex };
+        auto res = s.store.load( key );
+        if ( res != nullptr )
+            ++s.nbHits;
+        return res;
     }
 
-    static std::shared_ptr<T> load( int64_t key )
+    ///
+    /// \brief peek Returns the cached entity if any, without accounting for
+    /// a hit, nor marking the entity as recently used
+    ///
+    std::shared_ptr<T> peek( int64_t key )
     {
-        auto it = Store.find( key );
-        if ( it == Store.end() )
-            return nullptr;
-        return it->second;
+        auto& s = shard( key );
+        Lock l{ s.mutex };
+        return s.store.peek( key );
+    }
+
+    std::shared_ptr<T> remove( int64_t key )
+    {
+        auto& s = shard( key );
+        Lock l{ s.mutex };
+        return s.store.remove( key );
+    }
+
+    void clear()
+    {
+        for ( auto& s : m_shards )
+        {
+            Lock l{ s.mutex };
+            s.store.clear();
+        }
+    }
+
+    size_t size()
+    {
+        size_t res = 0;
+        for ( auto& s : m_shards )
+        {
+            Lock l{ s.mutex };
+            res += s.store.size();
+        }
+        return res;
+    }
+
+    ///
+    /// \brief setCapacity Sets the maximum number of cached entities, for
+    /// stores which are bounded. The capacity is evenly split between shards.
+    /// 0 restores the default capacity.
+    ///
+    void setCapacity( size_t capacity )
+    {
+        for ( auto& s : m_shards )
+        {
+            Lock l{ s.mutex };
+            s.store.setCapacity( ( capacity + NbShards - 1 ) / NbShards );
+        }
+    }
+
+    ///
+    /// \brief setMaxBytes Sets the maximum memory used by the cached entities,
+    /// for stores which are bounded. It is evenly split between shards.
+    /// 0 disables the limit.
+    ///
+    void setMaxBytes( size_t maxBytes )
+    {
+        for ( auto& s : m_shards )
+        {
+            Lock l{ s.mutex };
+            s.store.setMaxBytes( ( maxBytes + NbShards - 1 ) / NbShards );
+        }
+    }
+
+    size_t capacity()
+    {
+        size_t res = 0;
+        for ( auto& s : m_shards )
+        {
+            Lock l{ s.mutex };
+            res += s.store.capacity();
+        }
+        return res;
+    }
+
+    CacheStats stats()
+    {
+        CacheStats res{};
+        for ( auto& s : m_shards )
+        {
+            Lock l{ s.mutex };
+            res.nbHits += s.nbHits;
+            res.nbMisses += s.nbMisses;
+            res.nbInserts += s.nbInserts;
+            res.nbEvictions += s.store.nbEvictions();
+            res.nbEntities += s.store.size();
+            res.nbBytes += s.store.nbBytes();
+        }
+        return res;
     }
+
+private:
+    Shard m_shards[NbShards];
 };
 
-template <typename T>
-std::unordered_map<int64_t, std::shared_ptr<T>>
-Cached<T>::Store;
+template <typename T, typename Store, unsigned NbShards>
+constexpr unsigned Sharded<T, Store, NbShards>::ShardCount;
+
+}
 
 template <typename T>
-compat::Mutex Cached<T>::Mutex;
+using Cached = details::Sharded<T, details::MapStore<T>, details::DefaultNbShards>;
+
+///
+/// \brief Lru Bounded cache, keeping at most about Capacity entities
+///
+template <typename T, size_t Capacity = 4096>
+using Lru = details::Sharded<T,
+        details::LruStore<T, ( Capacity + details::DefaultNbShards - 1 ) / details::DefaultNbShards>,
+        details::DefaultNbShards>;
 
 template <typename T>
-struct Uncached
+class Uncached
 {
-private:
-    struct FakeLock
-    {
-        FakeLock() = default;
-        ~FakeLock() = default;
-    };
-
 public:
-    static FakeLock lock() { return FakeLock{}; }
-    static void insert( int64_t, std::shared_ptr<T> ) {}
-    static void save( int64_t, std::shared_ptr<T> ) {}
-    static std::shared_ptr<T> remove( int64_t ) { return nullptr; }
-    static void clear() {}
-    static std::shared_ptr<T> load( int64_t ) { return nullptr; }
+    void insert( int64_t, std::shared_ptr<T> ) {}
+    void insert( const std::vector<int64_t>&, const std::vector<std::shared_ptr<T>>& ) {}
+    template <typename F>
+    std::shared_ptr<T> load( int64_t, F&& create ) { return create(); }
+    std::shared_ptr<T> load( int64_t ) { return nullptr; }
+    std::shared_ptr<T> peek( int64_t ) { return nullptr; }
+    std::shared_ptr<T> remove( int64_t ) { return nullptr; }
+    void setCapacity( size_t ) {}
+    void setMaxBytes( size_t ) {}
+    void clear() {}
+    CacheStats stats() { return CacheStats{}; }
 };
 
 }
 
+namespace details
+{
+
+// Entities can load the relations of a whole listing at once when eager
+// loading is enabled, through a static prefetch( ml, std::vector<IMPL*> )
+// member function. It is looked up on IMPL, so that listings of any of its
+// interfaces, or of IMPL itself, get the relations loaded.
+template <typename IMPL, typename INTF>
+auto prefetch( MediaLibraryPtr ml, const std::vector<std::shared_ptr<INTF>>& entities, int )
+    -> decltype( IMPL::prefetch( ml, std::vector<IMPL*>{} ) )
+{
+    if ( entities.empty() == true || ml->isEagerLoadingEnabled() == false )
+        return;
+    std::vector<IMPL*> impls;
+    impls.reserve( entities.size() );
+    for ( const auto& e : entities )
+        impls.push_back( static_cast<IMPL*>( e.get() ) );
+    IMPL::prefetch( ml, impls );
+}
+
+template <typename IMPL, typename INTF>
+void prefetch( MediaLibraryPtr, const std::vector<std::shared_ptr<INTF>>&, long )
+{
+}
+
+}
+
 template <typename IMPL, typename TABLEPOLICY, typename CACHEPOLICY = cachepolicy::Cached<IMPL>>
 class DatabaseHelpers
 {
     public:
-        template <typename... Args>
-        static std::shared_ptr<IMPL> fetch( MediaLibraryPtr ml, const std::string& req, Args&&... args )
+        /*
+         * Returns the cache for this entity type, owned by the provided
+         * media library instance
+         */
+        static CACHEPOLICY& cache( MediaLibraryPtr ml )
+        {
+            return ml->caches().get<CACHEPOLICY>( TABLEPOLICY::Name );
+        }
+
+        template <typename Req, typename... Args>
+        static typename std::enable_if<sqlite::IsRequest<Req>::value, std::shared_ptr<IMPL>>::type
+        fetch( MediaLibraryPtr ml, const Req& req, Args&&... args )
         {
             try
             {
@@ -145,8 +605,15 @@ class DatabaseHelpers
 
         static std::shared_ptr<IMPL> fetch( MediaLibraryPtr ml, int64_t pkValue )
         {
-            static std::string req = "SELECT * FROM " + TABLEPOLICY::Name + " WHERE " +
-                    TABLEPOLICY::PrimaryKeyColumn + " = ?";
+            // load() would return the cached instance anyway, even after
+            // reading the row again, so there's no need to query the database,
+            // unless the row was deleted and the cache doesn't know it yet.
+            auto res = cache( ml ).load( pkValue );
+            if ( res != nullptr && isCacheValid( ml, pkValue ) == true )
+                return res;
+            static const auto req = sqlite::StatementCache::registerRequest(
+                    "SELECT * FROM " + TABLEPOLICY::Name + " WHERE " +
+                    TABLEPOLICY::PrimaryKeyColumn + " = ?" );
             try
             {
                 return sqlite::Tools::fetchOne<IMPL>( ml, req, pkValue );
@@ -159,13 +626,99 @@ class DatabaseHelpers
             return {};
         }
 
+        /*
+         * Fetches the entities matching the provided primary keys, with a
+         * single request per batch of keys which aren't cached yet.
+         * The result follows the order of the provided keys, and contains
+         * nullptr for the keys which don't match any record.
+         */
+        static std::vector<std::shared_ptr<IMPL>> fetchByIds( MediaLibraryPtr ml,
+                                                              const std::vector<int64_t>& pkValues )
+        {
+            std::vector<std::shared_ptr<IMPL>> res( pkValues.size() );
+            std::vector<int64_t> missing;
+            auto& c = cache( ml );
+            for ( auto i = 0u; i < pkValues.size(); ++i )
+            {
+                res[i] = c.load( pkValues[i] );
+                if ( res[i] != nullptr && isCacheValid( ml, pkValues[i] ) == false )
+                    res[i] = nullptr;
+                if ( res[i] == nullptr )
+                    missing.push_back( pkValues[i] );
+            }
+            if ( missing.empty() == true )
+                return res;
+            std::unordered_map<int64_t, std::shared_ptr<IMPL>> fetched;
+            for ( auto& e : fetchIn<IMPL>( ml, TABLEPOLICY::PrimaryKeyColumn, missing ) )
+            {
+                auto pkValue = (e.get())->*TABLEPOLICY::PrimaryKey;
+                fetched.emplace( pkValue, std::move( e ) );
+            }
+            for ( auto i = 0u; i < pkValues.size(); ++i )
+            {
+                if ( res[i] != nullptr )
+                    continue;
+                auto it = fetched.find( pkValues[i] );
+                if ( it != end( fetched ) )
+                    res[i] = it->second;
+            }
+            return res;
+        }
+
+        /*
+         * Fetches the records whose column matches any of the provided values,
+         * using a single request per batch of values.
+         * The records are returned in no particular order.
+         */
+        template <typename INTF = IMPL>
+        static std::vector<std::shared_ptr<INTF>> fetchIn( MediaLibraryPtr ml, const std::string& column,
+                                                           std::vector<int64_t> values )
+        {
+            std::vector<std::shared_ptr<INTF>> res;
+            std::sort( begin( values ), end( values ) );
+            values.erase( std::unique( begin( values ), end( values ) ), end( values ) );
+            try
+            {
+                for ( auto i = 0u; i < values.size(); i += MaxBatchSize )
+                {
+                    auto nbValues = std::min<size_t>( MaxBatchSize, values.size() - i );
+                    // Pad the batch to a power of 2 by repeating its last value,
+                    // so that only a few distinct requests get compiled
+                    size_t nbParams = 1;
+                    while ( nbParams < nbValues )
+                        nbParams *= 2;
+                    std::vector<sqlite::Value> params;
+                    params.reserve( nbParams );
+                    for ( auto j = 0u; j < nbParams; ++j )
+                        params.emplace_back( values[i + std::min<size_t>( j, nbValues - 1 )] );
+                    std::string req = "SELECT * FROM " + TABLEPOLICY::Name + " WHERE " +
+                            column + " IN (?";
+                    for ( auto j = 1u; j < nbParams; ++j )
+                        req += ",?";
+                    req += ")";
+                    sqlite::Tools::forEachRow( ml, req, [ml, &res]( sqlite::Row& row ) {
+                        res.push_back( IMPL::load( ml, row ) );
+                    }, params );
+                }
+            }
+            catch ( const sqlite::errors::GenericExecution& ex )
+            {
+                if ( sqlite::errors::isInnocuous( ex ) == false )
+                    throw;
+                LOG_WARN( "Ignoring innocuous error: ", ex.what() );
+                return {};
+            }
+            return res;
+        }
+
         /*
          * Will fetch all elements from the database & cache them.
          */
         template <typename INTF = IMPL>
         static std::vector<std::shared_ptr<INTF>> fetchAll( MediaLibraryPtr ml )
         {
-            static const std::string req = "SELECT * FROM " + TABLEPOLICY::Name;
+            static const auto req = sqlite::StatementCache::registerRequest(
+                    "SELECT * FROM " + TABLEPOLICY::Name );
             try
             {
                 return sqlite::Tools::fetchAll<IMPL, INTF>( ml, req );
@@ -179,12 +732,15 @@ class DatabaseHelpers
             return {};
         }
 
-        template <typename INTF, typename... Args>
-        static std::vector<std::shared_ptr<INTF>> fetchAll( MediaLibraryPtr ml, const std::string &req, Args&&... args )
+        template <typename INTF, typename Req, typename... Args>
+        static typename std::enable_if<sqlite::IsRequest<Req>::value, std::vector<std::shared_ptr<INTF>>>::type
+        fetchAll( MediaLibraryPtr ml, const Req& req, Args&&... args )
         {
             try
             {
-                return sqlite::Tools::fetchAll<IMPL, INTF>( ml, req, std::forward<Args>( args )... );
+                auto res = sqlite::Tools::fetchAll<IMPL, INTF>( ml, req, std::forward<Args>( args )... );
+                details::prefetch<IMPL>( ml, res, 0 );
+                return res;
             }
             catch ( const sqlite::errors::GenericExecution& ex )
             {
@@ -195,61 +751,273 @@ class DatabaseHelpers
             return {};
         }
 
-        static std::shared_ptr<IMPL> load( MediaLibraryPtr ml, sqlite::Row& row )
+        /*
+         * Fetches a page of at most pageSize elements, starting after the position
+         * described by the continuation token, or from the start if it is empty.
+         * A pageSize of 0 fetches all the remaining elements.
+         */
+        template <typename INTF, typename... Args>
+        static Page<INTF> fetchPage( MediaLibraryPtr ml, sqlite::KeysetQuery& query, uint32_t pageSize,
+                                     const std::string& continuation, Args&&... args )
         {
-            auto l = CACHEPOLICY::lock();
+            if ( continuation.empty() == false && query.resume( continuation ) == false )
+            {
+                LOG_ERROR( "Invalid continuation token: ", continuation );
+                return {};
+            }
+            return fetchRows<INTF>( ml, query.request( pageSize > 0 ), query, pageSize,
+                                    std::forward<Args>( args )... );
+        }
 
-            auto key = row.load<int64_t>( 0 );
-            auto res = CACHEPOLICY::load( key );
-            if ( res != nullptr )
-                return res;
-            res = std::make_shared<IMPL>( ml, row );
-            CACHEPOLICY::save( key, res );
+        /*
+         * Fetches a page using one of the precompiled variants of a listing.
+         * The first page uses the precompiled request as is.
+         */
+        template <typename INTF, typename... Args>
+        static Page<INTF> fetchPage( MediaLibraryPtr ml, const sqlite::QueryTable& table,
+                                     SortingCriteria sort, bool desc, uint32_t pageSize,
+                                     const std::string& continuation, Args&&... args )
+        {
+            const auto& variant = table.variant( sort, desc );
+            if ( continuation.empty() == false )
+            {
+                auto query = variant.query;
+                return fetchPage<INTF>( ml, query, pageSize, continuation,
+                                        std::forward<Args>( args )... );
+            }
+            return fetchRows<INTF>( ml, variant.request( pageSize > 0 ), variant.query,
+                                    pageSize, std::forward<Args>( args )... );
+        }
+
+        /*
+         * Lists the primary keys of the records of a listing, in the listing
+         * order, without loading the entities.
+         */
+        template <typename... Args>
+        static std::vector<int64_t> fetchIds( MediaLibraryPtr ml, const sqlite::QueryTable& table,
+                                              SortingCriteria sort, bool desc, Args&&... args )
+        {
+            std::vector<int64_t> res;
+            try
+            {
+                sqlite::Tools::forEachRow( ml, table.variant( sort, desc ).ids, [&res]( sqlite::Row& row ) {
+                    res.push_back( row.load<int64_t>( 0 ) );
+                }, std::forward<Args>( args )... );
+            }
+            catch ( const sqlite::errors::GenericExecution& ex )
+            {
+                if ( sqlite::errors::isInnocuous( ex ) == false )
+                    throw;
+                LOG_WARN( "Ignoring innocuous error: ", ex.what() );
+                return {};
+            }
+            return res;
+        }
+
+        /*
+         * Counts the records of a listing, without loading them.
+         */
+        template <typename... Args>
+        static uint32_t fetchCount( MediaLibraryPtr ml, const sqlite::QueryTable& table, Args&&... args )
+        {
+            uint32_t res = 0;
+            try
+            {
+                sqlite::Tools::forEachRow( ml, table.count(), [&res]( sqlite::Row& row ) {
+                    res = row.load<uint32_t>( 0 );
+                }, std::forward<Args>( args )... );
+            }
+            catch ( const sqlite::errors::GenericExecution& ex )
+            {
+                if ( sqlite::errors::isInnocuous( ex ) == false )
+                    throw;
+                LOG_WARN( "Ignoring innocuous error: ", ex.what() );
+            }
             return res;
         }
 
+        template <typename INTF, typename... Args>
+        static std::vector<std::shared_ptr<INTF>> fetchAll( MediaLibraryPtr ml, sqlite::KeysetQuery& query, Args&&... args )
+        {
+            return fetchPage<INTF>( ml, query, 0, {}, std::forward<Args>( args )... ).items;
+        }
+
+    private:
+        // SQLite refuses requests with more than 999 parameters by default
+        static constexpr size_t MaxBatchSize = 256;
+
+        // Deleted entities are only evicted once the write context is
+        // released, and inserted ones are cached before they're committed, so
+        // they can't be returned without checking the database before that.
+        static bool isCacheValid( MediaLibraryPtr ml, int64_t pkValue )
+        {
+            auto dbConn = ml->getConn();
+            return dbConn->isDeletionPending( TABLEPOLICY::Name, pkValue ) == false &&
+                    dbConn->isInsertionPending( TABLEPOLICY::Name, pkValue ) == false;
+        }
+
+        template <typename INTF, typename Req, typename... Args>
+        static Page<INTF> fetchRows( MediaLibraryPtr ml, const Req& req, const sqlite::KeysetQuery& query,
+                                     uint32_t pageSize, Args&&... args )
+        {
+            Page<INTF> page;
+            auto nbRows = 0u;
+            std::string last;
+            bool hasMore = false;
+            try
+            {
+                // Fetch an extra row to know if there is a next page
+                sqlite::Tools::forEachRow( ml, req, [&]( sqlite::Row& row ) {
+                    if ( pageSize > 0 && nbRows == pageSize )
+                    {
+                        hasMore = true;
+                        return;
+                    }
+                    page.items.push_back( IMPL::load( ml, row ) );
+                    if ( ++nbRows == pageSize )
+                        last = query.continuation( row );
+                }, std::forward<Args>( args )..., query.bindings( pageSize > 0 ? pageSize + 1 : 0 ) );
+            }
+            catch ( const sqlite::errors::GenericExecution& ex )
+            {
+                if ( sqlite::errors::isInnocuous( ex ) == false )
+                    throw;
+                LOG_WARN( "Ignoring innocuous error: ", ex.what() );
+                return {};
+            }
+            if ( hasMore == true )
+                page.next = std::move( last );
+            details::prefetch<IMPL>( ml, page.items, 0 );
+            return page;
+        }
+
+    public:
+        static std::shared_ptr<IMPL> load( MediaLibraryPtr ml, sqlite::Row& row )
+        {
+            auto key = row.load<int64_t>( 0 );
+            if ( sqlite::ReadSnapshot::snapshotInProgress() == true ||
+                 ml->getConn()->canCacheReads() == false )
+            {
+                // The row might have been modified or deleted since the
+                // snapshot started, so don't let other threads see it
+                auto res = cache( ml ).load( key );
+                if ( res != nullptr )
+                    return res;
+                return std::make_shared<IMPL>( ml, row );
+            }
+            return cache( ml ).load( key, [ml, &row]() {
+                return std::make_shared<IMPL>( ml, row );
+            });
+        }
+
         static bool destroy( MediaLibraryPtr ml, int64_t pkValue )
         {
-            static const std::string req = "DELETE FROM " + TABLEPOLICY::Name + " WHERE "
-                    + TABLEPOLICY::PrimaryKeyColumn + " = ?";
+            static const auto req = sqlite::StatementCache::registerRequest(
+                    "DELETE FROM " + TABLEPOLICY::Name + " WHERE "
+                    + TABLEPOLICY::PrimaryKeyColumn + " = ?" );
             return sqlite::Tools::executeDelete( ml->getConn(), req, pkValue );
         }
 
         /**
          * @warning removeFromCache is only meant to be called from an SQLite hook
          */
-        static void removeFromCache( int64_t pkValue )
+        static void removeFromCache( MediaLibraryPtr ml, const std::vector<int64_t>& pkValues )
         {
-            auto l = CACHEPOLICY::lock();
-
-            auto removed = CACHEPOLICY::remove( pkValue );
-            if ( removed != nullptr )
-                removed->markDeleted();
+            auto& c = cache( ml );
+            for ( auto pkValue : pkValues )
+            {
+                auto removed = c.remove( pkValue );
+                if ( removed != nullptr )
+                    removed->markDeleted();
+            }
         }
 
-        static void clear()
+        /*
+         * Evicts the provided entities from the cache, so that they get fetched
+         * again the next time they are requested. Unlike removeFromCache, this
+         * is meant for entities which still exist, but were modified by
+         * requests which didn't go through them.
+         */
+        static void invalidate( MediaLibraryPtr ml, const std::vector<int64_t>& pkValues )
         {
-            auto l = CACHEPOLICY::lock();
+            auto& c = cache( ml );
+            for ( auto pkValue : pkValues )
+                c.remove( pkValue );
+        }
 
-            CACHEPOLICY::clear();
+        static void clear( MediaLibraryPtr ml )
+        {
+            cache( ml ).clear();
         }
 
     protected:
+        /*
+         * Defers an update of the entity with the provided primary key to the
+         * write-behind queue. The queued update holds a reference to the
+         * cached entity until it is committed, so that the cache doesn't evict
+         * it and reload it from its former row in the meantime.
+         * Once the update is done, any other instance cached meanwhile (for
+         * instance after an invalidation) is evicted, since it was loaded from
+         * the former row. If the update ends up being dropped, the entity is
+         * evicted as well, so that the value the caller already stored in
+         * memory gets discarded and the row is fetched again.
+         */
+        template <typename Req, typename... Args>
+        static bool executeDeferredUpdate( MediaLibraryPtr ml, int64_t pkValue, const Req& req,
+                                           Args&&... args )
+        {
+            auto owner = cache( ml ).peek( pkValue );
+            auto done = [ml, pkValue, owner]( bool success ) {
+                auto& c = cache( ml );
+                if ( success == false )
+                {
+                    LOG_ERROR( "Failed to update ", TABLEPOLICY::Name, " #", pkValue,
+                               ". Discarding its cached value" );
+                    c.remove( pkValue );
+                    return;
+                }
+                auto cached = c.peek( pkValue );
+                if ( cached != nullptr && cached != owner )
+                    c.remove( pkValue );
+            };
+            return sqlite::Tools::executeDeferredUpdate( ml->getConn(), std::move( owner ),
+                                                         std::move( done ), req,
+                                                         std::forward<Args>( args )... );
+        }
+
         /*
          * Create a new instance of the cache class.
          */
-        template <typename... Args>
-        static bool insert( MediaLibraryPtr ml, std::shared_ptr<IMPL> self, const std::string& req, Args&&... args )
+        template <typename Req, typename... Args>
+        static bool insert( MediaLibraryPtr ml, std::shared_ptr<IMPL> self, const Req& req, Args&&... args )
         {
             int64_t pKey = sqlite::Tools::executeInsert( ml->getConn(), req, std::forward<Args>( args )... );
             if ( pKey == 0 )
                 return false;
             (self.get())->*TABLEPOLICY::PrimaryKey = pKey;
-            auto l = CACHEPOLICY::lock();
-            CACHEPOLICY::insert( pKey, self );
+            cache( ml ).insert( pKey, self );
             return true;
         }
 
+        /*
+         * Inserts a batch of instances, using a single compiled request.
+         * bind must execute the provided statement with the parameters of
+         * the provided instance.
+         * This should be called with a transaction in progress.
+         */
+        template <typename Req, typename F>
+        static void insertBatch( MediaLibraryPtr ml, const std::vector<std::shared_ptr<IMPL>>& selves,
+                                 const Req& req, F&& bind )
+        {
+            if ( selves.empty() == true )
+                return;
+            auto pKeys = sqlite::Tools::executeInsertBatch( ml->getConn(), req, selves,
+                                                            std::forward<F>( bind ) );
+            for ( auto i = 0u; i < selves.size(); ++i )
+                (selves[i].get())->*TABLEPOLICY::PrimaryKey = pKeys[i];
+            cache( ml ).insert( pKeys, selves );
+        }
+
 
     protected:
         DatabaseHelpers() : m_deleted( false ) {}
@@ -277,4 +1045,7 @@ class DatabaseHelpers
 
 };
 
+template <typename IMPL, typename TABLEPOLICY, typename CACHEPOLICY>
+constexpr size_t DatabaseHelpers<IMPL, TABLEPOLICY, CACHEPOLICY>::MaxBatchSize;
+
 }
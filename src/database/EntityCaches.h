@@ -0,0 +1,222 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compat/Mutex.h"
+#include "medialibrary/IMediaLibrary.h"
+
+namespace medialibrary
+{
+
+///
+/// \brief EntityCaches Owns the entity caches of a MediaLibrary instance, so
+/// that multiple instances can live side by side in the same process.
+/// Each cache type is assigned a slot the first time it is used, and each
+/// instance creates its own cache for that slot on demand.
+///
+class EntityCaches
+{
+private:
+    struct Base
+    {
+        explicit Base( const std::string& name ) : name( name ) {}
+        virtual ~Base() = default;
+        virtual void clear() = 0;
+        virtual CacheStats stats() = 0;
+        virtual void setBudget( size_t capacity, size_t maxBytes ) = 0;
+        const std::string name;
+    };
+
+    template <typename Cache>
+    struct Holder : public Base
+    {
+        explicit Holder( const std::string& name ) : Base( name ) {}
+        virtual void clear() override
+        {
+            cache.clear();
+        }
+        virtual CacheStats stats() override
+        {
+            auto res = cache.stats();
+            res.entity = name;
+            return res;
+        }
+        virtual void setBudget( size_t capacity, size_t maxBytes ) override
+        {
+            cache.setCapacity( capacity );
+            cache.setMaxBytes( maxBytes );
+        }
+        Cache cache;
+    };
+
+    struct Budget
+    {
+        // 0 when the cache uses the common capacity
+        size_t capacity;
+        // 0 when the cache memory isn't bounded
+        size_t maxBytes;
+    };
+
+public:
+    // There are less entity types than this
+    static constexpr size_t MaxCaches = 32;
+
+    EntityCaches()
+    {
+        for ( auto& c : m_caches )
+            c.store( nullptr, std::memory_order_relaxed );
+    }
+
+    ~EntityCaches()
+    {
+        for ( auto& c : m_caches )
+            delete c.load( std::memory_order_relaxed );
+    }
+
+    EntityCaches( const EntityCaches& ) = delete;
+    EntityCaches& operator=( const EntityCaches& ) = delete;
+
+    ///
+    /// \brief get Returns the cache of the provided type
+    /// \param name The name of the cached entities, used to report statistics
+    ///
+    template <typename Cache>
+    Cache& get( const std::string& name )
+    {
+        static const size_t slot = nextSlot().fetch_add( 1, std::memory_order_relaxed );
+        assert( slot < MaxCaches );
+        auto c = m_caches[slot].load( std::memory_order_acquire );
+        if ( c == nullptr )
+        {
+            std::unique_ptr<Base> holder( new Holder<Cache>( name ) );
+            if ( m_caches[slot].compare_exchange_strong( c, holder.get(),
+                                                         std::memory_order_acq_rel ) == true )
+            {
+                c = holder.release();
+                // The budget setters might have missed the cache until it
+                // was published
+                std::lock_guard<compat::Mutex> lock( m_budgetLock );
+                if ( m_capacity != 0 || m_budgets.empty() == false )
+                    applyBudget( *c );
+            }
+            // Otherwise c now points to the cache created by another thread
+        }
+        return static_cast<Holder<Cache>*>( c )->cache;
+    }
+
+    ///
+    /// \brief clear Empties all the caches
+    ///
+    void clear()
+    {
+        for ( auto& c : m_caches )
+        {
+            auto cache = c.load( std::memory_order_acquire );
+            if ( cache != nullptr )
+                cache->clear();
+        }
+    }
+
+    ///
+    /// \brief setCapacity Sets the maximum number of entities kept by each
+    /// bounded cache, including the ones which aren't created yet.
+    /// 0 restores the default capacity of each cache.
+    ///
+    void setCapacity( size_t capacity )
+    {
+        std::lock_guard<compat::Mutex> lock( m_budgetLock );
+        m_capacity = capacity;
+        for ( auto& c : m_caches )
+        {
+            auto cache = c.load( std::memory_order_acquire );
+            if ( cache != nullptr )
+                applyBudget( *cache );
+        }
+    }
+
+    ///
+    /// \brief setBudget Sets the budget of the cache of the provided entity
+    /// type, which then ignores the common capacity unless capacity is 0.
+    /// \param maxBytes The maximum memory used by the cached entities, or 0
+    ///                 for no limit
+    ///
+    void setBudget( const std::string& entity, size_t capacity, size_t maxBytes )
+    {
+        std::lock_guard<compat::Mutex> lock( m_budgetLock );
+        m_budgets[entity] = Budget{ capacity, maxBytes };
+        for ( auto& c : m_caches )
+        {
+            auto cache = c.load( std::memory_order_acquire );
+            if ( cache != nullptr && cache->name == entity )
+                applyBudget( *cache );
+        }
+    }
+
+    std::vector<CacheStats> stats()
+    {
+        std::vector<CacheStats> res;
+        for ( auto& c : m_caches )
+        {
+            auto cache = c.load( std::memory_order_acquire );
+            if ( cache != nullptr )
+                res.push_back( cache->stats() );
+        }
+        return res;
+    }
+
+private:
+    // Must be called with m_budgetLock held
+    void applyBudget( Base& cache )
+    {
+        auto it = m_budgets.find( cache.name );
+        if ( it == end( m_budgets ) )
+        {
+            cache.setBudget( m_capacity, 0 );
+            return;
+        }
+        const auto& budget = it->second;
+        cache.setBudget( budget.capacity != 0 ? budget.capacity : m_capacity, budget.maxBytes );
+    }
+
+    static std::atomic<size_t>& nextSlot()
+    {
+        static std::atomic<size_t> slot{ 0 };
+        return slot;
+    }
+
+private:
+    std::atomic<Base*> m_caches[MaxCaches];
+    compat::Mutex m_budgetLock;
+    // 0 when the caches use their default capacity
+    size_t m_capacity = 0;
+    std::unordered_map<std::string, Budget> m_budgets;
+};
+
+}
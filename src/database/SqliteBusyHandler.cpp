@@ -0,0 +1,172 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SqliteBusyHandler.h"
+
+#include <algorithm>
+
+#include "compat/Thread.h"
+#include "logging/Logger.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+namespace
+{
+
+// xorshift32, only used to spread the retries of competing threads, which
+// doesn't require much randomness.
+uint32_t nextRandom()
+{
+    static thread_local uint32_t state = 0;
+    if ( state == 0 )
+    {
+        auto seed = std::chrono::steady_clock::now().time_since_epoch().count();
+        state = static_cast<uint32_t>( seed ^ ( seed >> 32 ) ) | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+}
+
+thread_local unsigned int BusyHandler::DeadlineDepth = 0;
+thread_local int64_t BusyHandler::Waited = 0;
+
+BusyHandler::Deadline::Deadline()
+{
+    if ( DeadlineDepth++ == 0 )
+        Waited = 0;
+}
+
+BusyHandler::Deadline::~Deadline()
+{
+    --DeadlineDepth;
+}
+
+BusyHandler::BusyHandler()
+    : m_initialDelay( 1000 )
+    , m_maxDelay( 100000 )
+    , m_deadline( 5000000 )
+    , m_nbBusy( 0 )
+    , m_nbRetries( 0 )
+    , m_nbTimeouts( 0 )
+    , m_busyTime( 0 )
+{
+}
+
+void BusyHandler::setPolicy( const BusyPolicy& policy )
+{
+    using us = std::chrono::microseconds;
+    m_initialDelay = std::chrono::duration_cast<us>( policy.initialDelay ).count();
+    m_maxDelay = std::chrono::duration_cast<us>( policy.maxDelay ).count();
+    m_deadline = std::chrono::duration_cast<us>( policy.deadline ).count();
+}
+
+void BusyHandler::install( sqlite3* dbConnection )
+{
+    sqlite3_busy_handler( dbConnection, &BusyHandler::onBusy, this );
+}
+
+int BusyHandler::onBusy( void* data, int count )
+{
+    auto self = reinterpret_cast<BusyHandler*>( data );
+    // Without a Deadline in scope, only bound the wait for the current lock
+    if ( DeadlineDepth == 0 && count == 0 )
+        Waited = 0;
+    auto d = self->delay( count );
+    if ( self->expired( d ) == true )
+    {
+        self->m_nbTimeouts.fetch_add( 1, std::memory_order_relaxed );
+        return 0;
+    }
+    self->m_nbBusy.fetch_add( 1, std::memory_order_relaxed );
+    self->wait( d );
+    return 1;
+}
+
+bool BusyHandler::backoff( unsigned int attempt )
+{
+    auto d = delay( attempt );
+    if ( expired( d ) == true )
+    {
+        m_nbTimeouts.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
+    m_nbRetries.fetch_add( 1, std::memory_order_relaxed );
+    wait( d );
+    return true;
+}
+
+BusyStats BusyHandler::stats() const
+{
+    return BusyStats{ m_nbBusy.load(), m_nbRetries.load(), m_nbTimeouts.load(), m_busyTime.load() };
+}
+
+void BusyHandler::reset()
+{
+    m_nbBusy = 0;
+    m_nbRetries = 0;
+    m_nbTimeouts = 0;
+    m_busyTime = 0;
+}
+
+std::chrono::microseconds BusyHandler::delay( unsigned int attempt ) const
+{
+    auto initialDelay = m_initialDelay.load( std::memory_order_relaxed );
+    auto maxDelay = m_maxDelay.load( std::memory_order_relaxed );
+    // Don't shift past the point where we'd reach the max delay anyway
+    auto d = attempt >= 32 ? maxDelay : std::min( initialDelay << attempt, maxDelay );
+    return std::chrono::microseconds{ std::max<int64_t>( d, 0 ) };
+}
+
+bool BusyHandler::expired( std::chrono::microseconds delay ) const
+{
+    return Waited + delay.count() > m_deadline.load( std::memory_order_relaxed );
+}
+
+void BusyHandler::wait( std::chrono::microseconds delay )
+{
+    // Wait for a random duration between half and the whole nominal delay
+    auto half = delay.count() / 2;
+    auto jittered = std::chrono::microseconds{ half + ( half > 0 ? nextRandom() % ( half + 1 ) : 0 ) };
+    // Account for the time actually spent, which can exceed the requested one
+    auto start = std::chrono::steady_clock::now();
+    compat::this_thread::sleep_for( jittered );
+    auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start ).count();
+    Waited += waited;
+    m_busyTime.fetch_add( waited, std::memory_order_relaxed );
+}
+
+}
+
+}
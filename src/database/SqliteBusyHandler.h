@@ -0,0 +1,110 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <sqlite3.h>
+
+#include "medialibrary/IMediaLibrary.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+///
+/// \brief The BusyHandler class implements the waits performed when the
+/// database is busy, and counts them.
+///
+/// It is installed as the sqlite busy handler of each connection, and is also
+/// used to back off before retrying a statement or a transaction which failed
+/// with an innocuous error.
+/// The deadline bounds the total time a thread spends waiting while a Deadline
+/// instance is alive, regardless of which of those paths performed the waits.
+///
+class BusyHandler
+{
+public:
+    ///
+    /// \brief The Deadline class scopes the waits accounted against the
+    /// policy deadline for the current thread.
+    /// Nested instances share the budget of the outermost one. Busy handler
+    /// invocations outside of any Deadline only account for the current lock.
+    ///
+    class Deadline
+    {
+    public:
+        Deadline();
+        ~Deadline();
+        Deadline( const Deadline& ) = delete;
+        Deadline& operator=( const Deadline& ) = delete;
+    };
+
+    BusyHandler();
+    BusyHandler( const BusyHandler& ) = delete;
+    BusyHandler& operator=( const BusyHandler& ) = delete;
+
+    void setPolicy( const BusyPolicy& policy );
+    void install( sqlite3* dbConnection );
+    ///
+    /// \brief backoff Waits before retrying a failed request
+    /// \param attempt The number of retries already performed
+    /// \return false if the deadline expired, in which case the caller
+    ///         is expected to give up.
+    ///
+    bool backoff( unsigned int attempt );
+
+    BusyStats stats() const;
+    void reset();
+
+private:
+    static int onBusy( void* data, int count );
+    // The nominal delay before retrying attempt, without jitter
+    std::chrono::microseconds delay( unsigned int attempt ) const;
+    // Returns true if waiting for delay would exceed the current deadline
+    bool expired( std::chrono::microseconds delay ) const;
+    // Sleeps for a jittered version of the nominal delay
+    void wait( std::chrono::microseconds delay );
+
+private:
+    // Stored in microseconds, so the policy can be updated while waiting
+    std::atomic<int64_t> m_initialDelay;
+    std::atomic<int64_t> m_maxDelay;
+    std::atomic<int64_t> m_deadline;
+
+    std::atomic<uint64_t> m_nbBusy;
+    std::atomic<uint64_t> m_nbRetries;
+    std::atomic<uint64_t> m_nbTimeouts;
+    std::atomic<uint64_t> m_busyTime;
+
+    // The number of Deadline instances alive on the current thread, and the
+    // time it actually spent waiting since the outermost one was created, in µs
+    static thread_local unsigned int DeadlineDepth;
+    static thread_local int64_t Waited;
+};
+
+}
+
+}
@@ -26,15 +26,46 @@
 
 #include "SqliteConnection.h"
 
+#include <algorithm>
+
 #include "database/SqliteTools.h"
 
 namespace medialibrary
 {
 
+constexpr unsigned int SqliteConnection::MaxReadConnections;
+constexpr size_t SqliteConnection::MaxPendingWrites;
+constexpr std::chrono::milliseconds SqliteConnection::MaxPendingDelay;
+std::atomic_uint SqliteConnection::NextId;
+thread_local unsigned int SqliteConnection::CurrentId = 0;
+thread_local SqliteConnection::Connection* SqliteConnection::CurrentConnection = nullptr;
+thread_local unsigned int SqliteConnection::CurrentReadDepth = 0;
+thread_local unsigned int SqliteConnection::CurrentReadGeneration = 0;
+thread_local SqliteConnection::Connection* SqliteConnection::SavedConnection = nullptr;
+thread_local unsigned int SqliteConnection::SavedReadDepth = 0;
+
+SqliteConnection::Connection::Connection( ConnPtr conn,
+                                          sqlite::QueryProfiler::Shard& stats )
+    : db( std::move( conn ) )
+    , statements( db.get() )
+    , stats( stats )
+{
+    statements.prepareRegistered();
+}
+
 SqliteConnection::SqliteConnection( const std::string &dbPath )
-    : m_dbPath( dbPath )
-    , m_readLock( m_contextLock )
-    , m_writeLock( m_contextLock )
+    : m_id( ++NextId )
+    , m_dbPath( dbPath )
+    , m_walEnabled( false )
+    , m_readLock( *this )
+    , m_writeLock( *this )
+    , m_hasPendingDeletions( false )
+    , m_hasCommittedDeletions( false )
+    , m_nbPublished( 0 )
+    , m_nbInserted( 0 )
+    , m_commitGeneration( 0 )
+    , m_nbDroppedWrites( 0 )
+    , m_stopFlushThread( false )
 {
     if ( sqlite3_threadsafe() == 0 )
         throw std::runtime_error( "SQLite isn't built with threadsafe mode" );
@@ -44,35 +75,303 @@ SqliteConnection::SqliteConnection( const std::string &dbPath )
 
 SqliteConnection::~SqliteConnection()
 {
-    sqlite::Statement::FlushStatementCache();
+    if ( m_flushThread.joinable() == true )
+    {
+        {
+            std::lock_guard<compat::Mutex> lock( m_pendingLock );
+            m_stopFlushThread = true;
+        }
+        m_pendingCond.notify_all();
+        m_flushThread.join();
+    }
+    // Commit the remaining writes before closing the connections
+    flush();
+    // Only reset the calling thread's binding. Other threads will simply
+    // fail to match this instance's id.
+    if ( CurrentId == m_id )
+    {
+        CurrentId = 0;
+        CurrentConnection = nullptr;
+        CurrentReadDepth = 0;
+    }
+    // Close the read only connections first, so the writer is the last
+    // connection to the database and can checkpoint & remove the WAL file.
+    m_idleReaders.clear();
+    m_readers.clear();
 }
 
 SqliteConnection::Handle SqliteConnection::getConn()
 {
-    std::unique_lock<compat::Mutex> lock( m_connMutex );
+    return current().db.get();
+}
+
+sqlite::StatementCache& SqliteConnection::statementCache()
+{
+    return current().statements;
+}
+
+SqliteConnection::Connection& SqliteConnection::current()
+{
+    // Fast path: the connection is bound to the thread for as long as it
+    // holds a context, so there's no need to lock anything.
+    if ( CurrentId == m_id && CurrentConnection != nullptr )
+        return *CurrentConnection;
+    // Accessing the database without a context isn't safe, since the write
+    // connection might be in use by another thread, possibly with a
+    // transaction in progress.
+    throw sqlite::errors::NoContext();
+}
+
+SqliteConnection::Connection& SqliteConnection::writer()
+{
+    if ( m_writer != nullptr )
+        return *m_writer;
+    auto dbConn = open( SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE );
+    std::unique_ptr<Connection> conn( new Connection( std::move( dbConn ), m_profiler.newShard() ) );
+    auto dbConnection = conn->db.get();
+    sqlite::Statement s( dbConnection, conn->statements, m_busyHandler, "PRAGMA foreign_keys = ON" );
+    s.execute();
+    while ( s.row() != nullptr )
+        ;
+    sqlite::Statement s2( dbConnection, conn->statements, m_busyHandler, "PRAGMA recursive_triggers = ON" );
+    s2.execute();
+    while ( s2.row() != nullptr )
+        ;
+    // The journal mode is persistent, but the pragma returns the mode
+    // actually in use, which might not be WAL (for instance for in memory
+    // databases)
+    {
+        sqlite::Statement s3( dbConnection, conn->statements, m_busyHandler, "PRAGMA journal_mode = WAL" );
+        s3.execute();
+        auto row = s3.row();
+        m_walEnabled = row != nullptr && row.load<std::string>( 0 ) == "wal";
+        while ( row != nullptr )
+            row = s3.row();
+    }
+    if ( m_walEnabled == false )
+        LOG_WARN( "Failed to enable WAL journal mode, readers will wait for writers" );
+    sqlite3_update_hook( dbConnection, &updateHook, this );
+    sqlite3_commit_hook( dbConnection, &commitHook, this );
+    sqlite3_rollback_hook( dbConnection, &rollbackHook, this );
+    m_writer = std::move( conn );
+    return *m_writer;
+}
+
+SqliteConnection::Connection::ConnPtr SqliteConnection::open( int flags )
+{
     sqlite3* dbConnection;
-    auto it = m_conns.find( compat::this_thread::get_id() );
-    if ( it == end( m_conns ) )
-    {
-        auto res = sqlite3_open( m_dbPath.c_str(), &dbConnection );
-        ConnPtr dbConn( dbConnection, &sqlite3_close );
-        if ( res != SQLITE_OK )
-            throw sqlite::errors::Generic( std::string( "Failed to connect to database: " )
-                                           + sqlite3_errstr( res ) );
-        sqlite3_extended_result_codes( dbConnection, 1 );
-        sqlite::Statement s( dbConnection, "PRAGMA foreign_keys = ON" );
-        s.execute();
-        while ( s.row() != nullptr )
-            ;
-        sqlite::Statement s2( dbConnection, "PRAGMA recursive_triggers = ON" );
-        s2.execute();
-        while ( s2.row() != nullptr )
-            ;
-        m_conns.emplace( compat::this_thread::get_id(), std::move( dbConn ) );
-        sqlite3_update_hook( dbConnection, &updateHook, this );
-        return dbConnection;
+    auto res = sqlite3_open_v2( m_dbPath.c_str(), &dbConnection, flags, nullptr );
+    Connection::ConnPtr dbConn( dbConnection, &sqlite3_close );
+    if ( res != SQLITE_OK )
+        throw sqlite::errors::Generic( std::string( "Failed to connect to database: " )
+                                       + sqlite3_errstr( res ) );
+    sqlite3_extended_result_codes( dbConnection, 1 );
+    m_busyHandler.install( dbConnection );
+    return dbConn;
+}
+
+bool SqliteConnection::isWalEnabled()
+{
+    std::lock_guard<compat::Mutex> lock( m_connMutex );
+    // Ensure the database has been opened, and the journal mode configured
+    writer();
+    return m_walEnabled;
+}
+
+void SqliteConnection::lockRead()
+{
+    // Nested read contexts, or reads performed while holding the write
+    // context, reuse the connection already bound to this thread. This
+    // also allows a writer to read its own uncommitted changes.
+    if ( CurrentId == m_id && CurrentConnection != nullptr )
+    {
+        ++CurrentReadDepth;
+        return;
+    }
+    const auto profiling = m_profiler.isEnabled();
+    std::chrono::steady_clock::time_point waitStart;
+    if ( profiling == true )
+        waitStart = std::chrono::steady_clock::now();
+    Connection* conn;
+    bool walEnabled;
+    {
+        std::unique_lock<compat::Mutex> lock( m_connMutex );
+        // Ensure the database has been opened, and the journal mode configured
+        writer();
+        walEnabled = m_walEnabled;
+        if ( m_idleReaders.empty() == true && m_readers.size() < MaxReadConnections )
+        {
+            auto dbConn = open( SQLITE_OPEN_READONLY );
+            std::unique_ptr<Connection> reader( new Connection( std::move( dbConn ),
+                                                                m_profiler.newShard() ) );
+            m_idleReaders.push_back( reader.get() );
+            m_readers.push_back( std::move( reader ) );
+        }
+        m_readerCond.wait( lock, [this]() {
+            return m_idleReaders.empty() == false;
+        });
+        conn = m_idleReaders.back();
+        m_idleReaders.pop_back();
     }
-    return it->second.get();
+    if ( walEnabled == false )
+        m_contextLock.lock_read();
+    if ( profiling == true )
+        m_profiler.recordReadLockWait( std::chrono::steady_clock::now() - waitStart );
+    CurrentId = m_id;
+    CurrentConnection = conn;
+    CurrentReadDepth = 1;
+    CurrentReadGeneration = m_commitGeneration.load( std::memory_order_acquire );
+}
+
+void SqliteConnection::unlockRead()
+{
+    assert( CurrentId == m_id && CurrentReadDepth > 0 );
+    if ( --CurrentReadDepth > 0 || CurrentConnection == m_writer.get() )
+        return;
+    bool walEnabled;
+    {
+        std::lock_guard<compat::Mutex> lock( m_connMutex );
+        walEnabled = m_walEnabled;
+        m_idleReaders.push_back( CurrentConnection );
+    }
+    m_readerCond.notify_one();
+    CurrentConnection = nullptr;
+    if ( walEnabled == false )
+        m_contextLock.unlock_read();
+}
+
+void SqliteConnection::lockWrite()
+{
+    // Open the database before locking, so that a failure doesn't leave the
+    // lock held.
+    isWalEnabled();
+    if ( m_profiler.isEnabled() == true )
+    {
+        auto waitStart = std::chrono::steady_clock::now();
+        m_contextLock.lock_write();
+        m_profiler.recordWriteLockWait( std::chrono::steady_clock::now() - waitStart );
+    }
+    else
+        m_contextLock.lock_write();
+    if ( CurrentId == m_id )
+    {
+        SavedConnection = CurrentConnection;
+        SavedReadDepth = CurrentReadDepth;
+    }
+    else
+    {
+        SavedConnection = nullptr;
+        SavedReadDepth = 0;
+    }
+    CurrentId = m_id;
+    // m_writer is only assigned once, in writer(), which we called above.
+    CurrentConnection = m_writer.get();
+    CurrentReadDepth = 0;
+    // Commit the deferred writes before anything else is written
+    flushPendingWrites();
+}
+
+void SqliteConnection::unlockWrite()
+{
+    assert( CurrentId == m_id && CurrentConnection == m_writer.get() );
+    CurrentConnection = SavedConnection;
+    CurrentReadDepth = SavedReadDepth;
+    SavedConnection = nullptr;
+    SavedReadDepth = 0;
+    // The commits are now visible to all the connections
+    auto generation = m_commitGeneration.load( std::memory_order_relaxed );
+    if ( generation % 2 != 0 )
+        m_commitGeneration.store( generation + 1, std::memory_order_release );
+    if ( m_nbInserted.load( std::memory_order_relaxed ) > 0 )
+    {
+        std::lock_guard<compat::Mutex> lock( m_dispatchLock );
+        for ( auto& h : m_hooks )
+            h.inserted.clear();
+        m_nbInserted.store( 0, std::memory_order_release );
+    }
+    if ( m_hasCommittedDeletions == false )
+    {
+        m_contextLock.unlock_write();
+        return;
+    }
+    dispatchDeletions();
+}
+
+void SqliteConnection::dispatchDeletions()
+{
+    // Steal the committed deletions while holding the write context, but
+    // run the callbacks once it's released, so that cache & notifier locks
+    // are never taken while blocking other writers.
+    std::vector<std::pair<size_t, std::vector<int64_t>>> batches;
+    {
+        std::lock_guard<compat::Mutex> lock( m_dispatchLock );
+        for ( auto i = 0u; i < m_hooks.size(); ++i )
+        {
+            if ( m_hooks[i].committed.empty() == true )
+                continue;
+            batches.emplace_back( i, std::move( m_hooks[i].committed ) );
+            m_hooks[i].committed.clear();
+        }
+    }
+    m_hasCommittedDeletions = false;
+    m_contextLock.unlock_write();
+    // Hooks are only registered during initialization, so their callbacks
+    // can be accessed without the write context.
+    for ( const auto& b : batches )
+        m_hooks[b.first].cb( b.second );
+    // The deletions stay visible to isDeletionPending until the callbacks ran
+    std::lock_guard<compat::Mutex> lock( m_dispatchLock );
+    for ( const auto& b : batches )
+    {
+        auto& published = m_hooks[b.first].published;
+        for ( auto rowId : b.second )
+        {
+            auto it = published.find( rowId );
+            assert( it != end( published ) );
+            if ( --it->second > 0 )
+                continue;
+            published.erase( it );
+            m_nbPublished.fetch_sub( 1, std::memory_order_release );
+        }
+    }
+}
+
+bool SqliteConnection::isDeletionPending( const std::string& table, int64_t rowId )
+{
+    auto idx = hookIndex( table.c_str() );
+    if ( idx == m_hooks.size() )
+        return false;
+    // The uncommitted deletions can only be accessed with the write context held
+    if ( CurrentId == m_id && CurrentConnection != nullptr &&
+         CurrentConnection == m_writer.get() && m_hasPendingDeletions == true &&
+         m_hooks[idx].uncommitted.count( rowId ) > 0 )
+        return true;
+    if ( m_nbPublished.load( std::memory_order_acquire ) == 0 )
+        return false;
+    std::lock_guard<compat::Mutex> lock( m_dispatchLock );
+    return m_hooks[idx].published.count( rowId ) > 0;
+}
+
+bool SqliteConnection::isInsertionPending( const std::string& table, int64_t rowId )
+{
+    // The writer can see its own insertions
+    if ( m_nbInserted.load( std::memory_order_acquire ) == 0 ||
+         ( CurrentId == m_id && CurrentConnection == m_writer.get() ) )
+        return false;
+    auto idx = hookIndex( table.c_str() );
+    if ( idx == m_hooks.size() )
+        return false;
+    std::lock_guard<compat::Mutex> lock( m_dispatchLock );
+    return m_hooks[idx].inserted.count( rowId ) > 0;
+}
+
+bool SqliteConnection::canCacheReads() const
+{
+    if ( CurrentId != m_id || CurrentConnection == nullptr ||
+         CurrentConnection == m_writer.get() )
+        return true;
+    return CurrentReadGeneration % 2 == 0 &&
+            m_commitGeneration.load( std::memory_order_acquire ) == CurrentReadGeneration;
 }
 
 std::unique_ptr<sqlite::Transaction> SqliteConnection::newTransaction()
@@ -80,6 +379,21 @@ std::unique_ptr<sqlite::Transaction> SqliteConnection::newTransaction()
     return std::unique_ptr<sqlite::Transaction>{ new sqlite::Transaction( this ) };
 }
 
+sqlite::QueryProfiler& SqliteConnection::profiler()
+{
+    return m_profiler;
+}
+
+sqlite::QueryProfiler::Shard& SqliteConnection::queryStats()
+{
+    return current().stats;
+}
+
+sqlite::BusyHandler& SqliteConnection::busyHandler()
+{
+    return m_busyHandler;
+}
+
 SqliteConnection::ReadContext SqliteConnection::acquireReadContext()
 {
     return ReadContext{ m_readLock };
@@ -90,29 +404,249 @@ SqliteConnection::WriteContext SqliteConnection::acquireWriteContext()
     return WriteContext{ m_writeLock };
 }
 
-void SqliteConnection::registerUpdateHook( const std::string& table, SqliteConnection::UpdateHookCb cb )
+void SqliteConnection::registerDeletionHook( const std::string& table,
+                                             SqliteConnection::DeletionHookCb cb )
 {
-    m_hooks.emplace( table, cb );
+    m_hooks.push_back( DeletionHook{ table, std::move( cb ), {}, {}, {}, {} } );
+    m_hookIndexes.clear();
+    for ( auto i = 0u; i < m_hooks.size(); ++i )
+        m_hookIndexes.emplace( m_hooks[i].table.c_str(), i );
+}
+
+size_t SqliteConnection::TableNameHash::operator()( const char* table ) const
+{
+    // FNV-1a, which doesn't require the name to be copied, nor its length
+    size_t hash = 2166136261u;
+    for ( ; *table != 0; ++table )
+    {
+        hash ^= static_cast<unsigned char>( *table );
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+size_t SqliteConnection::hookIndex( const char* table ) const
+{
+    auto it = m_hookIndexes.find( table );
+    if ( it == end( m_hookIndexes ) )
+        return m_hooks.size();
+    return it->second;
 }
 
 void SqliteConnection::updateHook( void* data, int reason, const char*,
                                    const char* table, sqlite_int64 rowId )
 {
+    if ( reason == SQLITE_UPDATE )
+        return;
     const auto self = reinterpret_cast<SqliteConnection*>( data );
-    auto it = self->m_hooks.find( table );
-    if ( it == end( self->m_hooks ) )
+    auto idx = self->hookIndex( table );
+    if ( idx == self->m_hooks.size() )
         return;
-    switch ( reason )
-    {
-    case SQLITE_INSERT:
-        it->second( HookReason::Insert, rowId );
-        break;
-    case SQLITE_UPDATE:
-        it->second( HookReason::Update, rowId );
-        break;
-    case SQLITE_DELETE:
-        it->second( HookReason::Delete, rowId );
-        break;
+    if ( reason == SQLITE_INSERT )
+    {
+        std::lock_guard<compat::Mutex> lock( self->m_dispatchLock );
+        if ( self->m_hooks[idx].inserted.insert( rowId ).second == true )
+            self->m_nbInserted.fetch_add( 1, std::memory_order_release );
+        return;
+    }
+    self->m_hooks[idx].uncommitted.insert( rowId );
+    self->m_hasPendingDeletions = true;
+}
+
+int SqliteConnection::commitHook( void* data )
+{
+    const auto self = reinterpret_cast<SqliteConnection*>( data );
+    // Readers which started before this commit is visible mustn't cache
+    // what they read, until the write context is released
+    auto generation = self->m_commitGeneration.load( std::memory_order_relaxed );
+    if ( generation % 2 == 0 )
+        self->m_commitGeneration.store( generation + 1, std::memory_order_release );
+    if ( self->m_hasPendingDeletions == false )
+        return 0;
+    // Publish the deletions before the commit makes them visible to the
+    // other connections, so that they don't use the cached entities meanwhile
+    size_t nbPublished = 0;
+    {
+        std::lock_guard<compat::Mutex> lock( self->m_dispatchLock );
+        for ( auto& h : self->m_hooks )
+        {
+            for ( auto rowId : h.uncommitted )
+            {
+                h.committed.push_back( rowId );
+                if ( ++h.published[rowId] == 1 )
+                    ++nbPublished;
+            }
+            h.uncommitted.clear();
+        }
+        self->m_nbPublished.fetch_add( nbPublished, std::memory_order_release );
+    }
+    self->m_hasPendingDeletions = false;
+    self->m_hasCommittedDeletions = true;
+    // Returning non zero would turn the commit into a rollback
+    return 0;
+}
+
+void SqliteConnection::rollbackHook( void* data )
+{
+    const auto self = reinterpret_cast<SqliteConnection*>( data );
+    if ( self->m_hasPendingDeletions == false )
+        return;
+    for ( auto& h : self->m_hooks )
+        h.uncommitted.clear();
+    self->m_hasPendingDeletions = false;
+}
+
+void SqliteConnection::enqueueWrite( std::function<void()> write,
+                                     std::function<void(bool)> done )
+{
+    std::lock_guard<compat::Mutex> lock( m_pendingLock );
+    m_pendingWrites.push_back( PendingWrite{ std::move( write ), std::move( done ) } );
+    if ( m_flushThread.joinable() == false )
+        m_flushThread = compat::Thread( &SqliteConnection::flushThread, this );
+    else if ( m_pendingWrites.size() >= MaxPendingWrites )
+        m_pendingCond.notify_all();
+}
+
+bool SqliteConnection::flush()
+{
+    if ( sqlite::Transaction::transactionInProgress() == true )
+        return true;
+    {
+        std::lock_guard<compat::Mutex> lock( m_pendingLock );
+        if ( m_pendingWrites.empty() == true )
+            return true;
+    }
+    auto nbDropped = m_nbDroppedWrites.load( std::memory_order_relaxed );
+    // Acquiring the write context is enough to commit the pending writes
+    acquireWriteContext();
+    return m_nbDroppedWrites.load( std::memory_order_relaxed ) == nbDropped;
+}
+
+uint64_t SqliteConnection::nbDroppedWrites() const
+{
+    return m_nbDroppedWrites.load( std::memory_order_relaxed );
+}
+
+void SqliteConnection::flushPendingWrites()
+{
+    std::vector<PendingWrite> writes;
+    {
+        std::lock_guard<compat::Mutex> lock( m_pendingLock );
+        if ( m_pendingWrites.empty() == true )
+            return;
+        std::swap( writes, m_pendingWrites );
+    }
+    auto chrono = std::chrono::steady_clock::now();
+    if ( commitPendingWrites( writes ) == true )
+    {
+        auto duration = std::chrono::steady_clock::now() - chrono;
+        LOG_DEBUG( "Flushed ", writes.size(), " pending writes in ",
+                   std::chrono::duration_cast<std::chrono::microseconds>( duration ).count(), "µs" );
+        for ( const auto& w : writes )
+        {
+            if ( w.done )
+                w.done( true );
+        }
+        return;
+    }
+    // The batch was rolled back. Replay the writes one by one, so that only
+    // the failing ones are dropped. Many of them are relative updates, which
+    // wouldn't be fixed by a later update of the same entity.
+    // This is called while granting a write context, so we can't let an
+    // exception escape.
+    uint64_t nbDropped = 0;
+    for ( auto it = begin( writes ); it != end( writes ); ++it )
+    {
+        auto success = false;
+        try
+        {
+            it->write();
+            success = true;
+        }
+        catch ( const sqlite::errors::GenericExecution& ex )
+        {
+            if ( sqlite::errors::isInnocuous( ex ) == true )
+            {
+                // Retry this write and the following ones on the next flush,
+                // before any write which was queued meanwhile
+                LOG_WARN( "Failed to commit pending write: ", ex.what(), ". Retrying later" );
+                {
+                    std::lock_guard<compat::Mutex> lock( m_pendingLock );
+                    m_pendingWrites.insert( begin( m_pendingWrites ),
+                                            std::make_move_iterator( it ),
+                                            std::make_move_iterator( end( writes ) ) );
+                }
+                m_pendingCond.notify_all();
+                break;
+            }
+            LOG_ERROR( "Dropping pending write: ", ex.what() );
+            ++nbDropped;
+        }
+        catch ( const std::exception& ex )
+        {
+            LOG_ERROR( "Dropping pending write: ", ex.what() );
+            ++nbDropped;
+        }
+        if ( it->done )
+            it->done( success );
+    }
+    if ( nbDropped > 0 )
+        m_nbDroppedWrites.fetch_add( nbDropped, std::memory_order_relaxed );
+}
+
+bool SqliteConnection::commitPendingWrites( const std::vector<PendingWrite>& writes )
+{
+    auto& conn = *m_writer;
+    try
+    {
+        sqlite::Statement begin( conn.db.get(), conn.statements, m_busyHandler, sqlite::TransactionRequests::begin() );
+        begin.execute();
+        while ( begin.row() != nullptr )
+            ;
+        try
+        {
+            for ( const auto& w : writes )
+                w.write();
+            sqlite::Statement commit( conn.db.get(), conn.statements, m_busyHandler, sqlite::TransactionRequests::commit() );
+            commit.execute();
+            while ( commit.row() != nullptr )
+                ;
+        }
+        catch ( const std::exception& )
+        {
+            sqlite::Statement rollback( conn.db.get(), conn.statements, m_busyHandler, sqlite::TransactionRequests::rollback() );
+            rollback.execute();
+            while ( rollback.row() != nullptr )
+                ;
+            throw;
+        }
+    }
+    catch ( const std::exception& ex )
+    {
+        LOG_WARN( "Failed to commit ", writes.size(), " pending writes as a batch: ", ex.what() );
+        return false;
+    }
+    return true;
+}
+
+void SqliteConnection::flushThread()
+{
+    std::unique_lock<compat::Mutex> lock( m_pendingLock );
+    while ( m_stopFlushThread == false )
+    {
+        m_pendingCond.wait( lock, [this]() {
+            return m_pendingWrites.empty() == false || m_stopFlushThread == true;
+        });
+        if ( m_stopFlushThread == true )
+            break;
+        // Give other writes a chance to be grouped with this one
+        m_pendingCond.wait_for( lock, MaxPendingDelay, [this]() {
+            return m_pendingWrites.size() >= MaxPendingWrites || m_stopFlushThread == true;
+        });
+        lock.unlock();
+        if ( flush() == false )
+            LOG_ERROR( "Some pending writes were dropped" );
+        lock.lock();
     }
 }
 
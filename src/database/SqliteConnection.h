@@ -23,13 +23,21 @@
 #ifndef SQLITECONNECTION_H
 #define SQLITECONNECTION_H
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <sqlite3.h>
 #include "compat/ConditionVariable.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <vector>
 
+#include "database/SqliteBusyHandler.h"
+#include "database/SqliteQueryProfiler.h"
+#include "database/SqliteStatementCache.h"
 #include "utils/SWMRLock.h"
 #include "compat/Mutex.h"
 #include "compat/Thread.h"
@@ -45,41 +53,233 @@ namespace sqlite
 class SqliteConnection
 {
 public:
-    using ReadContext = std::unique_lock<utils::ReadLocker>;
-    using WriteContext = std::unique_lock<utils::WriteLocker>;
-    using Handle = sqlite3*;
-    enum class HookReason
+    class ReadLocker
+    {
+    public:
+        explicit ReadLocker( SqliteConnection& conn ) : m_conn( conn ) {}
+        void lock() { m_conn.lockRead(); }
+        void unlock() { m_conn.unlockRead(); }
+    private:
+        SqliteConnection& m_conn;
+    };
+
+    class WriteLocker
     {
-        Insert,
-        Delete,
-        Update
+    public:
+        explicit WriteLocker( SqliteConnection& conn ) : m_conn( conn ) {}
+        void lock() { m_conn.lockWrite(); }
+        void unlock() { m_conn.unlockWrite(); }
+    private:
+        SqliteConnection& m_conn;
     };
-    using UpdateHookCb = std::function<void(HookReason, int64_t)>;
+
+    using ReadContext = std::unique_lock<ReadLocker>;
+    using WriteContext = std::unique_lock<WriteLocker>;
+    using Handle = sqlite3*;
+    using DeletionHookCb = std::function<void(const std::vector<int64_t>&)>;
 
     explicit SqliteConnection( const std::string& dbPath );
     ~SqliteConnection();
-    // Returns the current thread's connection
-    // This will initiate a connection if required
+    // Returns the connection bound to the current thread by its read or write
+    // context. The write connection is returned while a write context is held,
+    // a pooled read only connection while only a read context is held.
+    // Throws sqlite::errors::NoContext if the thread holds no context.
     Handle getConn();
+    // Returns the prepared statements cache for the current thread's connection
+    sqlite::StatementCache& statementCache();
     std::unique_ptr<sqlite::Transaction> newTransaction();
+    sqlite::QueryProfiler& profiler();
+    // Returns the query statistics of the current thread's connection
+    sqlite::QueryProfiler::Shard& queryStats();
+    sqlite::BusyHandler& busyHandler();
     ReadContext acquireReadContext();
     WriteContext acquireWriteContext();
 
-    void registerUpdateHook( const std::string& table, UpdateHookCb cb );
+    ///
+    /// \brief registerDeletionHook Registers a callback for rows deleted from table
+    /// Deletions are collected until the write context is released, and are
+    /// then passed to the callback as a single batch. Deletions which are
+    /// rolled back are discarded.
+    /// This must be called before the database is used from multiple threads.
+    ///
+    void registerDeletionHook( const std::string& table, DeletionHookCb cb );
+    ///
+    /// \brief isDeletionPending Returns true if the row was deleted from table,
+    /// but the deletion hooks weren't run for it yet.
+    /// Deletions which are part of another thread's transaction are only
+    /// reported once it's committed, since they aren't visible before that.
+    ///
+    bool isDeletionPending( const std::string& table, int64_t rowId );
+    ///
+    /// \brief isInsertionPending Returns true if the row was inserted in table
+    /// by another thread, which still holds the write context.
+    /// The row might not be committed yet, so the entity that thread cached
+    /// for it mustn't be used. Only the tables with a registered deletion
+    /// hook are tracked.
+    ///
+    bool isInsertionPending( const std::string& table, int64_t rowId );
+    ///
+    /// \brief canCacheReads Returns false if a commit completed, or was in
+    /// progress, since the current thread's read context was acquired.
+    /// The rows read through that context might then predate the commit, and
+    /// mustn't be cached, as nothing would replace them afterward.
+    ///
+    bool canCacheReads() const;
+
+    ///
+    /// \brief enqueueWrite Defers a small write to the write-behind queue.
+    /// Pending writes are committed in a single transaction, once enough of
+    /// them are queued, after a short delay, or before any other write
+    /// context is granted, so that the writes order is preserved.
+    /// \param done Invoked with the write context held once the write was
+    ///             committed (true) or dropped after failing (false). May
+    ///             be empty.
+    ///
+    void enqueueWrite( std::function<void()> write, std::function<void(bool)> done );
+    ///
+    /// \brief flush Blocks until all the currently pending writes are committed
+    /// This is a no-op when called with a transaction in progress, as the
+    /// pending writes have been committed before the transaction started.
+    /// \return false if some pending writes failed and were dropped meanwhile
+    ///
+    bool flush();
+    ///
+    /// \brief nbDroppedWrites Returns the number of pending writes which
+    /// failed and were dropped since this connection was created
+    ///
+    uint64_t nbDroppedWrites() const;
 
 private:
     static void updateHook( void* data, int reason, const char* database,
                             const char* table, sqlite_int64 rowId );
+    static int commitHook( void* data );
+    static void rollbackHook( void* data );
+    // Returns the index of the hook registered for table, or m_hooks.size()
+    // if there is none.
+    size_t hookIndex( const char* table ) const;
+    void dispatchDeletions();
+
+    struct Connection
+    {
+        using ConnPtr = std::unique_ptr<sqlite3, int(*)(sqlite3*)>;
+        Connection( ConnPtr conn, sqlite::QueryProfiler::Shard& stats );
+        // The statements must be finalized before the connection gets closed,
+        // so keep the connection declared first.
+        ConnPtr db;
+        sqlite::StatementCache statements;
+        sqlite::QueryProfiler::Shard& stats;
+    };
+    Connection& current();
+    // Must be called with m_connMutex held
+    Connection& writer();
+    Connection::ConnPtr open( int flags );
+    bool isWalEnabled();
+
+    // Must be called with the write context held
+    void flushPendingWrites();
+    struct PendingWrite
+    {
+        std::function<void()> write;
+        std::function<void(bool)> done;
+    };
+    bool commitPendingWrites( const std::vector<PendingWrite>& writes );
+    void flushThread();
+
+    void lockRead();
+    void unlockRead();
+    void lockWrite();
+    void unlockWrite();
 
 private:
-    using ConnPtr = std::unique_ptr<sqlite3, int(*)(sqlite3*)>;
+    // Uniquely identifies this instance, so the thread local bindings can't
+    // mistake a destroyed instance for a new one allocated at the same address
+    const unsigned int m_id;
     const std::string m_dbPath;
     compat::Mutex m_connMutex;
-    std::unordered_map<compat::Thread::id, ConnPtr> m_conns;
+    compat::ConditionVariable m_readerCond;
+    std::unique_ptr<Connection> m_writer;
+    std::vector<std::unique_ptr<Connection>> m_readers;
+    std::vector<Connection*> m_idleReaders;
+    // Set when the database was successfully switched to WAL journal mode.
+    // Readers then use their own snapshot and don't need to wait for
+    // writers. Otherwise, we fall back to excluding readers & writers.
+    bool m_walEnabled;
     utils::SWMRLock m_contextLock;
-    utils::ReadLocker m_readLock;
-    utils::WriteLocker m_writeLock;
-    std::unordered_map<std::string, UpdateHookCb> m_hooks;
+    ReadLocker m_readLock;
+    WriteLocker m_writeLock;
+    struct DeletionHook
+    {
+        std::string table;
+        DeletionHookCb cb;
+        // The rows deleted by the ongoing transaction, which can still be
+        // rolled back. Only accessed with the write context held.
+        std::unordered_set<int64_t> uncommitted;
+        // The committed deletions which weren't dispatched yet
+        // Guarded by m_dispatchLock
+        std::vector<int64_t> committed;
+        // The committed deletions for which the callbacks didn't run yet, with
+        // the number of times they were committed since a row id can be reused.
+        // Guarded by m_dispatchLock
+        std::unordered_map<int64_t, unsigned int> published;
+        // The rows inserted since the write context was acquired, which other
+        // threads mustn't see until it's released. Guarded by m_dispatchLock
+        std::unordered_set<int64_t> inserted;
+    };
+    struct TableNameHash
+    {
+        size_t operator()( const char* table ) const;
+    };
+    struct TableNameEqual
+    {
+        bool operator()( const char* lhs, const char* rhs ) const
+        {
+            return strcmp( lhs, rhs ) == 0;
+        }
+    };
+    std::vector<DeletionHook> m_hooks;
+    // Resolves the table names passed to the update hook without copying
+    // them. The keys point to the hooks' table names, and the map is rebuilt
+    // for each registration, as m_hooks might have been reallocated.
+    std::unordered_map<const char*, size_t, TableNameHash, TableNameEqual> m_hookIndexes;
+    // Only accessed with the write context held
+    bool m_hasPendingDeletions;
+    bool m_hasCommittedDeletions;
+    // Committed deletions are published as soon as the transaction is
+    // committed, so that other threads stop using the cached entities before
+    // the callbacks evicted them.
+    compat::Mutex m_dispatchLock;
+    std::atomic<size_t> m_nbPublished;
+    std::atomic<size_t> m_nbInserted;
+    // Incremented when the first commit of a write context starts, and when
+    // the context is released. An odd value means a commit might not be
+    // visible to all the connections yet.
+    std::atomic<unsigned int> m_commitGeneration;
+    sqlite::QueryProfiler m_profiler;
+    sqlite::BusyHandler m_busyHandler;
+
+    compat::Mutex m_pendingLock;
+    compat::ConditionVariable m_pendingCond;
+    std::vector<PendingWrite> m_pendingWrites;
+    std::atomic<uint64_t> m_nbDroppedWrites;
+    compat::Thread m_flushThread;
+    bool m_stopFlushThread;
+
+    static constexpr unsigned int MaxReadConnections = 8;
+    // Number of pending writes which triggers an immediate flush
+    static constexpr size_t MaxPendingWrites = 64;
+    // Maximum delay before committing pending writes
+    static constexpr std::chrono::milliseconds MaxPendingDelay{ 200 };
+    static std::atomic_uint NextId;
+    // The connection bound to the current thread, and how many nested read
+    // contexts are using it.
+    static thread_local unsigned int CurrentId;
+    static thread_local Connection* CurrentConnection;
+    static thread_local unsigned int CurrentReadDepth;
+    // The commit generation when the current read context was acquired
+    static thread_local unsigned int CurrentReadGeneration;
+    // The read binding saved while the thread holds the write connection
+    static thread_local Connection* SavedConnection;
+    static thread_local unsigned int SavedReadDepth;
 };
 
 }
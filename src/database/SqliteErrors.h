@@ -95,6 +95,15 @@ public:
     }
 };
 
+class NoContext : public Generic
+{
+public:
+    NoContext()
+        : Generic( "Accessing the database without a read or write context" )
+    {
+    }
+};
+
 static inline bool isInnocuous( int errCode )
 {
     switch ( errCode )
@@ -0,0 +1,265 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SqliteKeysetQuery.h"
+
+#include <sstream>
+
+#include "database/SqliteTools.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+namespace
+{
+// Bump this whenever the token format changes, to reject outdated tokens
+constexpr auto TokenVersion = 1;
+}
+
+KeysetQuery::KeysetQuery( std::string columns, std::string source, std::string filter,
+                          std::vector<Key> keys, std::string idColumn,
+                          SortingCriteria sort, bool desc )
+    : m_columns( std::move( columns ) )
+    , m_source( std::move( source ) )
+    , m_filter( std::move( filter ) )
+    , m_keys( std::move( keys ) )
+    , m_id( std::move( idColumn ), desc )
+    , m_sort( sort )
+{
+}
+
+KeysetQuery& KeysetQuery::groupBy( std::string groupBy )
+{
+    m_groupBy = std::move( groupBy );
+    return *this;
+}
+
+std::string KeysetQuery::request( bool limited ) const
+{
+    std::string req = "SELECT " + m_columns;
+    for ( const auto& k : m_keys )
+        req += ", " + k.column;
+    req += ", " + m_id.column + " FROM " + m_source;
+    std::string where;
+    if ( m_filter.empty() == false )
+        where = "(" + m_filter + ")";
+    if ( m_cursor.empty() == false )
+    {
+        std::vector<Value> unused;
+        if ( where.empty() == false )
+            where += " AND ";
+        where += after( unused );
+    }
+    if ( where.empty() == false )
+        req += " WHERE " + where;
+    if ( m_groupBy.empty() == false )
+        req += " GROUP BY " + m_groupBy;
+    req += " ORDER BY ";
+    for ( const auto& k : m_keys )
+    {
+        req += k.column;
+        if ( k.desc == true )
+            req += " DESC";
+        req += ", ";
+    }
+    req += m_id.column;
+    if ( m_id.desc == true )
+        req += " DESC";
+    if ( limited == true )
+        req += " LIMIT ?";
+    return req;
+}
+
+std::string KeysetQuery::idsRequest() const
+{
+    auto query = *this;
+    query.m_columns = m_id.column;
+    query.m_cursor.clear();
+    return query.request( false );
+}
+
+std::string KeysetQuery::countRequest() const
+{
+    // Grouped rows are counted through the grouping column
+    std::string req = "SELECT COUNT(" +
+            ( m_groupBy.empty() == true ? "*" : "DISTINCT " + m_groupBy ) +
+            ") FROM " + m_source;
+    if ( m_filter.empty() == false )
+        req += " WHERE " + m_filter;
+    return req;
+}
+
+std::vector<Value> KeysetQuery::bindings( uint32_t limit ) const
+{
+    std::vector<Value> values;
+    if ( m_cursor.empty() == false )
+        after( values );
+    if ( limit > 0 )
+        values.emplace_back( static_cast<int64_t>( limit ) );
+    return values;
+}
+
+std::string KeysetQuery::after( std::vector<Value>& values ) const
+{
+    // A row comes after the cursor if for some key, all the previous keys are
+    // equal to the cursor's, and this key comes after the cursor's.
+    // NULL values are sorted first in ascending order, last in descending order.
+    std::string res;
+    const auto nbKeys = m_keys.size() + 1;
+    for ( auto i = 0u; i < nbKeys; ++i )
+    {
+        const auto& key = i < m_keys.size() ? m_keys[i] : m_id;
+        const auto& value = m_cursor[i];
+        // Nothing but NULL comes after NULL in descending order, and those are
+        // handled by the next keys equality checks
+        if ( value.type == Value::Type::Null && key.desc == true )
+            continue;
+        if ( res.empty() == false )
+            res += " OR ";
+        res += "(";
+        // IS behaves like = but also matches NULL values
+        for ( auto j = 0u; j < i; ++j )
+        {
+            res += m_keys[j].column + " IS ? AND ";
+            values.push_back( m_cursor[j] );
+        }
+        if ( value.type == Value::Type::Null )
+            res += key.column + " IS NOT NULL";
+        else
+        {
+            if ( key.desc == true )
+                res += "(" + key.column + " < ? OR " + key.column + " IS NULL)";
+            else
+                res += key.column + " > ?";
+            values.push_back( value );
+        }
+        res += ")";
+    }
+    return "(" + res + ")";
+}
+
+std::string KeysetQuery::continuation( Row& row ) const
+{
+    std::ostringstream token;
+    token << TokenVersion << ';' << static_cast<int>( m_sort ) << ';'
+          << m_id.desc << ';' << m_id.column << ';' << m_keys.size() + 1 << ';';
+    token.precision( 17 );
+    const auto nbKeys = m_keys.size() + 1;
+    const auto firstKeyColumn = row.nbColumns() - nbKeys;
+    for ( auto i = 0u; i < nbKeys; ++i )
+    {
+        auto value = row.load<Value>( firstKeyColumn + i );
+        switch ( value.type )
+        {
+        case Value::Type::Integer:
+            token << 'i' << value.integer << ';';
+            break;
+        case Value::Type::Real:
+            token << 'r' << value.real << ';';
+            break;
+        case Value::Type::Text:
+            // Prefix the text with its length, since it can contain anything
+            token << 't' << value.text.size() << ':' << value.text;
+            break;
+        default:
+            token << "n;";
+            break;
+        }
+    }
+    return token.str();
+}
+
+bool KeysetQuery::resume( const std::string& continuation )
+{
+    m_cursor.clear();
+    std::istringstream token( continuation );
+    int version, sort, nbKeys;
+    bool desc;
+    std::string idColumn;
+    char sep;
+    if ( !( token >> version >> sep ) || version != TokenVersion ||
+         !( token >> sort >> sep ) || sort != static_cast<int>( m_sort ) ||
+         !( token >> desc >> sep ) || desc != m_id.desc ||
+         std::getline( token, idColumn, ';' ).fail() || idColumn != m_id.column ||
+         !( token >> nbKeys >> sep ) || nbKeys != static_cast<int>( m_keys.size() + 1 ) )
+        return false;
+    std::vector<Value> cursor;
+    for ( auto i = 0; i < nbKeys; ++i )
+    {
+        char type;
+        if ( !( token >> type ) )
+            return false;
+        switch ( type )
+        {
+        case 'i':
+        {
+            int64_t v;
+            if ( !( token >> v >> sep ) || sep != ';' )
+                return false;
+            cursor.emplace_back( v );
+            break;
+        }
+        case 'r':
+        {
+            double v;
+            if ( !( token >> v >> sep ) || sep != ';' )
+                return false;
+            cursor.emplace_back( v );
+            break;
+        }
+        case 't':
+        {
+            size_t size;
+            if ( !( token >> size >> sep ) || sep != ':' )
+                return false;
+            std::string v( size, 0 );
+            if ( size > 0 && token.read( &v[0], size ).fail() )
+                return false;
+            cursor.emplace_back( std::move( v ) );
+            break;
+        }
+        case 'n':
+            if ( !( token >> sep ) || sep != ';' )
+                return false;
+            cursor.emplace_back();
+            break;
+        default:
+            return false;
+        }
+    }
+    // The primary key can't be NULL
+    if ( cursor.back().type != Value::Type::Integer )
+        return false;
+    m_cursor = std::move( cursor );
+    return true;
+}
+
+}
+
+}
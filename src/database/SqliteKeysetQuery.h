@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "database/SqliteTraits.h"
+#include "medialibrary/IMediaLibrary.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+class Row;
+
+///
+/// \brief The KeysetQuery class builds a listing request which can be fetched
+/// page by page.
+///
+/// Instead of using an OFFSET, which requires sqlite to step over all the
+/// previous results, each page starts right after the sorting keys of the
+/// last row of the previous page. The position is handed to the caller as an
+/// opaque continuation token, which encodes those keys.
+/// The primary key is always used as the last sorting key, so that the order
+/// is total even when sorting keys are equal.
+///
+class KeysetQuery
+{
+public:
+    struct Key
+    {
+        Key( std::string c, bool d ) : column( std::move( c ) ), desc( d ) {}
+        std::string column;
+        bool desc;
+    };
+
+    ///
+    /// \param columns The selected columns, for instance "m.*"
+    /// \param source The table(s) to select from, including any join
+    /// \param filter The WHERE clause, without the WHERE keyword. Can be empty
+    /// \param keys The sorting keys
+    /// \param idColumn The primary key column
+    /// \param sort & desc The listing parameters. They are stored in the continuation
+    ///                    token, so a token can't be used with another ordering
+    ///
+    KeysetQuery( std::string columns, std::string source, std::string filter,
+                 std::vector<Key> keys, std::string idColumn,
+                 SortingCriteria sort, bool desc );
+
+    KeysetQuery& groupBy( std::string groupBy );
+    ///
+    /// \brief resume Positions this query after the row described by a continuation token
+    /// \return false if the token is invalid, or was generated for another ordering
+    ///
+    bool resume( const std::string& continuation );
+    ///
+    /// \brief request Returns the SQL request.
+    /// \param limited true if the request should end with a LIMIT parameter
+    ///
+    std::string request( bool limited ) const;
+    ///
+    /// \brief idsRequest Returns a request listing the primary keys of all
+    /// the rows, in order, as the first column
+    ///
+    std::string idsRequest() const;
+    ///
+    /// \brief countRequest Returns a request counting all the rows
+    ///
+    std::string countRequest() const;
+    ///
+    /// \brief bindings Returns the values to bind after the caller's own parameters
+    /// \param limit The maximum number of rows to fetch, or 0 for no limit.
+    ///              This must be consistent with the parameter given to request()
+    ///
+    std::vector<Value> bindings( uint32_t limit ) const;
+    ///
+    /// \brief continuation Returns a token pointing after the provided row
+    /// The row must have been fetched using this query's request()
+    ///
+    std::string continuation( Row& row ) const;
+
+private:
+    // Returns the condition selecting rows after the cursor, and appends the
+    // values to bind to it
+    std::string after( std::vector<Value>& values ) const;
+
+private:
+    std::string m_columns;
+    std::string m_source;
+    std::string m_filter;
+    std::string m_groupBy;
+    std::vector<Key> m_keys;
+    Key m_id;
+    SortingCriteria m_sort;
+    // The position of the last returned row: one value per key, and the primary key.
+    // Empty when fetching the first page
+    std::vector<Value> m_cursor;
+};
+
+}
+
+}
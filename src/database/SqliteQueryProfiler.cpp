@@ -0,0 +1,228 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SqliteQueryProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "logging/Logger.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+constexpr size_t QueryProfiler::Histogram::NbBuckets;
+
+QueryProfiler::Histogram::Histogram()
+    : m_buckets{}
+    , m_count( 0 )
+    , m_total( 0 )
+    , m_max( 0 )
+{
+}
+
+void QueryProfiler::Histogram::record( uint64_t us )
+{
+    size_t idx = 0;
+    for ( auto v = us; v != 0 && idx < NbBuckets - 1; v >>= 1 )
+        ++idx;
+    ++m_buckets[idx];
+    ++m_count;
+    m_total += us;
+    m_max = std::max( m_max, us );
+}
+
+void QueryProfiler::Histogram::merge( const Histogram& h )
+{
+    for ( auto i = 0u; i < NbBuckets; ++i )
+        m_buckets[i] += h.m_buckets[i];
+    m_count += h.m_count;
+    m_total += h.m_total;
+    m_max = std::max( m_max, h.m_max );
+}
+
+LatencyStats QueryProfiler::Histogram::stats() const
+{
+    return LatencyStats{ m_count, m_total, m_max,
+                         percentile( 0.50 ), percentile( 0.95 ), percentile( 0.99 ) };
+}
+
+uint64_t QueryProfiler::Histogram::percentile( double p ) const
+{
+    if ( m_count == 0 )
+        return 0;
+    auto target = static_cast<uint64_t>( std::ceil( p * m_count ) );
+    uint64_t seen = 0;
+    for ( auto i = 0u; i < NbBuckets; ++i )
+    {
+        seen += m_buckets[i];
+        if ( seen >= target )
+        {
+            // Upper bound of the bucket, which can't exceed the max sample
+            uint64_t upper = i == 0 ? 0 : ( uint64_t{ 1 } << i ) - 1;
+            return std::min( upper, m_max );
+        }
+    }
+    return m_max;
+}
+
+QueryProfiler::QueryProfiler()
+    : m_enabled( false )
+{
+}
+
+void QueryProfiler::setEnabled( bool enabled )
+{
+    m_enabled.store( enabled, std::memory_order_relaxed );
+}
+
+void QueryProfiler::Shard::record( const PrecompiledRequest& req, Duration duration,
+                                   uint64_t nbRows )
+{
+    auto us = toMicroseconds( duration );
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    if ( req.slot >= m_slots.size() )
+        m_slots.resize( req.slot + 1 );
+    auto& s = m_slots[req.slot];
+    if ( s.sql.empty() == true )
+        s.sql = req.sql;
+    s.entry.latency.record( us );
+    s.entry.nbRows += nbRows;
+}
+
+void QueryProfiler::Shard::record( const std::string& sql, Duration duration, uint64_t nbRows )
+{
+    auto us = toMicroseconds( duration );
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    auto& entry = m_queries[sql];
+    entry.latency.record( us );
+    entry.nbRows += nbRows;
+}
+
+QueryProfiler::Shard& QueryProfiler::newShard()
+{
+    std::unique_ptr<Shard> shard( new Shard );
+    auto& res = *shard;
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    m_shards.push_back( std::move( shard ) );
+    return res;
+}
+
+void QueryProfiler::recordReadLockWait( Duration duration )
+{
+    auto us = toMicroseconds( duration );
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    m_readLockWait.record( us );
+}
+
+void QueryProfiler::recordWriteLockWait( Duration duration )
+{
+    auto us = toMicroseconds( duration );
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    m_writeLockWait.record( us );
+}
+
+QueryProfile QueryProfiler::profile() const
+{
+    QueryProfile res;
+    std::unordered_map<std::string, Entry> queries;
+    auto merge = []( Entry& e, const Entry& from ) {
+        e.latency.merge( from.latency );
+        e.nbRows += from.nbRows;
+    };
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    for ( const auto& shard : m_shards )
+    {
+        std::lock_guard<compat::Mutex> shardLock( shard->m_lock );
+        for ( const auto& s : shard->m_slots )
+        {
+            if ( s.sql.empty() == false )
+                merge( queries[s.sql], s.entry );
+        }
+        for ( const auto& p : shard->m_queries )
+            merge( queries[p.first], p.second );
+    }
+    res.queries.reserve( queries.size() );
+    for ( const auto& p : queries )
+        res.queries.push_back( QueryStats{ p.first, p.second.latency.stats(), p.second.nbRows, {} } );
+    std::sort( begin( res.queries ), end( res.queries ), []( const QueryStats& a, const QueryStats& b ) {
+        return a.latency.total > b.latency.total;
+    });
+    res.readLockWait = m_readLockWait.stats();
+    res.writeLockWait = m_writeLockWait.stats();
+    return res;
+}
+
+void QueryProfiler::reset()
+{
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    for ( const auto& shard : m_shards )
+    {
+        std::lock_guard<compat::Mutex> shardLock( shard->m_lock );
+        shard->m_slots.clear();
+        shard->m_queries.clear();
+    }
+    m_readLockWait = Histogram{};
+    m_writeLockWait = Histogram{};
+}
+
+std::vector<std::string> QueryProfiler::explain( sqlite3* dbConn, const std::string& sql )
+{
+    std::vector<std::string> plan;
+    const auto req = "EXPLAIN QUERY PLAN " + sql;
+    sqlite3_stmt* stmt;
+    auto res = sqlite3_prepare_v2( dbConn, req.c_str(), -1, &stmt, nullptr );
+    if ( res != SQLITE_OK )
+    {
+        LOG_WARN( "Failed to explain ", sql, ": ", sqlite3_errmsg( dbConn ) );
+        return plan;
+    }
+    std::unique_ptr<sqlite3_stmt, int(*)(sqlite3_stmt*)> stmtPtr( stmt, &sqlite3_finalize );
+    // The detail column is the last one, regardless of the sqlite version
+    auto detailIdx = sqlite3_column_count( stmt ) - 1;
+    while ( ( res = sqlite3_step( stmt ) ) == SQLITE_ROW )
+    {
+        auto detail = reinterpret_cast<const char*>( sqlite3_column_text( stmt, detailIdx ) );
+        if ( detail != nullptr )
+            plan.emplace_back( detail );
+    }
+    if ( res != SQLITE_DONE )
+        LOG_WARN( "Failed to explain ", sql, ": ", sqlite3_errmsg( dbConn ) );
+    return plan;
+}
+
+uint64_t QueryProfiler::toMicroseconds( Duration d )
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>( d ).count();
+}
+
+}
+
+}
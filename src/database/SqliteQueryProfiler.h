@@ -0,0 +1,158 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sqlite3.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compat/Mutex.h"
+#include "database/SqliteStatementCache.h"
+#include "medialibrary/IMediaLibrary.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+///
+/// \brief The QueryProfiler class aggregates the execution time of each request
+/// and the time spent waiting for a database context.
+///
+/// Queries are recorded in a Shard per connection, so that concurrent threads
+/// don't contend on a single lock. Registered requests are indexed by their
+/// slot, and only the requests built at runtime are indexed by their content.
+/// The shards are merged by SQL text when calling profile(), so dynamically
+/// built requests which only differ by their bound parameters share the same
+/// entry.
+/// When disabled, recording only costs a relaxed atomic load. Callers are
+/// expected to check isEnabled() before sampling the clock.
+///
+class QueryProfiler
+{
+private:
+    // Bucket i holds the samples in [2^(i-1), 2^i) µs, bucket 0 holds 0µs
+    // samples. The last bucket holds everything above ~17 minutes.
+    class Histogram
+    {
+    public:
+        Histogram();
+        void record( uint64_t us );
+        void merge( const Histogram& h );
+        LatencyStats stats() const;
+
+    private:
+        uint64_t percentile( double p ) const;
+
+    private:
+        static constexpr size_t NbBuckets = 32;
+        uint64_t m_buckets[NbBuckets];
+        uint64_t m_count;
+        uint64_t m_total;
+        uint64_t m_max;
+    };
+
+    struct Entry
+    {
+        Histogram latency;
+        uint64_t nbRows = 0;
+    };
+
+public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    ///
+    /// \brief The Shard class holds the statistics of a single connection
+    /// Its lock is only contended while a profile is being gathered or reset.
+    ///
+    class Shard
+    {
+    public:
+        void record( const PrecompiledRequest& req, Duration duration, uint64_t nbRows );
+        void record( const std::string& sql, Duration duration, uint64_t nbRows );
+
+    private:
+        struct SlotEntry
+        {
+            // Left empty until the slot gets recorded for the first time
+            std::string sql;
+            Entry entry;
+        };
+
+        mutable compat::Mutex m_lock;
+        std::vector<SlotEntry> m_slots;
+        std::unordered_map<std::string, Entry> m_queries;
+
+        friend QueryProfiler;
+    };
+
+    QueryProfiler();
+    QueryProfiler( const QueryProfiler& ) = delete;
+    QueryProfiler& operator=( const QueryProfiler& ) = delete;
+
+    bool isEnabled() const
+    {
+        return m_enabled.load( std::memory_order_relaxed );
+    }
+    void setEnabled( bool enabled );
+
+    ///
+    /// \brief newShard Returns a new shard, to be used by a single connection
+    /// The shard lives as long as this profiler.
+    ///
+    Shard& newShard();
+    void recordReadLockWait( Duration duration );
+    void recordWriteLockWait( Duration duration );
+
+    ///
+    /// \brief profile Returns a snapshot of the gathered statistics
+    /// The query plans are not filled, see explain()
+    ///
+    QueryProfile profile() const;
+    void reset();
+
+    ///
+    /// \brief explain Returns the EXPLAIN QUERY PLAN output for the provided request
+    /// The request is compiled without going through the statement cache.
+    ///
+    static std::vector<std::string> explain( sqlite3* dbConn, const std::string& sql );
+
+private:
+    static uint64_t toMicroseconds( Duration d );
+
+private:
+    std::atomic_bool m_enabled;
+    mutable compat::Mutex m_lock;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    Histogram m_readLockWait;
+    Histogram m_writeLockWait;
+};
+
+}
+
+}
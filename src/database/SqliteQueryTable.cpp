@@ -0,0 +1,73 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SqliteQueryTable.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+constexpr size_t QueryTable::NbSortingCriteria;
+
+QueryTable::Variant::Variant( KeysetQuery q )
+    : query( std::move( q ) )
+    , unlimited( StatementCache::registerRequest( query.request( false ) ) )
+    , limited( StatementCache::registerRequest( query.request( true ) ) )
+    , ids( StatementCache::registerRequest( query.idsRequest() ) )
+{
+}
+
+QueryTable::QueryTable( Builder builder )
+{
+    m_variants.reserve( NbSortingCriteria * 2 );
+    for ( auto i = 0u; i < NbSortingCriteria; ++i )
+    {
+        auto sort = static_cast<SortingCriteria>( i );
+        m_variants.emplace_back( builder( sort, false ) );
+        m_variants.emplace_back( builder( sort, true ) );
+    }
+    m_count = StatementCache::registerRequest( variant( SortingCriteria::Default, false ).query.countRequest() );
+}
+
+const QueryTable::Variant& QueryTable::variant( SortingCriteria sort, bool desc ) const
+{
+    auto idx = static_cast<size_t>( sort );
+    // Fallback to the default ordering if we're given an unknown criteria
+    if ( idx >= NbSortingCriteria )
+        idx = static_cast<size_t>( SortingCriteria::Default );
+    return m_variants[idx * 2 + ( desc == true ? 1 : 0 )];
+}
+
+const PrecompiledRequest& QueryTable::count() const
+{
+    return m_count;
+}
+
+}
+
+}
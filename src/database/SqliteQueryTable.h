@@ -0,0 +1,89 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "database/SqliteKeysetQuery.h"
+#include "database/SqliteStatementCache.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+///
+/// \brief The QueryTable class holds all the ordering variants of a listing.
+///
+/// The variants are built once, by calling the provided builder for each
+/// sorting criteria and direction, and their first page requests are
+/// registered to the statement cache. Listing the first page of any variant
+/// then doesn't involve building nor looking up a request.
+/// Only the following pages, which depend on the continuation token, still
+/// need their request to be built.
+///
+/// The builder must only depend on its parameters: anything else must be
+/// bound as a request parameter.
+///
+class QueryTable
+{
+public:
+    using Builder = KeysetQuery (*)( SortingCriteria sort, bool desc );
+
+    struct Variant
+    {
+        Variant( KeysetQuery q );
+
+        KeysetQuery query;
+        PrecompiledRequest unlimited;
+        PrecompiledRequest limited;
+        PrecompiledRequest ids;
+
+        const PrecompiledRequest& request( bool isLimited ) const
+        {
+            return isLimited == true ? limited : unlimited;
+        }
+    };
+
+    explicit QueryTable( Builder builder );
+    QueryTable( const QueryTable& ) = delete;
+    QueryTable& operator=( const QueryTable& ) = delete;
+
+    const Variant& variant( SortingCriteria sort, bool desc ) const;
+    ///
+    /// \brief count Returns the request counting the listed rows, using the
+    /// default ordering variant's filter
+    ///
+    const PrecompiledRequest& count() const;
+
+private:
+    static constexpr size_t NbSortingCriteria = static_cast<size_t>( SortingCriteria::Artist ) + 1;
+    // Indexed by sorting criteria * 2 + desc
+    std::vector<Variant> m_variants;
+    PrecompiledRequest m_count;
+};
+
+}
+
+}
@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SqliteReadSnapshot.h"
+
+#include "SqliteTools.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+thread_local unsigned int ReadSnapshot::NbSnapshots = 0;
+
+ReadSnapshot::ReadSnapshot( DBConnection dbConn )
+    : m_dbConn( dbConn )
+    , m_ctx( dbConn->acquireReadContext() )
+    , m_owner( compat::this_thread::get_id() )
+    , m_ownsTransaction( false )
+{
+    // Nested snapshots, or snapshots acquired while holding the write
+    // context, are already part of a transaction
+    if ( sqlite3_get_autocommit( dbConn->getConn() ) == 0 )
+        return;
+    {
+        Statement s( dbConn, TransactionRequests::begin() );
+        s.execute();
+        while ( s.row() != nullptr )
+            ;
+    }
+    m_ownsTransaction = true;
+    ++NbSnapshots;
+    // A deferred transaction only acquires its snapshot upon the first read
+    Statement s( dbConn, "SELECT COUNT(*) FROM sqlite_master" );
+    s.execute();
+    while ( s.row() != nullptr )
+        ;
+}
+
+ReadSnapshot::~ReadSnapshot()
+{
+    try
+    {
+        release();
+    }
+    catch ( const std::exception& ex )
+    {
+        LOG_ERROR( "Failed to release read snapshot: ", ex.what() );
+    }
+}
+
+void ReadSnapshot::release()
+{
+    if ( m_ctx.owns_lock() == false )
+        return;
+    assert( m_owner == compat::this_thread::get_id() );
+    if ( m_ownsTransaction == true )
+    {
+        // Ensure the context is released even if ending the transaction fails
+        m_ownsTransaction = false;
+        --NbSnapshots;
+        auto ctx = std::move( m_ctx );
+        Statement s( m_dbConn, TransactionRequests::commit() );
+        s.execute();
+        while ( s.row() != nullptr )
+            ;
+        return;
+    }
+    m_ctx.unlock();
+}
+
+bool ReadSnapshot::snapshotInProgress()
+{
+    return NbSnapshots > 0;
+}
+
+}
+
+}
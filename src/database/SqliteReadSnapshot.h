@@ -0,0 +1,74 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include "medialibrary/IReadSnapshot.h"
+#include "database/SqliteConnection.h"
+#include "compat/Thread.h"
+#include "Types.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+///
+/// \brief The ReadSnapshot class holds a read context & a read transaction
+/// on the connection it binds to the calling thread.
+///
+/// Since nested read contexts reuse the connection bound to the thread, all
+/// reads performed by this thread until the snapshot is released share the
+/// same sqlite transaction, hence the same view of the database.
+/// Since that view can be outdated, entities loaded through it mustn't be
+/// added to the shared entity caches.
+///
+class ReadSnapshot : public IReadSnapshot
+{
+public:
+    explicit ReadSnapshot( DBConnection dbConn );
+    ReadSnapshot( const ReadSnapshot& ) = delete;
+    ReadSnapshot& operator=( const ReadSnapshot& ) = delete;
+    virtual ~ReadSnapshot();
+    virtual void release() override;
+
+    ///
+    /// \brief snapshotInProgress Returns true if the current thread reads
+    /// through a snapshot transaction
+    ///
+    static bool snapshotInProgress();
+
+private:
+    DBConnection m_dbConn;
+    SqliteConnection::ReadContext m_ctx;
+    compat::Thread::id m_owner;
+    // false when the snapshot was acquired while the thread already was in a
+    // transaction, which then provides the consistent view
+    bool m_ownsTransaction;
+
+    static thread_local unsigned int NbSnapshots;
+};
+
+}
+
+}
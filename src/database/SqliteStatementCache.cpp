@@ -0,0 +1,173 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SqliteStatementCache.h"
+
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+#include "SqliteErrors.h"
+#include "compat/Mutex.h"
+#include "logging/Logger.h"
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+namespace
+{
+
+struct Registry
+{
+    compat::Mutex lock;
+    std::vector<std::string> requests;
+    std::unordered_map<std::string, size_t> slots;
+};
+
+Registry& registry()
+{
+    static Registry r;
+    return r;
+}
+
+}
+
+StatementCache::StatementCache( sqlite3* dbConnection )
+    : m_dbConnection( dbConnection )
+{
+}
+
+sqlite3_stmt* StatementCache::get( const std::string& req )
+{
+    auto it = m_statements.find( req );
+    if ( it != end( m_statements ) )
+        return it->second.get();
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2( m_dbConnection, req.c_str(), -1, &stmt, NULL );
+    if ( res != SQLITE_OK )
+        throw errors::Generic( req.c_str(), sqlite3_errmsg( m_dbConnection ), res );
+    m_statements.emplace( req, CachedStmtPtr( stmt, &sqlite3_finalize ) );
+    return stmt;
+}
+
+sqlite3_stmt* StatementCache::get( const PrecompiledRequest& req )
+{
+    if ( req.slot < m_slots.size() && m_slots[req.slot] != nullptr )
+        return m_slots[req.slot].get();
+    return prepare( req.slot, req.sql );
+}
+
+sqlite3_stmt* StatementCache::prepare( size_t slot, const std::string& req )
+{
+    sqlite3_stmt* stmt;
+    int res = sqlite3_prepare_v2( m_dbConnection, req.c_str(), -1, &stmt, NULL );
+    if ( res != SQLITE_OK )
+        throw errors::Generic( req.c_str(), sqlite3_errmsg( m_dbConnection ), res );
+    if ( slot >= m_slots.size() )
+    {
+        m_slots.reserve( slot + 1 );
+        while ( m_slots.size() <= slot )
+            m_slots.emplace_back( nullptr, &sqlite3_finalize );
+    }
+    m_slots[slot].reset( stmt );
+    return stmt;
+}
+
+void StatementCache::prepareRegistered()
+{
+    std::vector<std::string> requests;
+    {
+        auto& r = registry();
+        std::lock_guard<compat::Mutex> lock( r.lock );
+        requests = r.requests;
+    }
+    for ( auto i = 0u; i < requests.size(); ++i )
+    {
+        if ( i < m_slots.size() && m_slots[i] != nullptr )
+            continue;
+        try
+        {
+            prepare( i, requests[i] );
+        }
+        catch ( const errors::Generic& ex )
+        {
+            // The tables & columns might not be created, or migrated, yet
+            const auto msg = sqlite3_errmsg( m_dbConnection );
+            if ( strncmp( msg, "no such table", 13 ) == 0 ||
+                 strncmp( msg, "no such column", 14 ) == 0 )
+            {
+                LOG_DEBUG( "Deferring the compilation of ", requests[i], ": ", msg );
+                continue;
+            }
+            LOG_ERROR( "Failed to compile registered request: ", ex.what() );
+            assert( !"Invalid registered request" );
+        }
+    }
+}
+
+PrecompiledRequest StatementCache::registerRequest( std::string req )
+{
+    auto& r = registry();
+    std::lock_guard<compat::Mutex> lock( r.lock );
+    auto it = r.slots.find( req );
+    if ( it != end( r.slots ) )
+        return PrecompiledRequest{ it->second, std::move( req ) };
+    auto slot = r.requests.size();
+    r.requests.push_back( req );
+    r.slots.emplace( req, slot );
+    return PrecompiledRequest{ slot, std::move( req ) };
+}
+
+void StatementCache::clear()
+{
+    m_statements.clear();
+    m_slots.clear();
+}
+
+const PrecompiledRequest& TransactionRequests::begin()
+{
+    static const auto req = StatementCache::registerRequest( "BEGIN" );
+    return req;
+}
+
+const PrecompiledRequest& TransactionRequests::commit()
+{
+    static const auto req = StatementCache::registerRequest( "COMMIT" );
+    return req;
+}
+
+const PrecompiledRequest& TransactionRequests::rollback()
+{
+    static const auto req = StatementCache::registerRequest( "ROLLBACK" );
+    return req;
+}
+
+}
+
+}
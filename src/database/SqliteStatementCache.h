@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <sqlite3.h>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace medialibrary
+{
+
+namespace sqlite
+{
+
+///
+/// \brief The PrecompiledRequest struct designates a request registered
+/// with StatementCache::registerRequest.
+/// Its statement is fetched by index, without hashing nor comparing the request.
+///
+struct PrecompiledRequest
+{
+    size_t slot;
+    std::string sql;
+};
+
+///
+/// \brief IsRequest Matches the types requests can be provided as: either a
+/// PrecompiledRequest, or a string for requests built at runtime
+///
+template <typename T>
+struct IsRequest : std::integral_constant<bool,
+        std::is_same<typename std::decay<T>::type, std::string>::value ||
+        std::is_same<typename std::decay<T>::type, PrecompiledRequest>::value>
+{
+};
+
+///
+/// \brief The TransactionRequests struct holds the requests controlling
+/// transactions, which are shared by all connections
+///
+struct TransactionRequests
+{
+    static const PrecompiledRequest& begin();
+    static const PrecompiledRequest& commit();
+    static const PrecompiledRequest& rollback();
+};
+
+///
+/// \brief The StatementCache class holds the prepared statements of a single
+/// sqlite connection.
+///
+/// Since each connection is only ever used by the thread that opened it, this
+/// cache doesn't need any locking.
+/// Static requests are registered once as PrecompiledRequest, and their
+/// statement is fetched through their slot. Requests built at runtime are
+/// looked up by content, so that they are still only compiled once.
+///
+class StatementCache
+{
+public:
+    explicit StatementCache( sqlite3* dbConnection );
+    StatementCache( const StatementCache& ) = delete;
+    StatementCache& operator=( const StatementCache& ) = delete;
+
+    ///
+    /// \brief get Returns a compiled version of the provided request
+    /// The returned statement is owned by the cache and remains valid until
+    /// the cache is cleared.
+    ///
+    sqlite3_stmt* get( const std::string& req );
+    sqlite3_stmt* get( const PrecompiledRequest& req );
+    ///
+    /// \brief prepareRegistered Compiles all the requests registered so far
+    /// This is meant to be called once the connection is opened. Requests
+    /// whose tables or columns don't exist yet will be compiled upon their
+    /// first use. Any other compilation failure is a bug in the request, and
+    /// is reported as an error, and asserted on in debug builds.
+    ///
+    void prepareRegistered();
+    void clear();
+
+    ///
+    /// \brief registerRequest Registers a request to be compiled for all the
+    /// connections.
+    /// Registering the same request twice returns the same slot. This is
+    /// thread safe, but meant to be done once per request, for instance when
+    /// initializing a static variable.
+    ///
+    static PrecompiledRequest registerRequest( std::string req );
+
+private:
+    sqlite3_stmt* prepare( size_t slot, const std::string& req );
+
+private:
+    using CachedStmtPtr = std::unique_ptr<sqlite3_stmt, int (*)(sqlite3_stmt*)>;
+
+    sqlite3* m_dbConnection;
+    // The compiled requests built at runtime, indexed by their content
+    std::unordered_map<std::string, CachedStmtPtr> m_statements;
+    // The compiled registered requests, indexed by slot
+    std::vector<CachedStmtPtr> m_slots;
+};
+
+}
+
+}
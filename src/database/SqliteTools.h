@@ -26,15 +26,16 @@
 #include <cassert>
 #include <chrono>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <sqlite3.h>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-#include <compat/Mutex.h>
 #include "database/SqliteConnection.h"
 #include "database/SqliteErrors.h"
+#include "database/SqliteStatementCache.h"
 #include "database/SqliteTraits.h"
 #include "database/SqliteTransaction.h"
 #include "logging/Logger.h"
@@ -118,35 +119,33 @@ private:
 class Statement
 {
 public:
-    Statement( SqliteConnection::Handle dbConnection, const std::string& req )
-        : m_stmt( nullptr, [](sqlite3_stmt* stmt) {
-                sqlite3_clear_bindings( stmt );
-                sqlite3_reset( stmt );
-            })
-        , m_dbConn( dbConnection )
-        , m_bindIdx( 0 )
-        , m_isCommit( false )
+    Statement( SqliteConnection::Handle dbConnection, StatementCache& cache,
+               BusyHandler& busyHandler, const std::string& req )
+        : Statement( dbConnection, busyHandler, cache.get( req ), false )
     {
-        std::lock_guard<compat::Mutex> lock( StatementsCacheLock );
-        auto& connMap = StatementsCache[ dbConnection ];
-        auto it = connMap.find( req );
-        if ( it == end( connMap ) )
-        {
-            sqlite3_stmt* stmt;
-            int res = sqlite3_prepare_v2( dbConnection, req.c_str(), -1, &stmt, NULL );
-            if ( res != SQLITE_OK )
-            {
-                throw errors::Generic( req.c_str(), sqlite3_errmsg( dbConnection ), res );
-            }
-            m_stmt.reset( stmt );
-            connMap.emplace( req, CachedStmtPtr( stmt, &sqlite3_finalize ) );
-        }
-        else
-        {
-            m_stmt.reset( it->second.get() );
-        }
-        if ( req == "COMMIT" )
-            m_isCommit = true;
+    }
+
+    Statement( SqliteConnection::Handle dbConnection, StatementCache& cache,
+               BusyHandler& busyHandler, const PrecompiledRequest& req )
+        : Statement( dbConnection, busyHandler, cache.get( req ),
+                     req.slot == TransactionRequests::commit().slot )
+    {
+    }
+
+    template <typename Req>
+    Statement( DBConnection dbConnection, const Req& req )
+        : Statement( dbConnection->getConn(), dbConnection->statementCache(),
+                     dbConnection->busyHandler(), req )
+    {
+    }
+
+    ///
+    /// \brief reset Allows the statement to be executed again
+    /// All parameters must be bound again by the next call to execute()
+    ///
+    void reset()
+    {
+        sqlite3_reset( m_stmt.get() );
     }
 
     template <typename... Args>
@@ -158,7 +157,9 @@ public:
 
     Row row()
     {
-        auto maxRetries = 10;
+        // Bound the busy handler waits and our own retries as a whole
+        BusyHandler::Deadline deadline;
+        unsigned int nbRetries = 0;
         while ( true )
         {
             auto extRes = sqlite3_step( m_stmt.get() );
@@ -168,8 +169,11 @@ public:
             else if ( res == SQLITE_DONE )
                 return Row();
             else if ( ( Transaction::transactionInProgress() == false || m_isCommit == true ) &&
-                     errors::isInnocuous( res ) && maxRetries-- > 0 )
-                continue;
+                     errors::isInnocuous( res ) )
+            {
+                if ( m_busyHandler.backoff( nbRetries++ ) == true )
+                    continue;
+            }
             auto errMsg = sqlite3_errmsg( m_dbConn );
             switch ( res )
             {
@@ -181,15 +185,23 @@ public:
         }
     }
 
-    static void FlushStatementCache()
+private:
+    Statement( SqliteConnection::Handle dbConnection, BusyHandler& busyHandler,
+               sqlite3_stmt* stmt, bool isCommit )
+        : m_stmt( stmt, [](sqlite3_stmt* stmt) {
+                sqlite3_clear_bindings( stmt );
+                sqlite3_reset( stmt );
+            })
+        , m_dbConn( dbConnection )
+        , m_busyHandler( busyHandler )
+        , m_bindIdx( 0 )
+        , m_isCommit( isCommit )
     {
-        std::lock_guard<compat::Mutex> lock( StatementsCacheLock );
-        StatementsCache.clear();
     }
 
-private:
     template <typename T>
-    bool _bind( T&& value )
+    typename std::enable_if<!IsSameDecay<T, std::vector<Value>>::value, bool>::type
+    _bind( T&& value )
     {
         auto res = Traits<T>::Bind( m_stmt.get(), m_bindIdx, std::forward<T>( value ) );
         if ( res != SQLITE_OK )
@@ -198,19 +210,24 @@ private:
         return true;
     }
 
+    // Binds a list of values, whose size is only known at runtime, to
+    // consecutive parameters
+    bool _bind( const std::vector<Value>& values )
+    {
+        for ( const auto& v : values )
+            _bind( v );
+        return true;
+    }
+
 private:
-    // Used during the connection lifetime. This holds a compiled request
-    using CachedStmtPtr = std::unique_ptr<sqlite3_stmt, int (*)(sqlite3_stmt*)>;
     // Used for the current statement execution, this
     // basically holds the state of the currently executed request.
     using StatementPtr = std::unique_ptr<sqlite3_stmt, void(*)(sqlite3_stmt*)>;
     StatementPtr m_stmt;
     SqliteConnection::Handle m_dbConn;
+    BusyHandler& m_busyHandler;
     unsigned int m_bindIdx;
     bool m_isCommit;
-    static compat::Mutex StatementsCacheLock;
-    static std::unordered_map<SqliteConnection::Handle,
-                            std::unordered_map<std::string, CachedStmtPtr>> StatementsCache;
 };
 
 class Tools
@@ -223,8 +240,8 @@ class Tools
          * @param results   A reference to the result vector. All existing elements will
          *                  be discarded.
          */
-        template <typename IMPL, typename INTF, typename... Args>
-        static std::vector<std::shared_ptr<INTF> > fetchAll( MediaLibraryPtr ml, const std::string& req, Args&&... args )
+        template <typename IMPL, typename INTF, typename Req, typename... Args>
+        static std::vector<std::shared_ptr<INTF> > fetchAll( MediaLibraryPtr ml, const Req& req, Args&&... args )
         {
             auto dbConnection = ml->getConn();
             SqliteConnection::ReadContext ctx;
@@ -233,7 +250,7 @@ class Tools
             auto chrono = std::chrono::steady_clock::now();
 
             std::vector<std::shared_ptr<INTF>> results;
-            Statement stmt( dbConnection->getConn(), req );
+            Statement stmt( dbConnection, req );
             stmt.execute( std::forward<Args>( args )... );
             Row sqliteRow;
             while ( ( sqliteRow = stmt.row() ) != nullptr )
@@ -241,14 +258,12 @@ class Tools
                 auto row = IMPL::load( ml, sqliteRow );
                 results.push_back( row );
             }
-            auto duration = std::chrono::steady_clock::now() - chrono;
-            LOG_DEBUG("Executed ", req, " in ",
-                     std::chrono::duration_cast<std::chrono::microseconds>( duration ).count(), "µs" );
+            profile( dbConnection, req, chrono, results.size() );
             return results;
         }
 
-        template <typename T, typename... Args>
-        static std::shared_ptr<T> fetchOne( MediaLibraryPtr ml, const std::string& req, Args&&... args )
+        template <typename T, typename Req, typename... Args>
+        static std::shared_ptr<T> fetchOne( MediaLibraryPtr ml, const Req& req, Args&&... args )
         {
             auto dbConnection = ml->getConn();
             SqliteConnection::ReadContext ctx;
@@ -256,20 +271,45 @@ class Tools
                 ctx = dbConnection->acquireReadContext();
             auto chrono = std::chrono::steady_clock::now();
 
-            Statement stmt( dbConnection->getConn(), req );
+            Statement stmt( dbConnection, req );
             stmt.execute( std::forward<Args>( args )... );
             auto row = stmt.row();
             std::shared_ptr<T> res;
             if ( row != nullptr )
                 res = T::load( ml, row );
-            auto duration = std::chrono::steady_clock::now() - chrono;
-            LOG_DEBUG("Executed ", req, " in ",
-                     std::chrono::duration_cast<std::chrono::microseconds>( duration ).count(), "µs" );
+            profile( dbConnection, req, chrono, res != nullptr ? 1 : 0 );
             return res;
         }
 
-        template <typename... Args>
-        static bool executeRequest( DBConnection dbConnection, const std::string& req, Args&&... args )
+        /**
+         * Calls f on each row returned by the request, without instantiating
+         * any entity. This allows callers to only select & decode the columns
+         * they need. TEXT columns can be extracted as TextView to avoid copying
+         * them, as long as the views aren't used after f returns.
+         */
+        template <typename Req, typename F, typename... Args>
+        static void forEachRow( MediaLibraryPtr ml, const Req& req, F&& f, Args&&... args )
+        {
+            auto dbConnection = ml->getConn();
+            SqliteConnection::ReadContext ctx;
+            if (Transaction::transactionInProgress() == false)
+                ctx = dbConnection->acquireReadContext();
+            auto chrono = std::chrono::steady_clock::now();
+
+            Statement stmt( dbConnection, req );
+            stmt.execute( std::forward<Args>( args )... );
+            Row row;
+            uint64_t nbRows = 0;
+            while ( ( row = stmt.row() ) != nullptr )
+            {
+                f( row );
+                ++nbRows;
+            }
+            profile( dbConnection, req, chrono, nbRows );
+        }
+
+        template <typename Req, typename... Args>
+        static bool executeRequest( DBConnection dbConnection, const Req& req, Args&&... args )
         {
             SqliteConnection::WriteContext ctx;
             if (Transaction::transactionInProgress() == false)
@@ -277,8 +317,8 @@ class Tools
             return executeRequestLocked( dbConnection, req, std::forward<Args>( args )... );
         }
 
-        template <typename... Args>
-        static bool executeDelete( DBConnection dbConnection, const std::string& req, Args&&... args )
+        template <typename Req, typename... Args>
+        static bool executeDelete( DBConnection dbConnection, const Req& req, Args&&... args )
         {
             SqliteConnection::WriteContext ctx;
             if (Transaction::transactionInProgress() == false)
@@ -288,19 +328,51 @@ class Tools
             return sqlite3_changes( dbConnection->getConn() ) > 0;
         }
 
-        template <typename... Args>
-        static bool executeUpdate( DBConnection dbConnection, const std::string& req, Args&&... args )
+        template <typename Req, typename... Args>
+        static bool executeUpdate( DBConnection dbConnection, const Req& req, Args&&... args )
         {
             // The code would be exactly the same, do not freak out because it calls executeDelete :)
             return executeDelete( dbConnection, req, std::forward<Args>( args )... );
         }
 
+        /**
+         * Defers an update to the connection's write-behind queue, so that it
+         * gets committed along with other small updates.
+         * This is meant for updates of columns which aren't used to filter nor
+         * sort listings, since other requests won't see them until the queue
+         * is committed.
+         * The request and its parameters are copied into the queue.
+         * The provided owner, which may be null, is kept alive until the update
+         * is committed. done, which may be empty, is invoked once the update
+         * was committed (true) or dropped after failing (false), so that the
+         * caller can discard the in-memory value it already updated.
+         * When a transaction is in progress, the update is executed as part of it.
+         * \return false if the update failed while executed as part of a
+         *         transaction. A queued update is only known to have failed
+         *         through done.
+         */
+        template <typename Req, typename... Args>
+        static bool executeDeferredUpdate( DBConnection dbConnection, std::shared_ptr<void> owner,
+                                           std::function<void(bool)> done,
+                                           const Req& req, Args&&... args )
+        {
+            if ( Transaction::transactionInProgress() == true )
+                return executeUpdate( dbConnection, req, std::forward<Args>( args )... );
+            auto write = std::bind(
+                        &Tools::executeQueuedRequest<Req, typename std::decay<Args>::type...>,
+                        dbConnection, req, std::forward<Args>( args )... );
+            dbConnection->enqueueWrite( [owner, write]() {
+                write();
+            }, std::move( done ) );
+            return true;
+        }
+
         /**
          * Inserts a record to the DB and return the newly created primary key.
          * Returns 0 (which is an invalid sqlite primary key) when insertion fails.
          */
-        template <typename... Args>
-        static int64_t executeInsert( DBConnection dbConnection, const std::string& req, Args&&... args )
+        template <typename Req, typename... Args>
+        static int64_t executeInsert( DBConnection dbConnection, const Req& req, Args&&... args )
         {
             SqliteConnection::WriteContext ctx;
             if (Transaction::transactionInProgress() == false)
@@ -310,15 +382,52 @@ class Tools
             return sqlite3_last_insert_rowid( dbConnection->getConn() );
         }
 
+        /**
+         * Inserts one record per element of values, compiling and binding the
+         * request only once. bind is called with the statement and each element,
+         * and is expected to call Statement::execute with the element's parameters.
+         * Returns the primary key of each inserted record, in the same order.
+         * This is meant to be called with a transaction in progress, otherwise
+         * each record would be committed on its own, and a failure would leave
+         * the batch partially inserted.
+         */
+        template <typename Req, typename T, typename F>
+        static std::vector<int64_t> executeInsertBatch( DBConnection dbConnection, const Req& req,
+                                                        const std::vector<T>& values, F&& bind )
+        {
+            SqliteConnection::WriteContext ctx;
+            if (Transaction::transactionInProgress() == false)
+                ctx = dbConnection->acquireWriteContext();
+            auto chrono = std::chrono::steady_clock::now();
+            std::vector<int64_t> pKeys;
+            pKeys.reserve( values.size() );
+            Statement stmt( dbConnection, req );
+            for ( const auto& v : values )
+            {
+                bind( stmt, v );
+                while ( stmt.row() != nullptr )
+                    ;
+                pKeys.push_back( sqlite3_last_insert_rowid( dbConnection->getConn() ) );
+                stmt.reset();
+            }
+            profile( dbConnection, req, chrono, 0 );
+            return pKeys;
+        }
+
         /**
          * \brief   Automatically retry a code block when innocuous sqlite errors occur.
          *
          * We can't retry individual requests as sqlite might implicitely rollback the current transaction
          * causing previously sucessfuly inserted entities to be removed from the database.
+         * Each retry is delayed according to the connection's busy policy, and
+         * the error is rethrown once the policy deadline expired. The deadline
+         * applies to all the attempts, including the waits performed by their
+         * statements.
          */
         template <typename T, typename... Args>
-        static auto withRetries( uint8_t nbRetries, T&& f, Args&&... args ) -> decltype( f( args... ) )
+        static auto withRetries( DBConnection dbConnection, uint8_t nbRetries, T&& f, Args&&... args ) -> decltype( f( args... ) )
         {
+            BusyHandler::Deadline deadline;
             uint8_t i = 0;
             while ( true )
             {
@@ -330,6 +439,8 @@ class Tools
                 {
                     if ( i > nbRetries || sqlite::errors::isInnocuous( ex ) == false )
                         throw;
+                    if ( dbConnection->busyHandler().backoff( i ) == false )
+                        throw;
                     ++i;
                     LOG_WARN( ex.what(), ". Retrying (", i, '/', nbRetries, ')' );
                 }
@@ -337,19 +448,45 @@ class Tools
         }
 
     private:
-        template <typename... Args>
-        static bool executeRequestLocked( DBConnection dbConnection, const std::string& req, Args&&... args )
+        template <typename Req, typename... Args>
+        static void executeQueuedRequest( DBConnection dbConnection, const Req& req,
+                                          const Args&... args )
+        {
+            executeRequestLocked( dbConnection, req, args... );
+        }
+
+        template <typename Req, typename... Args>
+        static bool executeRequestLocked( DBConnection dbConnection, const Req& req, Args&&... args )
         {
             auto chrono = std::chrono::steady_clock::now();
-            Statement stmt( dbConnection->getConn(), req );
+            Statement stmt( dbConnection, req );
             stmt.execute( std::forward<Args>( args )... );
             while ( stmt.row() != nullptr )
                 ;
-            auto duration = std::chrono::steady_clock::now() - chrono;
-            LOG_DEBUG("Executed ", req, " in ",
-                     std::chrono::duration_cast<std::chrono::microseconds>( duration ).count(), "µs" );
+            profile( dbConnection, req, chrono, 0 );
             return true;
         }
+
+        template <typename Req>
+        static void profile( DBConnection dbConnection, const Req& req,
+                             std::chrono::steady_clock::time_point start, uint64_t nbRows )
+        {
+            auto duration = std::chrono::steady_clock::now() - start;
+            if ( dbConnection->profiler().isEnabled() == true )
+                dbConnection->queryStats().record( req, duration, nbRows );
+            LOG_DEBUG("Executed ", sqlOf( req ), " in ",
+                     std::chrono::duration_cast<std::chrono::microseconds>( duration ).count(), "µs" );
+        }
+
+        static const std::string& sqlOf( const PrecompiledRequest& req )
+        {
+            return req.sql;
+        }
+
+        static const std::string& sqlOf( const std::string& req )
+        {
+            return req;
+        }
 };
 
 }
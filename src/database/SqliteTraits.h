@@ -22,7 +22,11 @@
 
 #pragma once
 
+#include <cstring>
 #include <sqlite3.h>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace medialibrary
 {
@@ -36,6 +40,61 @@ struct ForeignKey
     unsigned int value;
 };
 
+///
+/// \brief The TextView class is a non owning view over a TEXT column.
+/// It allows a column to be inspected without copying it to a std::string.
+/// It is only valid until the statement it was extracted from is stepped again,
+/// reset, or destroyed.
+///
+class TextView
+{
+public:
+    constexpr TextView() : m_data( "" ), m_size( 0 ) {}
+    constexpr TextView( const char* data, size_t size ) : m_data( data ), m_size( size ) {}
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    std::string str() const { return std::string( m_data, m_size ); }
+
+    bool operator==( const TextView& v ) const
+    {
+        return m_size == v.m_size && memcmp( m_data, v.m_data, m_size ) == 0;
+    }
+    bool operator!=( const TextView& v ) const { return !( *this == v ); }
+    bool operator==( const std::string& s ) const { return *this == TextView( s.c_str(), s.size() ); }
+    bool operator!=( const std::string& s ) const { return !( *this == s ); }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+///
+/// \brief The Value class holds a column value whose type is only known at
+/// runtime, for instance a sorting key.
+///
+struct Value
+{
+    enum class Type
+    {
+        Null,
+        Integer,
+        Real,
+        Text,
+    };
+
+    Value() : type( Type::Null ), integer( 0 ), real( 0 ) {}
+    explicit Value( int64_t i ) : type( Type::Integer ), integer( i ), real( 0 ) {}
+    explicit Value( double d ) : type( Type::Real ), integer( 0 ), real( d ) {}
+    explicit Value( std::string t ) : type( Type::Text ), integer( 0 ), real( 0 ), text( std::move( t ) ) {}
+
+    Type type;
+    int64_t integer;
+    double real;
+    std::string text;
+};
+
 template <typename ToCheck, typename T>
 using IsSameDecay = std::is_same<typename std::decay<ToCheck>::type, T>;
 
@@ -78,11 +137,30 @@ struct Traits<T, typename std::enable_if<IsSameDecay<T, std::string>::value>::ty
     {
         auto tmp = (const char*)sqlite3_column_text( stmt, pos );
         if ( tmp != nullptr )
-            return std::string( tmp );
+            return std::string( tmp, sqlite3_column_bytes( stmt, pos ) );
         return std::string();
     }
 };
 
+template <typename T>
+struct Traits<T, typename std::enable_if<IsSameDecay<T, TextView>::value>::type>
+{
+    static int Bind(sqlite3_stmt* stmt, int pos, TextView value )
+    {
+        return sqlite3_bind_text( stmt, pos, value.data(), value.size(), SQLITE_STATIC );
+    }
+
+    static TextView Load( sqlite3_stmt* stmt, int pos )
+    {
+        // sqlite3_column_bytes must be called after sqlite3_column_text, as the
+        // latter might convert the value
+        auto tmp = (const char*)sqlite3_column_text( stmt, pos );
+        if ( tmp != nullptr )
+            return TextView( tmp, sqlite3_column_bytes( stmt, pos ) );
+        return TextView();
+    }
+};
+
 template <typename T>
 struct Traits<T, typename std::enable_if<std::is_floating_point<
         typename std::decay<T>::type
@@ -95,6 +173,45 @@ struct Traits<T, typename std::enable_if<std::is_floating_point<
         (*Load)(sqlite3_stmt *, int) = &sqlite3_column_double;
 };
 
+template <typename T>
+struct Traits<T, typename std::enable_if<IsSameDecay<T, Value>::value>::type>
+{
+    static int Bind( sqlite3_stmt* stmt, int pos, const Value& value )
+    {
+        switch ( value.type )
+        {
+        case Value::Type::Integer:
+            return sqlite3_bind_int64( stmt, pos, value.integer );
+        case Value::Type::Real:
+            return sqlite3_bind_double( stmt, pos, value.real );
+        case Value::Type::Text:
+            return sqlite3_bind_text( stmt, pos, value.text.c_str(), value.text.size(), SQLITE_STATIC );
+        default:
+            return sqlite3_bind_null( stmt, pos );
+        }
+    }
+
+    static Value Load( sqlite3_stmt* stmt, int pos )
+    {
+        switch ( sqlite3_column_type( stmt, pos ) )
+        {
+        case SQLITE_INTEGER:
+            return Value( static_cast<int64_t>( sqlite3_column_int64( stmt, pos ) ) );
+        case SQLITE_FLOAT:
+            return Value( sqlite3_column_double( stmt, pos ) );
+        case SQLITE_NULL:
+            return Value();
+        default:
+        {
+            auto tmp = (const char*)sqlite3_column_text( stmt, pos );
+            if ( tmp == nullptr )
+                return Value( std::string() );
+            return Value( std::string( tmp, sqlite3_column_bytes( stmt, pos ) ) );
+        }
+        }
+    }
+};
+
 template <>
 struct Traits<std::nullptr_t>
 {
@@ -42,7 +42,7 @@ Transaction::Transaction(DBConnection dbConn)
 {
     assert( CurrentTransaction == nullptr );
     LOG_DEBUG( "Starting SQLite transaction" );
-    Statement s( dbConn->getConn(), "BEGIN" );
+    Statement s( dbConn, TransactionRequests::begin() );
     s.execute();
     while ( s.row() != nullptr )
         ;
@@ -53,7 +53,7 @@ void Transaction::commit()
 {
     assert( CurrentTransaction != nullptr );
     auto chrono = std::chrono::steady_clock::now();
-    Statement s( m_dbConn->getConn(), "COMMIT" );
+    Statement s( m_dbConn, TransactionRequests::commit() );
     s.execute();
     while ( s.row() != nullptr )
         ;
@@ -82,7 +82,7 @@ Transaction::~Transaction()
     {
         if ( CurrentTransaction != nullptr )
         {
-            Statement s( m_dbConn->getConn(), "ROLLBACK" );
+            Statement s( m_dbConn, TransactionRequests::rollback() );
             s.execute();
             while ( s.row() != nullptr )
                 ;
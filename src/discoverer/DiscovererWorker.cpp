@@ -199,7 +199,13 @@ void DiscovererWorker::runRemove( const std::string& ep )
     // method already handles the prior deletion
     bool res;
     if ( folder->isRootFolder() == false )
+    {
+        // Evict the media which had a file in the folder, to avoid stalled media
+        auto mediaIds = Folder::subtreeMediaIds( m_ml, folder->id() );
         res = Folder::blacklist( m_ml, entryPoint );
+        if ( res == true )
+            Media::invalidate( m_ml, mediaIds );
+    }
     else
         res = m_ml->deleteFolder( *folder );
     if ( res == false )
@@ -207,8 +213,6 @@ void DiscovererWorker::runRemove( const std::string& ep )
         m_ml->getCb()->onEntryPointRemoved( ep, false );
         return;
     }
-    // Force a cache cleanup to avoid stalled media
-    Media::clear();
     m_ml->getCb()->onEntryPointRemoved( ep, true );
 }
 
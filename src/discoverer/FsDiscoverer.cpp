@@ -35,6 +35,7 @@
 #include "File.h"
 #include "Device.h"
 #include "Folder.h"
+#include "database/SqliteTools.h"
 #include "logging/Logger.h"
 #include "MediaLibrary.h"
 #include "utils/Filename.h"
@@ -251,40 +252,68 @@ void FsDiscoverer::checkFolder( fs::IDirectory& currentFolderFs, Folder& current
 void FsDiscoverer::checkFiles( fs::IDirectory& parentFolderFs, Folder& parentFolder ) const
 {
     LOG_INFO( "Checking file in ", parentFolderFs.mrl() );
-    static const std::string req = "SELECT * FROM " + policy::FileTable::Name
-            + " WHERE folder_id = ?";
-    auto files = File::fetchAll<File>( m_ml, req, parentFolder.id() );
+    // Only select what's needed to detect the changes, so we don't instantiate
+    // a File for each unmodified file
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT id_file, mrl, last_modification_date, is_removable FROM "
+            + policy::FileTable::Name + " WHERE folder_id = ?" );
+    const auto& filesFs = parentFolderFs.files();
+    std::vector<bool> knownFilesFs( filesFs.size(), false );
+    std::vector<int64_t> removedFileIds;
+    std::vector<int64_t> modifiedFileIds;
     std::vector<std::shared_ptr<fs::IFile>> filesToAdd;
-    std::vector<std::shared_ptr<File>> filesToRemove;
-    for ( const auto& fileFs: parentFolderFs.files() )
-    {
-        auto it = std::find_if( begin( files ), end( files ), [fileFs](const std::shared_ptr<File>& f) {
-            return f->mrl() == fileFs->mrl();
+    sqlite::Tools::forEachRow( m_ml, req, [&]( sqlite::Row& row ) {
+        int64_t id;
+        sqlite::TextView mrl;
+        unsigned int lastModificationDate;
+        bool isRemovable;
+        row >> id >> mrl >> lastModificationDate >> isRemovable;
+        // Files on removable devices only store their name
+        auto it = std::find_if( begin( filesFs ), end( filesFs ), [&mrl, isRemovable](const std::shared_ptr<fs::IFile>& f) {
+            return mrl == ( isRemovable == true ? f->name() : f->mrl() );
         });
-        if ( it == end( files ) )
+        if ( it == end( filesFs ) )
         {
-            filesToAdd.push_back( std::move( fileFs ) );
-            continue;
+            removedFileIds.push_back( id );
+            return;
         }
-        if ( fileFs->lastModificationDate() == (*it)->lastModificationDate() )
+        knownFilesFs[it - begin( filesFs )] = true;
+        if ( (*it)->lastModificationDate() == lastModificationDate )
         {
             // Unchanged file
-            files.erase( it );
-            continue;
+            return;
         }
-        auto& file = (*it);
-        LOG_INFO( "Forcing file refresh ", fileFs->mrl() );
+        LOG_INFO( "Forcing file refresh ", (*it)->mrl() );
+        modifiedFileIds.push_back( id );
+        filesToAdd.push_back( *it );
+    }, parentFolder.id() );
+    for ( auto i = 0u; i < filesFs.size(); ++i )
+    {
+        if ( knownFilesFs[i] == false )
+            filesToAdd.push_back( filesFs[i] );
+    }
+    std::vector<std::shared_ptr<File>> files;
+    for ( auto id : removedFileIds )
+    {
+        auto file = File::fetch( m_ml, id );
+        if ( file != nullptr )
+            files.push_back( std::move( file ) );
+    }
+    std::vector<std::shared_ptr<File>> filesToRemove;
+    for ( auto id : modifiedFileIds )
+    {
+        auto file = File::fetch( m_ml, id );
+        if ( file == nullptr )
+            continue;
         // Pre-cache the file's media, since we need it to remove. However, better doing it
         // out of a write context, since that way, other threads can also read the database.
         file->media();
         filesToRemove.push_back( std::move( file ) );
-        filesToAdd.push_back( std::move( fileFs ) );
-        files.erase( it );
     }
     using FilesT = decltype( files );
     using FilesToRemoveT = decltype( filesToRemove );
     using FilesToAddT = decltype( filesToAdd );
-    sqlite::Tools::withRetries( 3, [this, &parentFolder, &parentFolderFs]
+    sqlite::Tools::withRetries( m_ml->getConn(), 3, [this, &parentFolder, &parentFolderFs]
                             ( FilesT files, FilesToAddT filesToAdd, FilesToRemoveT filesToRemove ) {
         auto t = m_ml->getConn()->newTransaction();
         for ( auto file : files )
@@ -314,8 +343,7 @@ void FsDiscoverer::checkFiles( fs::IDirectory& parentFolderFs, Folder& parentFol
             }
         }
         // Insert all files at once to avoid SQL write contention
-        for ( auto& p : filesToAdd )
-            m_ml->addFile( *p, parentFolder, parentFolderFs );
+        m_ml->addFiles( filesToAdd, parentFolder, parentFolderFs );
         t->commit();
         LOG_INFO( "Done checking files in ", parentFolderFs.mrl() );
     }, std::move( files ), std::move( filesToAdd ), std::move( filesToRemove ) );
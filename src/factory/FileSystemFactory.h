@@ -22,10 +22,9 @@
 
 #pragma once
 
-#include "compat/Mutex.h"
 #include "factory/IFileSystem.h"
 #include "medialibrary/Types.h"
-#include "utils/Cache.h"
+#include "compat/Mutex.h"
 
 #include <string>
 #include <unordered_map>
@@ -51,7 +50,8 @@ namespace factory
 
     private:
         DeviceListerPtr m_deviceLister;
-        Cache<DeviceCacheMap> m_deviceCache;
+        compat::Mutex m_deviceCacheLock;
+        DeviceCacheMap m_deviceCache;
 
     };
 }
@@ -57,9 +57,8 @@ const std::vector<std::shared_ptr<IDirectory>>& CommonDirectory::dirs() const
 
 std::shared_ptr<IDevice> CommonDirectory::device() const
 {
-    auto lock = m_device.lock();
     if ( m_device.isCached() == false )
-        m_device = m_fsFactory.createDeviceFromMrl( mrl() );
+        return m_device.initialize( m_fsFactory.createDeviceFromMrl( mrl() ) );
     return m_device.get();
 }
 
@@ -34,6 +34,7 @@
 #include "Show.h"
 #include "utils/Filename.h"
 #include "utils/ModificationsNotifier.h"
+#include <algorithm>
 #include <cstdlib>
 
 namespace medialibrary
@@ -96,7 +97,7 @@ parser::Task::Status MetadataParser::run( parser::Task& task )
     bool isAudio = true;
     {
         using TracksT = decltype( tracks );
-        sqlite::Tools::withRetries( 3, [this, &isAudio, &task]( TracksT tracks ) {
+        sqlite::Tools::withRetries( m_ml->getConn(), 3, [this, &isAudio, &task]( TracksT tracks ) {
             auto t = m_ml->getConn()->newTransaction();
             for ( const auto& t : tracks )
             {
@@ -157,7 +158,7 @@ bool MetadataParser::parseVideoFile( parser::Task& task ) const
     const auto& showName = task.vlcMedia.meta( libvlc_meta_ShowName );
     if ( showName.length() == 0 )
     {
-        return sqlite::Tools::withRetries( 3, [this, &showName, &title, &task]() {
+        return sqlite::Tools::withRetries( m_ml->getConn(), 3, [this, &showName, &title, &task]() {
             auto t = m_ml->getConn()->newTransaction();
 
             auto show = m_ml->show( showName );
@@ -200,7 +201,7 @@ bool MetadataParser::parseAudioFile( parser::Task& task )
     if ( artists.first == nullptr && artists.second == nullptr )
         return false;
     auto album = findAlbum( task, artists.first, artists.second );
-    return sqlite::Tools::withRetries( 3, [this, &task, &artists]( std::string artworkMrl,
+    return sqlite::Tools::withRetries( m_ml->getConn(), 3, [this, &task, &artists]( std::string artworkMrl,
                                                   std::shared_ptr<Album> album, std::shared_ptr<Genre> genre ) {
         auto t = m_ml->getConn()->newTransaction();
         if ( album == nullptr )
@@ -261,8 +262,9 @@ std::shared_ptr<Album> MetadataParser::findAlbum( parser::Task& task, std::share
 
     // Album matching depends on the difference between artist & album artist.
     // Specificaly pass the albumArtist here.
-    static const std::string req = "SELECT * FROM " + policy::AlbumTable::Name +
-            " WHERE title = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::AlbumTable::Name +
+            " WHERE title = ?" );
     auto albums = Album::fetchAll<Album>( m_ml, req, albumName );
 
     if ( albums.size() == 0 )
@@ -311,17 +313,12 @@ std::shared_ptr<Album> MetadataParser::findAlbum( parser::Task& task, std::share
             continue;
         }
 
-        auto multiDisc = false;
-        for ( auto& t : tracks )
-        {
-            auto at = t->albumTrack();
-            assert( at != nullptr );
-            if ( at != nullptr && at->discNumber() > 1 )
-            {
-                multiDisc = true;
-                break;
-            }
-        }
+        // Only fetch the album tracks which aren't cached yet, and all at once
+        auto albumTracks = Media::albumTracks( m_ml, tracks );
+        auto multiDisc = std::any_of( begin( albumTracks ), end( albumTracks ),
+                                      []( const AlbumTrackPtr& at ) {
+            return at != nullptr && at->discNumber() > 1;
+        });
         if ( multiDisc )
         {
             ++it;
@@ -370,7 +367,8 @@ std::pair<std::shared_ptr<Artist>, std::shared_ptr<Artist>> MetadataParser::find
 {
     std::shared_ptr<Artist> albumArtist;
     std::shared_ptr<Artist> artist;
-    static const std::string req = "SELECT * FROM " + policy::ArtistTable::Name + " WHERE name = ?";
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT * FROM " + policy::ArtistTable::Name + " WHERE name = ?" );
 
     const auto& albumArtistStr = task.vlcMedia.meta( libvlc_meta_AlbumArtist );
     const auto& artistStr = task.vlcMedia.meta( libvlc_meta_Artist );
@@ -31,6 +31,7 @@
 #include "medialibrary/IMediaLibrary.h"
 #include "Media.h"
 #include "File.h"
+#include "Folder.h"
 #include "ParserService.h"
 
 namespace medialibrary
@@ -101,11 +102,22 @@ void Parser::restore()
 
     auto files = File::fetchUnparsed( m_ml );
     LOG_INFO( "Resuming parsing on ", files.size(), " mrl" );
+    // Resolve the media and folders of all the files at once, instead of
+    // fetching them one file at a time
+    std::vector<int64_t> mediaIds;
+    std::vector<int64_t> folderIds;
+    mediaIds.reserve( files.size() );
     for ( auto& f : files )
     {
-        auto m = f->media();
-        parse( m, f );
+        mediaIds.push_back( f->mediaId() );
+        if ( f->folderId() != 0 )
+            folderIds.push_back( f->folderId() );
     }
+    auto media = Media::fetchByIds( m_ml, mediaIds );
+    // This only warms the folder cache, which File::mrl() uses for removable files
+    auto folders = Folder::fetchByIds( m_ml, folderIds );
+    for ( auto i = 0u; i < files.size(); ++i )
+        parse( media[i], files[i] );
 }
 
 void Parser::updateStats()
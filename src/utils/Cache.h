@@ -22,70 +22,226 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 
 #include "compat/Mutex.h"
 
 namespace medialibrary
 {
 
+namespace details
+{
+
+constexpr size_t NbCacheStripes = 64;
+
+inline size_t cacheStripe( const void* cell )
+{
+    return ( reinterpret_cast<uintptr_t>( cell ) >> 4 ) % NbCacheStripes;
+}
+
+/*
+ * Locks shared by all the Cache instances. A Cache is embedded in every cached
+ * entity, potentially a few times, so it can't afford to own a mutex.
+ */
+inline compat::Mutex& cacheLock( const void* cell )
+{
+    static compat::Mutex locks[NbCacheStripes];
+    return locks[cacheStripe( cell )];
+}
+
+/*
+ * Modification counters of the cells which aren't cached yet, shared the same
+ * way as the locks. A modification of any cell of a stripe is reported to all
+ * the cells of that stripe, which only costs a spurious reload.
+ */
+inline std::atomic<uint32_t>& cacheVersion( const void* cell )
+{
+    static std::atomic<uint32_t> versions[NbCacheStripes];
+    return versions[cacheStripe( cell )];
+}
+
+}
+
+/*
+ * Lazily initialized value.
+ * Once a value is published, reading it only takes an atomic load. The value is
+ * heap allocated, so an empty cell is only a pointer wide.
+ * A published value is never freed before the cell itself: replacing it (through
+ * operator=) keeps the previous one around, as a concurrent reader might still be
+ * using it. Replacements are expected to be rare.
+ * Modifying the published value in place requires holding lock(), which must not
+ * be held while loading the value, as loading it is likely to load other cells.
+ * Since values are loaded without the lock, a modification of the underlying
+ * data performed while the cell isn't cached must be reported with
+ * markModified(). Values are then only published if no modification was
+ * reported since their load started, see load().
+ */
 template <typename T>
 class Cache
 {
+    struct Node
+    {
+        template <typename U>
+        Node( U&& v, Node* p ) : value( std::forward<U>( v ) ), prev( p ) {}
+        T value;
+        Node* prev;
+    };
+
 public:
-    Cache() : m_cached( false ) {}
+    Cache() : m_head( nullptr ) {}
     Cache( const T& value )
-        : m_value( value )
-        , m_cached( true )
+        : m_head( new Node( value, nullptr ) )
     {
     }
 
-    bool isCached() const { return m_cached; }
+    ~Cache()
+    {
+        auto n = m_head.load( std::memory_order_relaxed );
+        while ( n != nullptr )
+        {
+            auto prev = n->prev;
+            delete n;
+            n = prev;
+        }
+    }
+
+    Cache( const Cache& ) = delete;
+    Cache& operator=( const Cache& ) = delete;
+
+    bool isCached() const { return m_head.load( std::memory_order_acquire ) != nullptr; }
+
+    /*
+     * Publishes an empty value. Must be called with lock() held.
+     */
+    void markCached() { publish( T{} ); }
+
+    /*
+     * Reports a modification of the underlying data while the cell isn't
+     * cached, so that a concurrently loaded value doesn't get published
+     * without it. Must be called with lock() held, after the data was modified.
+     */
+    void markModified() { details::cacheVersion( this ).fetch_add( 1, std::memory_order_relaxed ); }
 
-    void markCached() { m_cached = true; }
+    /*
+     * Returns the current modification counter, to be passed to initialize()
+     * once the value is loaded. It must be fetched before starting the load.
+     */
+    uint32_t version() const { return details::cacheVersion( this ).load( std::memory_order_acquire ); }
 
     operator T() const
     {
-        assert( m_cached );
-        return m_value;
+        return get();
     }
 
     operator const T&() const
     {
-        assert( m_cached );
-        return m_value;
+        return get();
     }
 
     const T& get() const
     {
-        assert( m_cached );
-        return m_value;
+        auto n = m_head.load( std::memory_order_acquire );
+        assert( n != nullptr );
+        return n->value;
     }
 
     T& get()
     {
-        assert( m_cached );
-        return m_value;
+        auto n = m_head.load( std::memory_order_acquire );
+        assert( n != nullptr );
+        return n->value;
+    }
+
+    /*
+     * Publishes the value, unless another one was already published, in which
+     * case the provided value is discarded.
+     * Returns the published value.
+     * This is only meant for cells whose data is never modified in place.
+     */
+    template <typename U>
+    T& initialize( U&& value )
+    {
+        auto l = lock();
+        return publish( std::forward<U>( value ) );
+    }
+
+    /*
+     * Publishes the value if no modification was reported since version was
+     * fetched, unless another value was already published.
+     * Returns the published value, or nullptr if the provided one might miss
+     * a modification, in which case it's discarded.
+     */
+    template <typename U>
+    T* initialize( U&& value, uint32_t version )
+    {
+        auto l = lock();
+        if ( isCached() == false && version != this->version() )
+            return nullptr;
+        return &publish( std::forward<U>( value ) );
+    }
+
+    /*
+     * Publishes the value returned by loader, which is invoked without any
+     * lock held, and invoked again if the underlying data was modified while
+     * it was running.
+     * Returns the published value.
+     */
+    template <typename F>
+    T& load( F&& loader )
+    {
+        while ( true )
+        {
+            auto v = version();
+            auto res = initialize( loader(), v );
+            if ( res != nullptr )
+                return *res;
+        }
     }
 
     template <typename U>
     T& operator=( U&& value )
     {
-        static_assert( std::is_convertible<typename std::decay<U>::type, typename std::decay<T>::type>::value, "Mismatching types" );
-        m_value = std::forward<U>( value );
-        m_cached = true;
-        return m_value;
+        checkType<U>();
+        auto n = new Node( std::forward<U>( value ), m_head.load( std::memory_order_relaxed ) );
+        while ( m_head.compare_exchange_weak( n->prev, n, std::memory_order_release,
+                                              std::memory_order_relaxed ) == false )
+            ;
+        return n->value;
+    }
+
+    std::unique_lock<compat::Mutex> lock() const
+    {
+        return std::unique_lock<compat::Mutex>( details::cacheLock( this ) );
     }
 
-    std::unique_lock<compat::Mutex> lock()
+private:
+    // Must be called with lock() held. Replacements through operator= don't
+    // take the lock, hence the compare-and-swap.
+    template <typename U>
+    T& publish( U&& value )
     {
-        return std::unique_lock<compat::Mutex>( m_lock );
+        checkType<U>();
+        auto n = new Node( std::forward<U>( value ), nullptr );
+        Node* expected = nullptr;
+        if ( m_head.compare_exchange_strong( expected, n, std::memory_order_acq_rel,
+                                             std::memory_order_acquire ) == true )
+            return n->value;
+        delete n;
+        return expected->value;
+    }
+
+    template <typename U>
+    static void checkType()
+    {
+        static_assert( std::is_convertible<typename std::decay<U>::type, typename std::decay<T>::type>::value, "Mismatching types" );
     }
 
 private:
-    T m_value;
-    compat::Mutex m_lock;
-    bool m_cached;
+    std::atomic<Node*> m_head;
 };
 
 }
@@ -65,9 +65,9 @@ void ModificationNotifier::notifyMediaModification( MediaPtr media )
     notifyModification( std::move( media ), m_media );
 }
 
-void ModificationNotifier::notifyMediaRemoval( int64_t mediaId )
+void ModificationNotifier::notifyMediaRemoval( const std::vector<int64_t>& rowIds )
 {
-    notifyRemoval( mediaId, m_media );
+    notifyRemoval( rowIds, m_media );
 }
 
 void ModificationNotifier::notifyArtistCreation( ArtistPtr artist )
@@ -80,9 +80,9 @@ void ModificationNotifier::notifyArtistModification( ArtistPtr artist )
     notifyModification( std::move( artist ), m_artists );
 }
 
-void ModificationNotifier::notifyArtistRemoval( int64_t artist )
+void ModificationNotifier::notifyArtistRemoval( const std::vector<int64_t>& rowIds )
 {
-    notifyRemoval( std::move( artist ), m_artists );
+    notifyRemoval( rowIds, m_artists );
 }
 
 void ModificationNotifier::notifyAlbumCreation( AlbumPtr album )
@@ -95,9 +95,9 @@ void ModificationNotifier::notifyAlbumModification( AlbumPtr album )
     notifyModification( std::move( album ), m_albums );
 }
 
-void ModificationNotifier::notifyAlbumRemoval( int64_t albumId )
+void ModificationNotifier::notifyAlbumRemoval( const std::vector<int64_t>& rowIds )
 {
-    notifyRemoval( albumId, m_albums );
+    notifyRemoval( rowIds, m_albums );
 }
 
 void ModificationNotifier::notifyAlbumTrackCreation( AlbumTrackPtr track )
@@ -110,9 +110,9 @@ void ModificationNotifier::notifyAlbumTrackModification( AlbumTrackPtr track )
     notifyModification( std::move( track ), m_tracks );
 }
 
-void ModificationNotifier::notifyAlbumTrackRemoval( int64_t trackId )
+void ModificationNotifier::notifyAlbumTrackRemoval( const std::vector<int64_t>& rowIds )
 {
-    notifyRemoval( trackId, m_tracks );
+    notifyRemoval( rowIds, m_tracks );
 }
 
 void ModificationNotifier::notifyPlaylistCreation( PlaylistPtr playlist )
@@ -125,9 +125,9 @@ void ModificationNotifier::notifyPlaylistModification( PlaylistPtr playlist )
     notifyModification( std::move( playlist ), m_playlists );
 }
 
-void ModificationNotifier::notifyPlaylistRemoval( int64_t playlistId )
+void ModificationNotifier::notifyPlaylistRemoval( const std::vector<int64_t>& rowIds )
 {
-    notifyRemoval( playlistId, m_playlists );
+    notifyRemoval( rowIds, m_playlists );
 }
 
 void ModificationNotifier::run()
@@ -45,23 +45,23 @@ public:
     void start();
     void notifyMediaCreation( MediaPtr media );
     void notifyMediaModification( MediaPtr media );
-    void notifyMediaRemoval( int64_t media );
+    void notifyMediaRemoval( const std::vector<int64_t>& rowIds );
 
     void notifyArtistCreation( ArtistPtr artist );
     void notifyArtistModification( ArtistPtr artist );
-    void notifyArtistRemoval( int64_t artist );
+    void notifyArtistRemoval( const std::vector<int64_t>& rowIds );
 
     void notifyAlbumCreation( AlbumPtr album );
     void notifyAlbumModification( AlbumPtr album );
-    void notifyAlbumRemoval( int64_t albumId );
+    void notifyAlbumRemoval( const std::vector<int64_t>& rowIds );
 
     void notifyAlbumTrackCreation( AlbumTrackPtr track );
     void notifyAlbumTrackModification( AlbumTrackPtr track );
-    void notifyAlbumTrackRemoval( int64_t trackId );
+    void notifyAlbumTrackRemoval( const std::vector<int64_t>& rowIds );
 
     void notifyPlaylistCreation( PlaylistPtr track );
     void notifyPlaylistModification( PlaylistPtr track );
-    void notifyPlaylistRemoval( int64_t trackId );
+    void notifyPlaylistRemoval( const std::vector<int64_t>& rowIds );
 
 private:
     void run();
@@ -105,11 +105,11 @@ private:
     }
 
     template <typename T>
-    void notifyRemoval( int64_t rowId, Queue<T>& queue )
+    void notifyRemoval( const std::vector<int64_t>& rowIds, Queue<T>& queue )
     {
         std::lock_guard<compat::Mutex> lock( m_lock );
-        queue.removed.push_back( rowId );
-        updateTimeout( m_media );
+        queue.removed.insert( end( queue.removed ), begin( rowIds ), end( rowIds ) );
+        updateTimeout( queue );
     }
 
     template <typename T>
@@ -0,0 +1,79 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "PeriodicTask.h"
+
+namespace medialibrary
+{
+
+PeriodicTask::PeriodicTask( std::function<void()> task )
+    : m_task( std::move( task ) )
+    , m_interval( 0 )
+    , m_stop( true )
+{
+}
+
+PeriodicTask::~PeriodicTask()
+{
+    stop();
+}
+
+void PeriodicTask::start( std::chrono::milliseconds interval )
+{
+    stop();
+    if ( interval == std::chrono::milliseconds::zero() )
+        return;
+    std::lock_guard<compat::Mutex> lock( m_lock );
+    m_interval = interval;
+    m_stop = false;
+    m_thread = compat::Thread( &PeriodicTask::run, this );
+}
+
+void PeriodicTask::stop()
+{
+    {
+        std::lock_guard<compat::Mutex> lock( m_lock );
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if ( m_thread.joinable() == true )
+        m_thread.join();
+}
+
+void PeriodicTask::run()
+{
+    std::unique_lock<compat::Mutex> lock( m_lock );
+    while ( true )
+    {
+        if ( m_cond.wait_for( lock, m_interval, [this]() { return m_stop; } ) == true )
+            break;
+        lock.unlock();
+        m_task();
+        lock.lock();
+    }
+}
+
+}
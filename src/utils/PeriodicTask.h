@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include "compat/ConditionVariable.h"
+#include "compat/Mutex.h"
+#include "compat/Thread.h"
+
+namespace medialibrary
+{
+
+///
+/// \brief The PeriodicTask class runs a task on its own thread, every time
+/// the configured interval elapses.
+///
+class PeriodicTask
+{
+public:
+    explicit PeriodicTask( std::function<void()> task );
+    ~PeriodicTask();
+    PeriodicTask( const PeriodicTask& ) = delete;
+    PeriodicTask& operator=( const PeriodicTask& ) = delete;
+
+    ///
+    /// \brief start (Re)starts running the task every interval
+    /// A zero interval stops the task.
+    ///
+    void start( std::chrono::milliseconds interval );
+    ///
+    /// \brief stop Stops running the task, and waits for it to complete if
+    /// it is running.
+    ///
+    void stop();
+
+private:
+    void run();
+
+private:
+    std::function<void()> m_task;
+    compat::Mutex m_lock;
+    compat::ConditionVariable m_cond;
+    compat::Thread m_thread;
+    std::chrono::milliseconds m_interval;
+    bool m_stop;
+};
+
+}
@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "ReadExecutor.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "logging/Logger.h"
+
+namespace medialibrary
+{
+
+ReadExecutor::ReadExecutor( unsigned int nbWorkers )
+    : m_nbWorkers( nbWorkers )
+    , m_stop( false )
+{
+}
+
+ReadExecutor::~ReadExecutor()
+{
+    stop();
+}
+
+void ReadExecutor::run( std::function<void()> task, const std::string& key )
+{
+    // Destroy the dropped tasks out of the lock, since that notifies their
+    // caller through the promise they hold.
+    std::deque<Task> dropped;
+    {
+        std::lock_guard<compat::Mutex> lock( m_lock );
+        if ( m_stop == true )
+            return;
+        if ( key.empty() == false )
+            dropPending( key, dropped );
+        m_tasks.push_back( Task{ key, std::move( task ) } );
+        if ( m_workers.size() < m_nbWorkers )
+            m_workers.emplace_back( &ReadExecutor::work, this );
+    }
+    m_cond.notify_one();
+}
+
+void ReadExecutor::cancel( const std::string& key )
+{
+    std::deque<Task> dropped;
+    {
+        std::lock_guard<compat::Mutex> lock( m_lock );
+        dropPending( key, dropped );
+    }
+}
+
+void ReadExecutor::stop()
+{
+    std::deque<Task> dropped;
+    {
+        std::lock_guard<compat::Mutex> lock( m_lock );
+        m_stop = true;
+        std::swap( dropped, m_tasks );
+    }
+    m_cond.notify_all();
+    for ( auto& t : m_workers )
+        t.join();
+    m_workers.clear();
+}
+
+void ReadExecutor::dropPending( const std::string& key, std::deque<Task>& dropped )
+{
+    auto it = std::stable_partition( begin( m_tasks ), end( m_tasks ), [&key]( const Task& t ) {
+        return t.key != key;
+    });
+    std::move( it, end( m_tasks ), std::back_inserter( dropped ) );
+    m_tasks.erase( it, end( m_tasks ) );
+}
+
+void ReadExecutor::work()
+{
+    while ( true )
+    {
+        Task task;
+        {
+            std::unique_lock<compat::Mutex> lock( m_lock );
+            m_cond.wait( lock, [this]() {
+                return m_stop == true || m_tasks.empty() == false;
+            });
+            if ( m_stop == true )
+                return;
+            task = std::move( m_tasks.front() );
+            m_tasks.pop_front();
+        }
+        // The tasks are expected to report their own failures
+        try
+        {
+            task.f();
+        }
+        catch ( const std::exception& ex )
+        {
+            LOG_ERROR( "Uncaught exception in asynchronous request: ", ex.what() );
+        }
+    }
+}
+
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "compat/ConditionVariable.h"
+#include "compat/Mutex.h"
+#include "compat/Thread.h"
+
+namespace medialibrary
+{
+
+///
+/// \brief The ReadExecutor class runs read only requests on a small pool of
+/// worker threads, so that callers don't block on the database.
+///
+/// Each task can be associated with a key. Queuing a task drops any pending
+/// task with the same key, so that a caller issuing requests faster than they
+/// can be processed, like a search as you type, only gets its latest request
+/// executed. Dropped tasks are destroyed without being run, which is expected
+/// to break the promise they hold.
+/// Workers are only started when the first task gets queued.
+///
+class ReadExecutor
+{
+public:
+    explicit ReadExecutor( unsigned int nbWorkers );
+    ~ReadExecutor();
+    ReadExecutor( const ReadExecutor& ) = delete;
+    ReadExecutor& operator=( const ReadExecutor& ) = delete;
+
+    void run( std::function<void()> task, const std::string& key );
+    ///
+    /// \brief cancel Drops the pending task associated with the provided key
+    /// A task which is already running is left to complete.
+    ///
+    void cancel( const std::string& key );
+    ///
+    /// \brief stop Drops all pending tasks and waits for the running ones to
+    /// complete. No task can be queued afterward.
+    ///
+    void stop();
+
+private:
+    struct Task
+    {
+        std::string key;
+        std::function<void()> f;
+    };
+
+    void work();
+    // Moves the pending tasks associated with key to dropped.
+    // Must be called with m_lock held
+    void dropPending( const std::string& key, std::deque<Task>& dropped );
+
+private:
+    const unsigned int m_nbWorkers;
+    compat::Mutex m_lock;
+    compat::ConditionVariable m_cond;
+    std::deque<Task> m_tasks;
+    std::vector<compat::Thread> m_workers;
+    bool m_stop;
+};
+
+}
@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+
 #include "compat/ConditionVariable.h"
 #include "compat/Mutex.h"
 
@@ -34,62 +37,88 @@ namespace utils
 ///
 /// \brief Single Write Multiple Reader lock
 ///
+/// The number of active readers and a writer flag are packed in a single
+/// atomic word. As long as no writer is pending, readers only increment and
+/// decrement that counter, without touching any mutex.
+/// A writer first sets the writer flag, which diverts new readers to a slow
+/// path where they wait for the write to complete, and then waits for the
+/// active readers to drain. This gives writers the preference, so that a
+/// steady stream of readers can't starve them.
+///
 class SWMRLock
 {
 public:
     SWMRLock()
-        : m_nbReader( 0 )
+        : m_state( 0 )
         , m_nbReaderWaiting( 0 )
-        , m_writing( false )
-        , m_nbWriterWaiting( 0 )
     {
     }
 
     void lock_read()
     {
-        std::unique_lock<compat::Mutex> lock( m_lock );
-        ++m_nbReaderWaiting;
-        m_writeDoneCond.wait( lock, [this](){
-            return m_writing == false;
-        });
-        --m_nbReaderWaiting;
-        m_nbReader++;
+        while ( true )
+        {
+            if ( ( m_state.fetch_add( 1, std::memory_order_acquire ) & WriterFlag ) == 0 )
+                return;
+            // A writer is pending or active: back off and wait for it to be done
+            unlock_read();
+            std::unique_lock<compat::Mutex> lock( m_lock );
+            ++m_nbReaderWaiting;
+            m_writeDoneCond.wait( lock, [this](){
+                return ( m_state.load( std::memory_order_relaxed ) & WriterFlag ) == 0;
+            });
+            --m_nbReaderWaiting;
+        }
     }
 
     void unlock_read()
     {
-        std::unique_lock<compat::Mutex> lock( m_lock );
-        --m_nbReader;
-        if ( m_nbReader == 0 && m_nbWriterWaiting > 0 )
-            m_writeDoneCond.notify_one();
+        auto prev = m_state.fetch_sub( 1, std::memory_order_release );
+        // Wake the pending writer up if we were the last reader it waits for.
+        // The lock ensures the writer either hasn't checked the readers count
+        // yet, or is already waiting for this notification.
+        if ( prev == ( WriterFlag | 1 ) )
+        {
+            std::lock_guard<compat::Mutex> lock( m_lock );
+            m_readersDoneCond.notify_one();
+        }
     }
 
     void lock_write()
     {
+        // Writers are serialized among themselves first
+        m_writerLock.lock();
+        m_state.fetch_or( WriterFlag, std::memory_order_acquire );
         std::unique_lock<compat::Mutex> lock( m_lock );
-        ++m_nbWriterWaiting;
-        m_writeDoneCond.wait( lock, [this](){
-            return m_writing == false && m_nbReader == 0;
+        m_readersDoneCond.wait( lock, [this](){
+            return ( m_state.load( std::memory_order_acquire ) & ReadersMask ) == 0;
         });
-        --m_nbWriterWaiting;
-        m_writing = true;
     }
 
     void unlock_write()
     {
-        std::unique_lock<compat::Mutex> lock( m_lock );
-        m_writing = false;
-        if ( m_nbReaderWaiting > 0 || m_nbWriterWaiting > 0 )
+        bool readersWaiting;
+        {
+            std::lock_guard<compat::Mutex> lock( m_lock );
+            m_state.fetch_and( ~WriterFlag, std::memory_order_release );
+            readersWaiting = m_nbReaderWaiting > 0;
+        }
+        if ( readersWaiting == true )
             m_writeDoneCond.notify_all();
+        m_writerLock.unlock();
     }
 
 private:
-    compat::ConditionVariable m_writeDoneCond;
+    static constexpr uint32_t WriterFlag = 1u << 31;
+    static constexpr uint32_t ReadersMask = WriterFlag - 1;
+
+    std::atomic<uint32_t> m_state;
+    compat::Mutex m_writerLock;
+    // Protects the slow paths, so that no wake up gets lost
     compat::Mutex m_lock;
-    unsigned int m_nbReader;
+    compat::ConditionVariable m_writeDoneCond;
+    compat::ConditionVariable m_readersDoneCond;
     unsigned int m_nbReaderWaiting;
-    bool m_writing;
-    unsigned int m_nbWriterWaiting;
 };
 
 class WriteLocker
@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "database/DatabaseHelpers.h"
+
+using namespace medialibrary;
+
+namespace
+{
+
+struct Entity
+{
+    explicit Entity( int64_t id ) : id( id ) {}
+    int64_t id;
+};
+
+// A single mutex for the whole cache, as the entity caches used to be
+using GlobalCache = cachepolicy::details::Sharded<Entity,
+        cachepolicy::details::MapStore<Entity>, 1>;
+using ShardedCache = cachepolicy::details::Sharded<Entity,
+        cachepolicy::details::MapStore<Entity>, cachepolicy::details::DefaultNbShards>;
+using LruCache = cachepolicy::Lru<Entity, 1 << 20>;
+
+constexpr auto NbEntities = 100000;
+constexpr auto NbLoadsPerThread = 500000u;
+
+template <typename Cache>
+double run( Cache& cache, unsigned int nbThreads )
+{
+    // Only there to prevent the loads from being optimized out
+    std::atomic<int64_t> sum{ 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for ( auto i = 0u; i < nbThreads; ++i )
+    {
+        threads.emplace_back( [&cache, &sum, i]() {
+            int64_t local = 0;
+            // Each thread loads its own pseudo random sequence of ids
+            uint32_t seed = 2463534242u + i;
+            for ( auto j = 0u; j < NbLoadsPerThread; ++j )
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                int64_t id = seed % NbEntities;
+                auto e = cache.load( id, [id]() {
+                    return std::make_shared<Entity>( id );
+                });
+                local += e->id;
+            }
+            sum.fetch_add( local, std::memory_order_relaxed );
+        });
+    }
+    for ( auto& t : threads )
+        t.join();
+    auto duration = std::chrono::duration<double>( std::chrono::steady_clock::now() - start );
+    return nbThreads * NbLoadsPerThread / duration.count();
+}
+
+template <typename Cache>
+void report( const char* name, unsigned int nbThreads )
+{
+    Cache cache;
+    // Warm the cache first, so that mostly lookups are measured
+    run( cache, 16 );
+    auto loadsPerSecond = run( cache, nbThreads );
+    std::cout << name << "\t" << nbThreads << " threads\t"
+              << static_cast<uint64_t>( loadsPerSecond ) << " loads/s" << std::endl;
+}
+
+}
+
+int main()
+{
+    for ( auto nbThreads : { 1u, 2u, 4u, 8u, 16u } )
+    {
+        report<GlobalCache>( "global", nbThreads );
+        report<ShardedCache>( "sharded", nbThreads );
+        report<LruCache>( "lru", nbThreads );
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "Album.h"
+#include "AlbumTrack.h"
+#include "Artist.h"
+#include "Genre.h"
+#include "Media.h"
+#include "Playlist.h"
+#include "database/SqliteConnection.h"
+#include "database/SqliteQueryProfiler.h"
+#include "database/SqliteTools.h"
+#include "database/SqliteTransaction.h"
+#include "logging/Logger.h"
+
+using namespace medialibrary;
+
+namespace
+{
+
+constexpr auto DbPath = "index_benchmark.db";
+constexpr auto NbMedia = 100000u;
+constexpr auto NbAlbums = 10000u;
+constexpr auto NbArtists = 2000u;
+constexpr auto NbGenres = 200u;
+constexpr auto NbPlaylistItems = 1000u;
+constexpr auto NbRuns = 20u;
+
+struct Query
+{
+    const char* name;
+    std::string req;
+    sqlite::Value param;
+};
+
+// The same access paths as the entities use, with representative parameters.
+// This is built at runtime since the table names are static members of the library.
+std::vector<Query> queries()
+{
+    return {
+        { "Album by title",
+          "SELECT * FROM " + policy::AlbumTable::Name + " WHERE title = ?",
+          sqlite::Value{ std::string{ "album 4242" } } },
+        { "Album tracks",
+          "SELECT med.* FROM " + policy::MediaTable::Name + " med INNER JOIN " +
+            policy::AlbumTrackTable::Name + " att ON att.media_id = med.id_media "
+            "WHERE att.album_id = ? AND med.is_present = 1 "
+            "ORDER BY att.disc_number, att.track_number, med.filename, med.id_media",
+          sqlite::Value{ int64_t{ 4242 } } },
+        { "Genre tracks",
+          "SELECT m.* FROM " + policy::MediaTable::Name + " m INNER JOIN " +
+            policy::AlbumTrackTable::Name + " t ON m.id_media = t.media_id "
+            "WHERE t.genre_id = ? ORDER BY m.title, m.id_media",
+          sqlite::Value{ int64_t{ 42 } } },
+        { "Audio by title",
+          "SELECT * FROM " + policy::MediaTable::Name + " WHERE type = ? AND is_present = 1 "
+            "ORDER BY title, id_media LIMIT 100",
+          sqlite::Value{ static_cast<int64_t>( IMedia::Type::Audio ) } },
+        { "Audio by duration",
+          "SELECT * FROM " + policy::MediaTable::Name + " WHERE type = ? AND is_present = 1 "
+            "ORDER BY duration DESC, id_media DESC LIMIT 100",
+          sqlite::Value{ static_cast<int64_t>( IMedia::Type::Audio ) } },
+        { "Video by insertion",
+          "SELECT * FROM " + policy::MediaTable::Name + " WHERE type = ? AND is_present = 1 "
+            "ORDER BY insertion_date, id_media LIMIT 100",
+          sqlite::Value{ static_cast<int64_t>( IMedia::Type::Video ) } },
+        { "Artist media",
+          "SELECT med.* FROM " + policy::MediaTable::Name + " med INNER JOIN MediaArtistRelation mar "
+            "ON mar.media_id = med.id_media WHERE mar.artist_id = ? AND med.is_present = 1 "
+            "ORDER BY med.title, med.id_media",
+          sqlite::Value{ int64_t{ 42 } } },
+        { "Playlist media",
+          "SELECT m.* FROM " + policy::MediaTable::Name + " m LEFT JOIN PlaylistMediaRelation pmr "
+            "ON pmr.media_id = m.id_media WHERE pmr.playlist_id = ? AND m.is_present = 1 "
+            "ORDER BY pmr.position, m.id_media",
+          sqlite::Value{ int64_t{ 1 } } },
+    };
+}
+
+void insert( DBConnection dbConn, const std::string& req, unsigned int nbRows,
+             std::function<void(sqlite::Statement&, unsigned int)> bind )
+{
+    sqlite::Statement stmt( dbConn, req );
+    for ( auto i = 1u; i <= nbRows; ++i )
+    {
+        stmt.reset();
+        bind( stmt, i );
+        while ( stmt.row() != nullptr )
+            ;
+    }
+}
+
+void populate( DBConnection dbConn )
+{
+    auto t = dbConn->newTransaction();
+    Media::createTable( dbConn );
+    Playlist::createTable( dbConn );
+    Genre::createTable( dbConn );
+    Album::createTable( dbConn );
+    AlbumTrack::createTable( dbConn );
+    Artist::createTable( dbConn );
+
+    insert( dbConn, "INSERT INTO " + policy::ArtistTable::Name + "(id_artist, name) VALUES(?, ?)",
+            NbArtists, []( sqlite::Statement& s, unsigned int i ) {
+        s.execute( i, "artist " + std::to_string( i ) );
+    });
+    insert( dbConn, "INSERT INTO " + policy::GenreTable::Name + "(id_genre, name) VALUES(?, ?)",
+            NbGenres, []( sqlite::Statement& s, unsigned int i ) {
+        s.execute( i, "genre " + std::to_string( i ) );
+    });
+    insert( dbConn, "INSERT INTO " + policy::AlbumTable::Name + "(id_album, title, artist_id) VALUES(?, ?, ?)",
+            NbAlbums, []( sqlite::Statement& s, unsigned int i ) {
+        s.execute( i, "album " + std::to_string( i ), 1 + i % NbArtists );
+    });
+    insert( dbConn, "INSERT INTO " + policy::MediaTable::Name + "(id_media, type, duration, "
+            "insertion_date, release_date, title, filename) VALUES(?, ?, ?, ?, ?, ?, ?)",
+            NbMedia, []( sqlite::Statement& s, unsigned int i ) {
+        auto type = i % 4 == 0 ? IMedia::Type::Video : IMedia::Type::Audio;
+        // Spread the sorting columns so they don't follow the insertion order
+        auto scrambled = ( i * 7919u ) % NbMedia;
+        s.execute( i, type, scrambled * 10, 1500000000 + i, scrambled,
+                   "media " + std::to_string( scrambled ), "file" + std::to_string( i ) + ".mp3" );
+    });
+    insert( dbConn, "INSERT INTO " + policy::AlbumTrackTable::Name + "(media_id, duration, "
+            "artist_id, genre_id, track_number, album_id, disc_number) VALUES(?, ?, ?, ?, ?, ?, ?)",
+            NbMedia, []( sqlite::Statement& s, unsigned int i ) {
+        s.execute( i, 1000, 1 + i % NbArtists, 1 + i % NbGenres, i % 10, 1 + i % NbAlbums, 1 );
+    });
+    insert( dbConn, "INSERT INTO MediaArtistRelation(media_id, artist_id) VALUES(?, ?)",
+            NbMedia, []( sqlite::Statement& s, unsigned int i ) {
+        s.execute( i, 1 + i % NbArtists );
+    });
+    insert( dbConn, "INSERT INTO " + policy::PlaylistTable::Name + "(name, creation_date) VALUES(?, ?)",
+            1, []( sqlite::Statement& s, unsigned int ) {
+        s.execute( std::string{ "playlist" }, 0 );
+    });
+    insert( dbConn, "INSERT INTO PlaylistMediaRelation(media_id, playlist_id, position) VALUES(?, 1, ?)",
+            NbPlaylistItems, []( sqlite::Statement& s, unsigned int i ) {
+        s.execute( i * 97, NbPlaylistItems - i );
+    });
+    t->commit();
+}
+
+void createIndexes( DBConnection dbConn )
+{
+    auto t = dbConn->newTransaction();
+    Media::createIndexes( dbConn );
+    Album::createIndexes( dbConn );
+    AlbumTrack::createIndexes( dbConn );
+    Artist::createIndexes( dbConn );
+    Playlist::createIndexes( dbConn );
+    t->commit();
+    sqlite::Tools::executeRequest( dbConn, "ANALYZE" );
+}
+
+std::vector<double> measure( DBConnection dbConn, const std::vector<Query>& queries )
+{
+    std::vector<double> res;
+    auto ctx = dbConn->acquireReadContext();
+    for ( const auto& q : queries )
+    {
+        auto start = std::chrono::steady_clock::now();
+        for ( auto i = 0u; i < NbRuns; ++i )
+        {
+            sqlite::Statement s( dbConn, q.req );
+            s.execute( std::vector<sqlite::Value>{ q.param } );
+            while ( s.row() != nullptr )
+                ;
+        }
+        auto duration = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start );
+        res.push_back( duration.count() / NbRuns );
+    }
+    return res;
+}
+
+void printPlans( DBConnection dbConn, const std::vector<Query>& queries )
+{
+    auto ctx = dbConn->acquireReadContext();
+    for ( const auto& q : queries )
+    {
+        std::cout << "  " << q.name << ":" << std::endl;
+        for ( const auto& step : sqlite::QueryProfiler::explain( dbConn->getConn(), q.req ) )
+            std::cout << "    " << step << std::endl;
+    }
+}
+
+}
+
+int main()
+{
+    Log::setLogLevel( LogLevel::Error );
+    unlink( DbPath );
+    SqliteConnection conn( DbPath );
+    auto qs = queries();
+    std::cout << "Generating " << NbMedia << " media..." << std::endl;
+    populate( &conn );
+
+    auto before = measure( &conn, qs );
+    std::cout << "Query plans without indexes:" << std::endl;
+    printPlans( &conn, qs );
+
+    createIndexes( &conn );
+    auto after = measure( &conn, qs );
+    std::cout << "Query plans with indexes:" << std::endl;
+    printPlans( &conn, qs );
+
+    std::cout << std::endl << "query\tbefore (µs)\tafter (µs)\tspeedup" << std::endl;
+    for ( auto i = 0u; i < qs.size(); ++i )
+        std::cout << qs[i].name << "\t" << static_cast<uint64_t>( before[i] ) << "\t"
+                  << static_cast<uint64_t>( after[i] ) << "\t"
+                  << before[i] / after[i] << "x" << std::endl;
+    unlink( DbPath );
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ * Media Library
+ *****************************************************************************
+ * Copyright (C) 2015 Hugo Beauzée-Luyssen, Videolabs
+ *
+ * Authors: Hugo Beauzée-Luyssen<hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "utils/SWMRLock.h"
+
+using namespace medialibrary;
+
+namespace
+{
+
+// The mutex based lock utils::SWMRLock used to be, kept as a reference
+class MutexSWMRLock
+{
+public:
+    void lock_read()
+    {
+        std::unique_lock<compat::Mutex> lock( m_lock );
+        ++m_nbReaderWaiting;
+        m_writeDoneCond.wait( lock, [this](){
+            return m_writing == false;
+        });
+        --m_nbReaderWaiting;
+        m_nbReader++;
+    }
+
+    void unlock_read()
+    {
+        std::unique_lock<compat::Mutex> lock( m_lock );
+        --m_nbReader;
+        if ( m_nbReader == 0 && m_nbWriterWaiting > 0 )
+            m_writeDoneCond.notify_one();
+    }
+
+    void lock_write()
+    {
+        std::unique_lock<compat::Mutex> lock( m_lock );
+        ++m_nbWriterWaiting;
+        m_writeDoneCond.wait( lock, [this](){
+            return m_writing == false && m_nbReader == 0;
+        });
+        --m_nbWriterWaiting;
+        m_writing = true;
+    }
+
+    void unlock_write()
+    {
+        std::unique_lock<compat::Mutex> lock( m_lock );
+        m_writing = false;
+        if ( m_nbReaderWaiting > 0 || m_nbWriterWaiting > 0 )
+            m_writeDoneCond.notify_all();
+    }
+
+private:
+    compat::ConditionVariable m_writeDoneCond;
+    compat::Mutex m_lock;
+    unsigned int m_nbReader = 0;
+    unsigned int m_nbReaderWaiting = 0;
+    bool m_writing = false;
+    unsigned int m_nbWriterWaiting = 0;
+};
+
+constexpr auto NbReadsPerThread = 200000u;
+// One write every WriteInterval, to measure the contended paths as well
+constexpr auto WriteInterval = std::chrono::microseconds{ 500 };
+
+struct Result
+{
+    double readsPerSecond;
+    unsigned int nbWrites;
+};
+
+template <typename Lock>
+Result run( unsigned int nbReaders )
+{
+    Lock lock;
+    std::atomic_bool done{ false };
+    // Only there to prevent the critical sections from being optimized out
+    std::atomic_uint value{ 0 };
+    unsigned int nbWrites = 0;
+
+    std::thread writer( [&]() {
+        while ( done.load() == false )
+        {
+            lock.lock_write();
+            value.fetch_add( 1, std::memory_order_relaxed );
+            lock.unlock_write();
+            ++nbWrites;
+            std::this_thread::sleep_for( WriteInterval );
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> readers;
+    for ( auto i = 0u; i < nbReaders; ++i )
+    {
+        readers.emplace_back( [&]() {
+            for ( auto j = 0u; j < NbReadsPerThread; ++j )
+            {
+                lock.lock_read();
+                value.load( std::memory_order_relaxed );
+                lock.unlock_read();
+            }
+        });
+    }
+    for ( auto& t : readers )
+        t.join();
+    auto duration = std::chrono::duration<double>( std::chrono::steady_clock::now() - start );
+    done = true;
+    writer.join();
+    return Result{ nbReaders * NbReadsPerThread / duration.count(), nbWrites };
+}
+
+template <typename Lock>
+void report( const char* name, unsigned int nbReaders )
+{
+    auto res = run<Lock>( nbReaders );
+    std::cout << name << "\t" << nbReaders << " readers\t"
+              << static_cast<uint64_t>( res.readsPerSecond ) << " reads/s\t"
+              << res.nbWrites << " writes" << std::endl;
+}
+
+}
+
+int main()
+{
+    for ( auto nbReaders : { 1u, 4u, 16u } )
+    {
+        report<MutexSWMRLock>( "mutex", nbReaders );
+        report<utils::SWMRLock>( "atomic", nbReaders );
+    }
+    return 0;
+}
@@ -72,6 +72,14 @@ std::shared_ptr<Media> MediaLibraryTester::addFile( fs::IFile& file )
     return MediaLibrary::addFile( file, dummyFolder, *dummyDirectory );
 }
 
+std::vector<std::shared_ptr<Media>> MediaLibraryTester::addFiles( const std::vector<std::string>& paths )
+{
+    std::vector<std::shared_ptr<fs::IFile>> files;
+    for ( const auto& p : paths )
+        files.push_back( std::make_shared<mock::NoopFile>( p ) );
+    return MediaLibrary::addFiles( files, dummyFolder, *dummyDirectory );
+}
+
 void MediaLibraryTester::addLocalFsFactory()
 {
     if ( fsFactory != nullptr )
@@ -58,6 +58,7 @@ public:
     std::shared_ptr<Media> addFile(fs::IFile& file);
     // Used when we need an actual file instead of an external media
     std::shared_ptr<Media> addFile( const std::string& path );
+    std::vector<std::shared_ptr<Media>> addFiles( const std::vector<std::string>& paths );
     virtual void addLocalFsFactory() override;
     std::shared_ptr<Device> device( const std::string& uuid );
     std::vector<const char*> getSupportedExtensions() const;
@@ -77,10 +78,12 @@ class MediaLibraryWithoutBackground : public MediaLibraryTester
 {
     virtual void startDiscoverer() override {}
     virtual void startParser() override {}
+    virtual void startPreload() override {}
 };
 
 class MediaLibraryWithNotifier : public MediaLibraryTester
 {
     virtual void startDiscoverer() override {}
     virtual void startParser() override {}
+    virtual void startPreload() override {}
 };
@@ -371,6 +371,27 @@ TEST_F( Albums, SortTracks )
     ASSERT_EQ( 2u, tracks.size() );
     ASSERT_EQ( t1->id(), tracks[1]->id() ); // B-track -> first
     ASSERT_EQ( t2->id(), tracks[0]->id() ); // A-track -> second
+
+    auto ids = a->trackIds( SortingCriteria::Alpha, false );
+    ASSERT_EQ( 2u, ids.size() );
+    ASSERT_EQ( m2->id(), ids[0] );
+    ASSERT_EQ( m1->id(), ids[1] );
+}
+
+TEST_F( Albums, CountAndIds )
+{
+    ASSERT_EQ( 0u, ml->nbAlbums() );
+    auto a1 = ml->createAlbum( "A" );
+    a1->setReleaseYear( 1000, false );
+    auto a2 = ml->createAlbum( "B" );
+    a2->setReleaseYear( 2000, false );
+
+    ASSERT_EQ( 2u, ml->nbAlbums() );
+    auto albums = ml->albums( SortingCriteria::ReleaseDate, true );
+    auto ids = ml->albumIds( SortingCriteria::ReleaseDate, true );
+    ASSERT_EQ( 2u, ids.size() );
+    ASSERT_EQ( albums[0]->id(), ids[0] );
+    ASSERT_EQ( albums[1]->id(), ids[1] );
 }
 
 TEST_F( Albums, Sort )
@@ -477,3 +498,45 @@ TEST_F( Albums, Duration )
     a2 = ml->album( a->id() );
     ASSERT_EQ( 100u, a2->duration() );
 }
+
+TEST_F( Albums, EagerLoading )
+{
+    auto artist = ml->createArtist( "artist" );
+    auto a = ml->createAlbum( "album" );
+    for ( auto i = 1u; i <= 5; ++i )
+    {
+        auto f = std::static_pointer_cast<Media>( ml->addMedia( "track" + std::to_string( i ) + ".mp3" ) );
+        a->addTrack( f, i, 0, artist->id(), nullptr );
+        f->save();
+    }
+    auto albumId = a->id();
+    a.reset();
+    artist.reset();
+
+    auto nbQueries = [this]() {
+        auto res = 0u;
+        for ( const auto& q : ml->queryProfile( false ).queries )
+            res += q.latency.count;
+        return res;
+    };
+    auto browse = [this, albumId]() {
+        auto tracks = ml->album( albumId )->tracks( SortingCriteria::Default, false );
+        ASSERT_EQ( 5u, tracks.size() );
+        ml->setQueryProfiling( true );
+        for ( const auto& t : tracks )
+        {
+            ASSERT_EQ( 1u, t->files().size() );
+            ASSERT_NE( nullptr, t->albumTrack()->artist() );
+            ASSERT_EQ( albumId, t->albumTrack()->album()->id() );
+        }
+    };
+
+    Reload();
+    browse();
+    ASSERT_NE( 0u, nbQueries() );
+
+    Reload();
+    ml->setEagerLoading( true );
+    browse();
+    ASSERT_EQ( 0u, nbQueries() );
+}
@@ -138,3 +138,28 @@ TEST_F( AlbumTracks, Album )
     ASSERT_EQ( albumFromTrack, a2 );
     ASSERT_EQ( aft2, a2 );
 }
+
+TEST_F( AlbumTracks, FetchFromMedia )
+{
+    auto album = ml->createAlbum( "album" );
+    auto m1 = std::static_pointer_cast<Media>( ml->addMedia( "track1.mp3" ) );
+    auto m2 = std::static_pointer_cast<Media>( ml->addMedia( "track2.mp3" ) );
+    auto m3 = ml->addMedia( "media.mkv" );
+    album->addTrack( m1, 1, 1, 0, nullptr );
+    album->addTrack( m2, 2, 2, 0, nullptr );
+    m1->save();
+    m2->save();
+
+    Reload();
+
+    std::vector<MediaPtr> media{ ml->media( m1->id() ), ml->media( m2->id() ), ml->media( m3->id() ) };
+    // The cached album track is reused, the missing ones are fetched
+    auto cached = media[0]->albumTrack();
+    auto albumTracks = Media::albumTracks( ml.get(), media );
+    ASSERT_EQ( 3u, albumTracks.size() );
+    ASSERT_EQ( cached, albumTracks[0] );
+    ASSERT_NE( nullptr, albumTracks[1] );
+    ASSERT_EQ( 2u, albumTracks[1]->discNumber() );
+    ASSERT_EQ( albumTracks[1], media[1]->albumTrack() );
+    ASSERT_EQ( nullptr, albumTracks[2] );
+}
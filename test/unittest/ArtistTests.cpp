@@ -245,6 +245,45 @@ TEST_F( Artists, SortMedia )
     ASSERT_EQ( "song3.mp3", tracks[2]->title() );
 }
 
+TEST_F( Artists, MediaIds )
+{
+    auto artist = ml->createArtist( "Russian Otters" );
+    ASSERT_EQ( 0u, artist->nbMedia() );
+
+    for (auto i = 1; i <= 3; ++i)
+    {
+        auto f = std::static_pointer_cast<Media>( ml->addMedia( "song" + std::to_string(i) + ".mp3" ) );
+        f->setDuration( 10 - i );
+        f->save();
+        artist->addMedia( *f );
+    }
+
+    ASSERT_EQ( 3u, artist->nbMedia() );
+    auto tracks = artist->media( SortingCriteria::Duration, true );
+    auto ids = artist->mediaIds( SortingCriteria::Duration, true );
+    ASSERT_EQ( tracks.size(), ids.size() );
+    for ( auto i = 0u; i < ids.size(); ++i )
+        ASSERT_EQ( tracks[i]->id(), ids[i] );
+}
+
+TEST_F( Artists, CountAndIds )
+{
+    // Keep in mind that artists are only listed when they are marked as album artist at least once
+    auto a1 = ml->createArtist( "A" );
+    auto alb1 = ml->createAlbum( "albumA" );
+    alb1->setAlbumArtist( a1 );
+    auto a2 = ml->createArtist( "B" );
+    auto alb2 = ml->createAlbum( "albumB" );
+    alb2->setAlbumArtist( a2 );
+    ml->createArtist( "C" );
+
+    ASSERT_EQ( 2u, ml->nbArtists() );
+    auto ids = ml->artistIds( SortingCriteria::Default, true );
+    ASSERT_EQ( 2u, ids.size() );
+    ASSERT_EQ( a2->id(), ids[0] );
+    ASSERT_EQ( a1->id(), ids[1] );
+}
+
 TEST_F( Artists, SortAlbum )
 {
     auto artist = ml->createArtist( "Dream Seaotter" );
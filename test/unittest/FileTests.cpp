@@ -28,6 +28,7 @@
 
 #include "Media.h"
 #include "File.h"
+#include "mocks/FileSystem.h"
 
 class Files : public Tests
 {
@@ -75,3 +76,51 @@ TEST_F( Files, Media )
     f = std::static_pointer_cast<File>( files[0] );
     ASSERT_EQ( m->id(), f->media()->id() );
 }
+
+TEST_F( Files, CreateBatch )
+{
+    auto media = Media::createBatch( ml.get(), IMedia::Type::Unknown, { "first.mkv", "second.mkv" } );
+    ASSERT_EQ( 2u, media.size() );
+    std::vector<std::shared_ptr<fs::IFile>> filesFs{
+        std::make_shared<mock::NoopFile>( "first.mkv" ),
+        std::make_shared<mock::NoopFile>( "second.mkv" ),
+    };
+    auto files = File::createBatch( ml.get(), { media[0]->id(), media[1]->id() }, File::Type::Main,
+                                    filesFs, 0, false );
+    ASSERT_EQ( 2u, files.size() );
+    ASSERT_NE( files[0]->id(), files[1]->id() );
+
+    Reload();
+
+    for ( auto i = 0u; i < files.size(); ++i )
+    {
+        auto m = ml->media( media[i]->id() );
+        ASSERT_NE( nullptr, m );
+        auto mFiles = m->files();
+        ASSERT_EQ( 1u, mFiles.size() );
+        ASSERT_EQ( files[i]->id(), mFiles[0]->id() );
+        ASSERT_EQ( filesFs[i]->mrl(), mFiles[0]->mrl() );
+        ASSERT_EQ( File::Type::Main, mFiles[0]->type() );
+    }
+}
+
+TEST_F( Files, AddFiles )
+{
+    auto media = ml->addFiles( { "first.mkv", "rejected.foo", "second.mp3" } );
+    // The file with an unsupported extension is skipped
+    ASSERT_EQ( 2u, media.size() );
+    ASSERT_EQ( "first.mkv", media[0]->title() );
+    ASSERT_EQ( "second.mp3", media[1]->title() );
+
+    Reload();
+
+    auto m = ml->media( media[0]->id() );
+    auto files = m->files();
+    ASSERT_EQ( 1u, files.size() );
+    ASSERT_EQ( "first.mkv", files[0]->mrl() );
+    m = ml->media( media[1]->id() );
+    files = m->files();
+    ASSERT_EQ( 1u, files.size() );
+    ASSERT_EQ( "second.mp3", files[0]->mrl() );
+    ASSERT_EQ( nullptr, ml->media( "rejected.foo" ) );
+}
@@ -442,6 +442,30 @@ TEST_F( Folders, RemoveEntryPoint )
     ASSERT_EQ( media.size(), media2.size() );
 }
 
+TEST_F( Folders, SubtreeMediaIds )
+{
+    auto root = ml->folder( mock::FileSystemFactory::Root );
+    auto sub = ml->folder( mock::FileSystemFactory::SubFolder );
+    ASSERT_EQ( 3u, Folder::subtreeMediaIds( ml.get(), root->id() ).size() );
+    auto ids = Folder::subtreeMediaIds( ml.get(), sub->id() );
+    ASSERT_EQ( 1u, ids.size() );
+    auto media = ml->media( mock::FileSystemFactory::SubFolder + "subfile.mp4" );
+    ASSERT_EQ( media->id(), ids[0] );
+}
+
+TEST_F( Folders, RemoveEntryPointKeepsUnrelatedMedia )
+{
+    auto media = ml->media( mock::FileSystemFactory::Root + "video.avi" );
+    ASSERT_NE( nullptr, media );
+
+    ml->removeEntryPoint( mock::FileSystemFactory::SubFolder );
+    ASSERT_TRUE( cbMock->waitEntryPointRemoved() );
+
+    // Media outside of the removed folder are left in the cache
+    ASSERT_EQ( media, ml->media( media->id() ) );
+    ASSERT_EQ( nullptr, ml->media( mock::FileSystemFactory::SubFolder + "subfile.mp4" ) );
+}
+
 TEST_F( Folders, RemoveNonExistantEntryPoint )
 {
     ml->removeEntryPoint( "/sea/otter" );
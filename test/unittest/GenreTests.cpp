@@ -58,6 +58,11 @@ TEST_F( Genres, List )
     ASSERT_NE( nullptr, g2 );
     auto genres = ml->genres( SortingCriteria::Default, false );
     ASSERT_EQ( 2u, genres.size() );
+    ASSERT_EQ( 2u, ml->nbGenres() );
+    auto ids = ml->genreIds( SortingCriteria::Default, false );
+    ASSERT_EQ( 2u, ids.size() );
+    ASSERT_EQ( genres[0]->id(), ids[0] );
+    ASSERT_EQ( genres[1]->id(), ids[1] );
 }
 
 TEST_F( Genres, ListAlbumTracks )
@@ -32,6 +32,8 @@
 #include "Artist.h"
 #include "Album.h"
 #include "AlbumTrack.h"
+#include "database/SqliteConnection.h"
+#include "database/SqliteTransaction.h"
 #include "mocks/FileSystem.h"
 #include "mocks/DiscovererCbMock.h"
 #include "compat/Thread.h"
@@ -126,6 +128,188 @@ TEST_F( Medias, PlayCount )
     ASSERT_EQ( 1, f->playCount() );
 }
 
+TEST_F( Medias, FlushDeferredUpdates )
+{
+    auto m = std::static_pointer_cast<Media>( ml->addMedia( "media.avi" ) );
+    m->increasePlayCount();
+    m->setFavorite( true );
+
+    ml->getConn()->flush();
+    // Force the media to be fetched from the database
+    Media::clear( ml.get() );
+
+    m = std::static_pointer_cast<Media>( ml->media( m->id() ) );
+    ASSERT_EQ( 1, m->playCount() );
+    ASSERT_TRUE( m->isFavorite() );
+}
+
+TEST_F( Medias, DeferredUpdateOutlivesEviction )
+{
+    auto& cache = Media::cache( ml.get() );
+    // Keep a single media per shard
+    cache.setCapacity( cache.ShardCount );
+    std::vector<int64_t> ids;
+    for ( auto i = 0u; i < cache.ShardCount * 2; ++i )
+        ids.push_back( ml->addMedia( "media" + std::to_string( i ) + ".mp3" )->id() );
+
+    ml->media( ids[0] )->setFavorite( true );
+    // Load all the other media, which evicts the unused ones. The update of
+    // the first media might still be pending, in which case it gets reloaded
+    // from its former row, and must be evicted again once the update is done.
+    for ( auto i = 1u; i < ids.size(); ++i )
+        ml->media( ids[i] );
+    Media::invalidate( ml.get(), { ids[0] } );
+    ml->media( ids[0] );
+    ASSERT_TRUE( ml->getConn()->flush() );
+    ASSERT_TRUE( ml->media( ids[0] )->isFavorite() );
+}
+
+TEST_F( Medias, FetchDeletedInTransaction )
+{
+    auto m = ml->addMedia( "media.mkv" );
+    auto id = m->id();
+    auto t = ml->getConn()->newTransaction();
+    Media::destroy( ml.get(), id );
+    // The deletion hook only runs once the transaction is over, but the
+    // cached media mustn't be returned meanwhile
+    ASSERT_EQ( nullptr, ml->media( id ) );
+    ASSERT_EQ( nullptr, Media::fetchByIds( ml.get(), { id } )[0] );
+    t->commit();
+    t.reset();
+    ASSERT_TRUE( std::static_pointer_cast<Media>( m )->isDeleted() );
+    ASSERT_EQ( nullptr, ml->media( id ) );
+}
+
+TEST_F( Medias, FetchCommittedDeletion )
+{
+    auto m = ml->addMedia( "media.mkv" );
+    auto id = m->id();
+    {
+        auto ctx = ml->getConn()->acquireWriteContext();
+        auto req = "DELETE FROM " + policy::MediaTable::Name +
+                " WHERE id_media = " + std::to_string( id );
+        ASSERT_EQ( SQLITE_OK, sqlite3_exec( ml->getConn()->getConn(), req.c_str(),
+                                            nullptr, nullptr, nullptr ) );
+        // The deletion is committed, but the hooks only run once the write
+        // context is released. Other threads mustn't get the cached media
+        // meanwhile.
+        MediaPtr res = m;
+        compat::Thread t( [this, id, &res]() {
+            res = ml->media( id );
+        });
+        t.join();
+        ASSERT_EQ( nullptr, res );
+    }
+    ASSERT_TRUE( std::static_pointer_cast<Media>( m )->isDeleted() );
+}
+
+TEST_F( Medias, FetchUncommittedInsertion )
+{
+    auto t = ml->getConn()->newTransaction();
+    auto m = Media::create( ml.get(), IMedia::Type::Video, "media.mkv" );
+    auto id = m->id();
+    // The media is cached, but mustn't be visible to other threads until
+    // it's committed
+    MediaPtr res = m;
+    compat::Thread th( [this, id, &res]() {
+        res = ml->media( id );
+    });
+    th.join();
+    ASSERT_EQ( nullptr, res );
+    t->commit();
+    t.reset();
+    compat::Thread th2( [this, id, &res]() {
+        res = ml->media( id );
+    });
+    th2.join();
+    ASSERT_EQ( m, res );
+}
+
+TEST_F( Medias, DontCacheReadsAcrossCommits )
+{
+    auto id = ml->addMedia( "media.mkv" )->id();
+    // Start with an empty cache
+    Reload();
+    auto& cache = Media::cache( ml.get() );
+    {
+        auto ctx = ml->getConn()->acquireReadContext();
+        // Commit a change from another thread while this context is held
+        compat::Thread t( [this]() {
+            ml->addMedia( "media2.mkv" );
+        });
+        t.join();
+        // The media could have been read before the commit, so it isn't cached
+        ASSERT_NE( nullptr, ml->media( id ) );
+        ASSERT_EQ( nullptr, cache.peek( id ) );
+    }
+    ASSERT_NE( nullptr, ml->media( id ) );
+    ASSERT_NE( nullptr, cache.peek( id ) );
+}
+
+TEST_F( Medias, EagerLoadingWithoutInterface )
+{
+    for ( auto i = 0u; i < 3; ++i )
+        ml->addMedia( "media" + std::to_string( i ) + ".mp3" );
+    Reload();
+    ml->setEagerLoading( true );
+    // Listings of the implementation type get their relations loaded as well
+    static const std::string req = "SELECT * FROM " + policy::MediaTable::Name;
+    auto media = Media::fetchAll<Media>( ml.get(), req );
+    ASSERT_EQ( 3u, media.size() );
+    ml->setQueryProfiling( true );
+    for ( const auto& m : media )
+        ASSERT_EQ( 1u, m->files().size() );
+    ASSERT_EQ( 0u, ml->queryProfile( false ).queries.size() );
+    ml->setQueryProfiling( false );
+}
+
+TEST_F( Medias, DropFailingDeferredUpdate )
+{
+    static const std::string invalidReq = "UPDATE NonExistingTable SET value = ?";
+    auto m1 = ml->addMedia( "media1.mkv" );
+    auto m2 = ml->addMedia( "media2.mkv" );
+    std::vector<bool> results;
+    auto done = [&results]( bool success ) { results.push_back( success ); };
+    m1->setFavorite( true );
+    sqlite::Tools::executeDeferredUpdate( ml->getConn(), nullptr, done, invalidReq, 1 );
+    m2->setFavorite( true );
+
+    // Only the failing update is dropped, and reported as such
+    ASSERT_FALSE( ml->getConn()->flush() );
+    ASSERT_EQ( 1u, ml->getConn()->nbDroppedWrites() );
+    ASSERT_EQ( 1u, results.size() );
+    ASSERT_FALSE( results[0] );
+    Media::clear( ml.get() );
+    ASSERT_TRUE( ml->media( m1->id() )->isFavorite() );
+    ASSERT_TRUE( ml->media( m2->id() )->isFavorite() );
+}
+
+TEST_F( Medias, CreateBatch )
+{
+    {
+        auto t = ml->getConn()->newTransaction();
+        auto media = Media::createBatch( ml.get(), Media::Type::Unknown, { "media1.mkv", "media2.mkv" } );
+        ASSERT_EQ( 2u, media.size() );
+        ASSERT_NE( 0, media[0]->id() );
+        ASSERT_NE( media[0]->id(), media[1]->id() );
+        t->commit();
+    }
+    auto media = ml->files();
+    ASSERT_EQ( 2u, media.size() );
+
+    int64_t rolledBackId;
+    {
+        auto t = ml->getConn()->newTransaction();
+        auto m = Media::createBatch( ml.get(), Media::Type::Unknown, { "media3.mkv" } );
+        ASSERT_EQ( 1u, m.size() );
+        rolledBackId = m[0]->id();
+        // Don't commit
+    }
+    ASSERT_EQ( nullptr, ml->media( rolledBackId ) );
+    Reload();
+    ASSERT_EQ( 2u, ml->files().size() );
+}
+
 TEST_F( Medias, Progress )
 {
     auto f = std::static_pointer_cast<Media>( ml->addMedia( "media.avi" ) );
@@ -329,6 +513,22 @@ TEST_F( Medias, ClearHistory )
     ASSERT_EQ( 0u, history.size() );
 }
 
+TEST_F( Medias, ClearHistoryInvalidation )
+{
+    auto played = std::static_pointer_cast<Media>( ml->addMedia( "played.mkv" ) );
+    auto other = ml->addMedia( "other.mkv" );
+    played->increasePlayCount();
+    played->save();
+
+    ASSERT_TRUE( ml->clearHistory() );
+
+    // Only the media which had some history are evicted from the cache
+    ASSERT_EQ( other, ml->media( other->id() ) );
+    auto m = ml->media( played->id() );
+    ASSERT_NE( played, m );
+    ASSERT_EQ( 0u, m->playCount() );
+}
+
 TEST_F( Medias, SetReleaseDate )
 {
     auto m = std::static_pointer_cast<Media>( ml->addMedia( "movie.mkv" ) );
@@ -424,6 +624,191 @@ TEST_F( Medias, SortByFileSize )
     ASSERT_EQ( m1->id(), media[0]->id() );
 }
 
+TEST_F( Medias, Paginate )
+{
+    const char* titles[] = { "Zyxw", "Abcd", "Mnop", "Abcd", "Efgh" };
+    for ( auto i = 0u; i < 5; ++i )
+    {
+        auto m = std::static_pointer_cast<Media>( ml->addMedia( "media" + std::to_string( i ) + ".mp3" ) );
+        m->setTitleBuffered( titles[i] );
+        m->setType( Media::Type::Audio );
+        m->save();
+    }
+
+    for ( auto desc : { false, true } )
+    {
+        auto all = ml->audioFiles( SortingCriteria::Alpha, desc );
+        ASSERT_EQ( 5u, all.size() );
+
+        std::vector<MediaPtr> paged;
+        std::string next;
+        auto nbPages = 0u;
+        do
+        {
+            auto page = ml->audioFiles( SortingCriteria::Alpha, desc, 2, next );
+            ASSERT_GE( 2u, page.items.size() );
+            paged.insert( end( paged ), begin( page.items ), end( page.items ) );
+            next = page.next;
+            ++nbPages;
+        } while ( next.empty() == false );
+        ASSERT_EQ( 3u, nbPages );
+        ASSERT_EQ( all.size(), paged.size() );
+        for ( auto i = 0u; i < all.size(); ++i )
+            ASSERT_EQ( all[i]->id(), paged[i]->id() );
+    }
+
+    auto page = ml->audioFiles( SortingCriteria::Alpha, false, 2, {} );
+    ASSERT_FALSE( page.next.empty() );
+    // A token is bound to the ordering it was generated for
+    auto other = ml->audioFiles( SortingCriteria::Duration, false, 2, page.next );
+    ASSERT_EQ( 0u, other.items.size() );
+    other = ml->audioFiles( SortingCriteria::Alpha, false, 2, "garbage" );
+    ASSERT_EQ( 0u, other.items.size() );
+}
+
+TEST_F( Medias, PaginateAllOrderings )
+{
+    for ( auto i = 0u; i < 3; ++i )
+    {
+        auto m = std::static_pointer_cast<Media>( ml->addMedia( "media" + std::to_string( i ) + ".mp3" ) );
+        m->setType( Media::Type::Audio );
+        m->save();
+    }
+    const SortingCriteria sorts[] = { SortingCriteria::Default, SortingCriteria::Alpha,
+                                      SortingCriteria::Duration, SortingCriteria::InsertionDate,
+                                      SortingCriteria::LastModificationDate, SortingCriteria::ReleaseDate,
+                                      SortingCriteria::FileSize, SortingCriteria::Artist };
+    for ( auto pass = 0u; pass < 2; ++pass )
+    {
+        for ( auto sort : sorts )
+        {
+            for ( auto desc : { false, true } )
+            {
+                auto page = ml->audioFiles( sort, desc, 2, {} );
+                ASSERT_EQ( 2u, page.items.size() );
+                ASSERT_FALSE( page.next.empty() );
+                page = ml->audioFiles( sort, desc, 2, page.next );
+                ASSERT_EQ( 1u, page.items.size() );
+                ASSERT_TRUE( page.next.empty() );
+            }
+        }
+        // The requests are now registered and get prepared along with the new connection
+        Reload();
+    }
+}
+
+TEST_F( Medias, CacheEviction )
+{
+    auto& cache = Media::cache( ml.get() );
+    // Keep a single media per shard
+    cache.setCapacity( cache.ShardCount );
+
+    std::vector<int64_t> ids;
+    for ( auto i = 0u; i < cache.ShardCount * 2; ++i )
+        ids.push_back( ml->addMedia( "media" + std::to_string( i ) + ".mp3" )->id() );
+    ASSERT_EQ( cache.ShardCount, cache.size() );
+
+    // A media still in use is never evicted
+    auto media = ml->media( ids[0] );
+    ASSERT_NE( nullptr, media );
+    for ( auto id : ids )
+        ASSERT_NE( nullptr, ml->media( id ) );
+    ASSERT_EQ( media, ml->media( ids[0] ) );
+    ASSERT_GE( cache.ShardCount + 1, cache.size() );
+}
+
+TEST_F( Medias, FetchByIds )
+{
+    auto m1 = ml->addMedia( "media1.mkv" );
+    auto m2 = ml->addMedia( "media2.mkv" );
+    auto m3 = ml->addMedia( "media3.mkv" );
+    auto m1Id = m1->id();
+    auto m3Id = m3->id();
+    m1.reset();
+    m3.reset();
+    Media::clear( ml.get() );
+
+    auto media = Media::fetchByIds( ml.get(), { m3Id, 123, m2->id(), m1Id, m3Id } );
+    ASSERT_EQ( 5u, media.size() );
+    ASSERT_EQ( m3Id, media[0]->id() );
+    ASSERT_EQ( nullptr, media[1] );
+    ASSERT_EQ( m2->id(), media[2]->id() );
+    ASSERT_EQ( m1Id, media[3]->id() );
+    ASSERT_EQ( media[0], media[4] );
+    // The fetched media are now cached
+    ASSERT_EQ( media[3], ml->media( m1Id ) );
+}
+
+TEST_F( Medias, CountAndIds )
+{
+    auto file1 = std::make_shared<mock::NoopFile>( "media.mkv" );
+    file1->setSize( 666 );
+    auto m1 = ml->addFile( *file1 );
+    m1->setType( Media::Type::Video );
+    m1->save();
+
+    auto file2 = std::make_shared<mock::NoopFile>( "media2.mkv" );
+    file2->setSize( 111 );
+    auto m2 = ml->addFile( *file2 );
+    m2->setType( Media::Type::Video );
+    m2->save();
+
+    auto m3 = std::static_pointer_cast<Media>( ml->addMedia( "media3.mp3" ) );
+    m3->setType( Media::Type::Audio );
+    m3->save();
+
+    ASSERT_EQ( 2u, ml->nbVideoFiles() );
+    ASSERT_EQ( 1u, ml->nbAudioFiles() );
+
+    auto ids = ml->videoFileIds( SortingCriteria::FileSize, false );
+    ASSERT_EQ( 2u, ids.size() );
+    ASSERT_EQ( m2->id(), ids[0] );
+    ASSERT_EQ( m1->id(), ids[1] );
+
+    ids = ml->videoFileIds( SortingCriteria::FileSize, true );
+    ASSERT_EQ( 2u, ids.size() );
+    ASSERT_EQ( m1->id(), ids[0] );
+    ASSERT_EQ( m2->id(), ids[1] );
+
+    ids = ml->audioFileIds( SortingCriteria::Default, false );
+    ASSERT_EQ( 1u, ids.size() );
+    ASSERT_EQ( m3->id(), ids[0] );
+}
+
+TEST_F( Medias, FetchAsync )
+{
+    auto m = std::static_pointer_cast<Media>( ml->addMedia( "media.mp3" ) );
+    m->setType( Media::Type::Audio );
+    m->setTitleBuffered( "Abcd" );
+    m->save();
+
+    auto media = ml->mediaAsync( m->id() ).get();
+    ASSERT_NE( nullptr, media );
+    ASSERT_EQ( m->id(), media->id() );
+
+    auto audioFiles = ml->audioFilesAsync( SortingCriteria::Alpha, false, {} ).get();
+    ASSERT_EQ( 1u, audioFiles.size() );
+
+    // Issue a few searches with the same key, as a search-as-you-type UI would
+    std::vector<std::future<MediaSearchAggregate>> searches;
+    for ( auto pattern : { "abc", "abcd", "abcde", "abcd" } )
+        searches.push_back( ml->searchMediaAsync( pattern, "search" ) );
+    for ( auto i = 0u; i < searches.size() - 1; ++i )
+    {
+        try
+        {
+            searches[i].get();
+        }
+        catch ( const std::future_error& ex )
+        {
+            ASSERT_EQ( std::future_errc::broken_promise, ex.code() );
+        }
+    }
+    // The last request can't be dropped
+    auto res = searches.back().get();
+    ASSERT_EQ( 1u, res.others.size() );
+}
+
 TEST_F( Medias, SetType )
 {
     auto m1 = std::static_pointer_cast<Media>( ml->addMedia( "media1.mp3" ) );
@@ -26,6 +26,20 @@
 
 #include "Tests.h"
 
+#include <algorithm>
+#include <sqlite3.h>
+
+#include "Album.h"
+#include "File.h"
+#include "Genre.h"
+#include "Media.h"
+#include "Migrations.h"
+#include "Playlist.h"
+#include "database/SqliteTools.h"
+#include "medialibrary/IPlaylist.h"
+#include "mocks/FileSystem.h"
+#include "utils/Cache.h"
+
 class Misc : public Tests
 {
 };
@@ -38,3 +52,401 @@ TEST_F( Misc, FileExtensions )
         ASSERT_LT( strcmp( supportedExtensions[i], supportedExtensions[i + 1] ), 0 );
     }
 }
+
+TEST_F( Misc, QueryProfile )
+{
+    ml->createPlaylist( "playlist" );
+    ml->playlists( SortingCriteria::Default, false );
+    // The profiler is disabled by default
+    auto profile = ml->queryProfile( false );
+    ASSERT_EQ( 0u, profile.queries.size() );
+
+    ml->setQueryProfiling( true );
+    ml->createPlaylist( "playlist 2" );
+    ml->playlists( SortingCriteria::Default, false );
+    ml->playlists( SortingCriteria::Default, false );
+    profile = ml->queryProfile( true );
+    ASSERT_NE( 0u, profile.queries.size() );
+    ASSERT_NE( 0u, profile.readLockWait.count );
+    ASSERT_NE( 0u, profile.writeLockWait.count );
+
+    auto it = std::find_if( begin( profile.queries ), end( profile.queries ), []( const QueryStats& q ) {
+        return q.sql.find( "ORDER BY" ) != std::string::npos && q.nbRows != 0;
+    });
+    ASSERT_NE( end( profile.queries ), it );
+    ASSERT_EQ( 2u, it->latency.count );
+    ASSERT_EQ( 4u, it->nbRows );
+    ASSERT_LE( it->latency.p50, it->latency.p99 );
+    ASSERT_LE( it->latency.p99, it->latency.max );
+    ASSERT_FALSE( it->queryPlan.empty() );
+
+    ml->resetQueryProfile();
+    ml->setQueryProfiling( false );
+    ml->playlists( SortingCriteria::Default, false );
+    profile = ml->queryProfile( false );
+    ASSERT_EQ( 0u, profile.queries.size() );
+}
+
+TEST_F( Misc, QueryProfileMergesConnections )
+{
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT COUNT(*) FROM " + policy::PlaylistTable::Name );
+    ml->setQueryProfiling( true );
+    // Once from a read only connection, once from the write connection
+    sqlite::Tools::forEachRow( ml.get(), req, []( sqlite::Row& ) {} );
+    {
+        auto t = ml->getConn()->newTransaction();
+        sqlite::Tools::forEachRow( ml.get(), req, []( sqlite::Row& ) {} );
+        t->commit();
+    }
+    auto profile = ml->queryProfile( false );
+    auto nbEntries = std::count_if( begin( profile.queries ), end( profile.queries ),
+                                    []( const QueryStats& q ) {
+        return q.sql == req.sql;
+    });
+    ASSERT_EQ( 1, nbEntries );
+    auto it = std::find_if( begin( profile.queries ), end( profile.queries ),
+                            []( const QueryStats& q ) {
+        return q.sql == req.sql;
+    });
+    ASSERT_EQ( 2u, it->latency.count );
+    ASSERT_EQ( 2u, it->nbRows );
+}
+
+TEST_F( Misc, PrecompiledRequests )
+{
+    sqlite3* db;
+    ASSERT_EQ( SQLITE_OK, sqlite3_open( ":memory:", &db ) );
+    std::unique_ptr<sqlite3, int(*)(sqlite3*)> dbPtr( db, &sqlite3_close );
+    static const auto req = sqlite::StatementCache::registerRequest(
+            "SELECT id FROM PrecompiledRequests" );
+    ASSERT_EQ( req.slot, sqlite::StatementCache::registerRequest( req.sql ).slot );
+    {
+        sqlite::StatementCache cache( db );
+        // The table doesn't exist yet, so the request is compiled upon its
+        // first use instead
+        cache.prepareRegistered();
+        ASSERT_THROW( cache.get( req ), sqlite::errors::Generic );
+        ASSERT_EQ( SQLITE_OK, sqlite3_exec( db, "CREATE TABLE PrecompiledRequests(id INTEGER)",
+                                            nullptr, nullptr, nullptr ) );
+        auto stmt = cache.get( req );
+        ASSERT_NE( nullptr, stmt );
+        ASSERT_EQ( stmt, cache.get( req ) );
+    }
+#ifndef NDEBUG
+    // Any other failure is a bug in the request. It's only registered in the
+    // death test process, so that other connections don't compile it.
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    ASSERT_DEATH( {
+        sqlite::StatementCache::registerRequest( "SELEC id FROM PrecompiledRequests" );
+        sqlite::StatementCache cache( db );
+        cache.prepareRegistered();
+    }, "Invalid registered request" );
+#endif
+}
+
+TEST_F( Misc, CacheDiscardsStaleLoad )
+{
+    Cache<std::vector<int>> c;
+    auto nbLoads = 0;
+    auto& v = c.load( [&c, &nbLoads]() {
+        ++nbLoads;
+        // Simulate a file being added by another thread during the first load
+        if ( nbLoads == 1 )
+        {
+            auto lock = c.lock();
+            c.markModified();
+        }
+        return std::vector<int>{ nbLoads };
+    });
+    ASSERT_EQ( 2, nbLoads );
+    ASSERT_EQ( 2, v[0] );
+
+    // A value loaded before a modification can't be published...
+    Cache<std::vector<int>> c2;
+    auto version = c2.version();
+    {
+        auto lock = c2.lock();
+        c2.markModified();
+    }
+    ASSERT_EQ( nullptr, c2.initialize( std::vector<int>{ 1 }, version ) );
+    ASSERT_FALSE( c2.isCached() );
+    // ...but one loaded after it can
+    ASSERT_NE( nullptr, c2.initialize( std::vector<int>{ 2 }, c2.version() ) );
+    ASSERT_EQ( 2, c2.get()[0] );
+}
+
+TEST_F( Misc, BusyTimeout )
+{
+    ml->createPlaylist( "playlist" );
+    const BusyPolicy policy{ std::chrono::milliseconds{ 1 },
+                             std::chrono::milliseconds{ 10 },
+                             std::chrono::milliseconds{ 300 } };
+    ml->setBusyPolicy( policy );
+    auto profile = ml->queryProfile( false );
+    ASSERT_EQ( 0u, profile.busy.nbTimeouts );
+
+    // Hold the database write lock from another connection
+    sqlite3* conn;
+    ASSERT_EQ( SQLITE_OK, sqlite3_open( "test.db", &conn ) );
+    ASSERT_EQ( SQLITE_OK, sqlite3_exec( conn, "BEGIN EXCLUSIVE", nullptr, nullptr, nullptr ) );
+
+    auto start = std::chrono::steady_clock::now();
+    auto pl = ml->createPlaylist( "playlist 2" );
+    auto duration = std::chrono::steady_clock::now() - start;
+    ASSERT_EQ( nullptr, pl );
+    // The busy handler waits and the statement retries share the deadline
+    ASSERT_LT( duration, policy.deadline * 3 / 2 );
+
+    profile = ml->queryProfile( false );
+    ASSERT_NE( 0u, profile.busy.nbBusy );
+    ASSERT_NE( 0u, profile.busy.nbTimeouts );
+    ASSERT_NE( 0u, profile.busy.busyTime );
+
+    sqlite3_exec( conn, "ROLLBACK", nullptr, nullptr, nullptr );
+    sqlite3_close( conn );
+
+    ml->resetQueryProfile();
+    pl = ml->createPlaylist( "playlist 2" );
+    ASSERT_NE( nullptr, pl );
+    profile = ml->queryProfile( false );
+    ASSERT_EQ( 0u, profile.busy.nbTimeouts );
+}
+
+TEST_F( Misc, MigrateModel3 )
+{
+    auto nbIndexes = [this]() {
+        auto ctx = ml->getConn()->acquireReadContext();
+        sqlite::Statement s( ml->getConn(), "SELECT COUNT(*) FROM sqlite_master "
+                             "WHERE type = 'index' AND name = 'media_type_title_idx'" );
+        s.execute();
+        auto row = s.row();
+        auto res = row.load<int64_t>( 0 );
+        while ( row != nullptr )
+            row = s.row();
+        return res;
+    };
+    auto pl = ml->createPlaylist( "playlist" );
+    ASSERT_EQ( 1, nbIndexes() );
+
+    // Rewind the database to model 3
+    sqlite::Tools::executeRequest( ml->getConn(), "DROP INDEX media_type_title_idx" );
+    sqlite::Tools::executeUpdate( ml->getConn(), "UPDATE Settings SET db_model_version = 3" );
+    ASSERT_EQ( 0, nbIndexes() );
+
+    Reload();
+    ASSERT_EQ( 1, nbIndexes() );
+    // Model 3 databases are migrated, not recreated
+    ASSERT_NE( nullptr, ml->playlist( pl->id() ) );
+}
+
+TEST_F( Misc, MigrationStep3To4 )
+{
+    auto step = Migrations::step( 3 );
+    ASSERT_NE( nullptr, step );
+    // There is no migration past the current model
+    ASSERT_EQ( nullptr, Migrations::step( Settings::DbModelVersion ) );
+
+    sqlite::Tools::executeRequest( ml->getConn(), "DROP INDEX album_title_idx" );
+    ASSERT_TRUE( step( ml->getConn() ) );
+    // Steps must be safe to run again on an already migrated database
+    ASSERT_TRUE( step( ml->getConn() ) );
+
+    auto ctx = ml->getConn()->acquireReadContext();
+    sqlite::Statement s( ml->getConn(), "SELECT COUNT(*) FROM sqlite_master "
+                         "WHERE type = 'index' AND name = 'album_title_idx'" );
+    s.execute();
+    auto row = s.row();
+    ASSERT_EQ( 1, row.load<int64_t>( 0 ) );
+    while ( row != nullptr )
+        row = s.row();
+}
+
+TEST_F( Misc, ReadSnapshot )
+{
+    ml->createPlaylist( "playlist" );
+    ml->setQueryProfiling( true );
+    {
+        auto snapshot = ml->acquireReadSnapshot();
+        auto nbLocks = ml->queryProfile( false ).readLockWait.count;
+        ASSERT_EQ( 1u, ml->playlists( SortingCriteria::Default, false ).size() );
+
+        // Commit a change from another thread, which mustn't be visible
+        // through the snapshot
+        compat::Thread t( [this]() {
+            ml->createPlaylist( "playlist 2" );
+        });
+        t.join();
+        ASSERT_EQ( 1u, ml->playlists( SortingCriteria::Default, false ).size() );
+        ASSERT_EQ( 1u, ml->playlists( SortingCriteria::Alpha, true ).size() );
+        // All the reads used the snapshot's read context
+        ASSERT_EQ( nbLocks, ml->queryProfile( false ).readLockWait.count );
+
+        snapshot->release();
+        ASSERT_EQ( 2u, ml->playlists( SortingCriteria::Default, false ).size() );
+    }
+    ml->setQueryProfiling( false );
+    ASSERT_EQ( 2u, ml->playlists( SortingCriteria::Default, false ).size() );
+}
+
+TEST_F( Misc, ReadSnapshotDoesntCache )
+{
+    auto id = ml->createPlaylist( "playlist" )->id();
+    // Start with an empty cache
+    Reload();
+    {
+        auto snapshot = ml->acquireReadSnapshot();
+        compat::Thread t( [this, id]() {
+            ml->deletePlaylist( id );
+        });
+        t.join();
+        // The snapshot still sees the deleted playlist...
+        ASSERT_NE( nullptr, ml->playlist( id ) );
+        snapshot->release();
+    }
+    // ...but mustn't have cached it for everyone else
+    ASSERT_EQ( nullptr, ml->playlist( id ) );
+}
+
+TEST_F( Misc, NoContext )
+{
+    // The write connection mustn't be lent to a thread without a context
+    ASSERT_THROW( ml->getConn()->getConn(), sqlite::errors::NoContext );
+    auto ctx = ml->getConn()->acquireReadContext();
+    ASSERT_NE( nullptr, ml->getConn()->getConn() );
+}
+
+TEST_F( Misc, IndependentInstances )
+{
+    unlink( "test2.db" );
+    std::unique_ptr<MediaLibraryTester> ml2( new MediaLibraryWithoutBackground );
+    ml2->setFsFactory( std::make_shared<mock::NoopFsFactory>() );
+    ml2->setDeviceLister( mockDeviceLister );
+    ml2->setVerbosity( LogLevel::Error );
+    ASSERT_TRUE( ml2->initialize( "test2.db", "/tmp", cbMock.get() ) );
+
+    auto m1 = std::static_pointer_cast<Media>( ml->addMedia( "media.mp3" ) );
+    auto m2 = std::static_pointer_cast<Media>( ml2->addMedia( "other.mkv" ) );
+    // Both instances use the same ids, without sharing their entities
+    ASSERT_EQ( m1->id(), m2->id() );
+    ASSERT_EQ( m1, ml->media( m1->id() ) );
+    ASSERT_EQ( m2, ml2->media( m2->id() ) );
+    ASSERT_EQ( "other.mkv", ml2->media( m2->id() )->title() );
+
+    // Destroying an instance leaves the other caches alone
+    ml2.reset();
+    ASSERT_EQ( m1, ml->media( m1->id() ) );
+    unlink( "test2.db" );
+}
+
+TEST_F( Misc, Preload )
+{
+    auto albumId = ml->createAlbum( "album" )->id();
+    auto genreId = ml->createGenre( "genre" )->id();
+    auto m1 = std::static_pointer_cast<Media>( ml->addMedia( "media1.mp3" ) );
+    auto m2 = std::static_pointer_cast<Media>( ml->addMedia( "media2.mp3" ) );
+    m1->increasePlayCount();
+    ml->getConn()->flush();
+    Reload();
+    ASSERT_EQ( 0u, Album::cache( ml.get() ).size() );
+
+    ml->setPreloadPolicy( PreloadPolicy{ false, true, true, 10 } );
+    ml->preloadCaches();
+    ASSERT_EQ( 1u, Album::cache( ml.get() ).size() );
+    ASSERT_EQ( 1u, Genre::cache( ml.get() ).size() );
+    // Only the media which have been played are preloaded
+    ASSERT_EQ( 1u, Media::cache( ml.get() ).size() );
+
+    // Preloaded entities are fetched without querying the database
+    ml->setQueryProfiling( true );
+    ASSERT_NE( nullptr, ml->album( albumId ) );
+    ASSERT_NE( nullptr, ml->genre( genreId ) );
+    ASSERT_NE( nullptr, ml->media( m1->id() ) );
+    ASSERT_EQ( 0u, ml->queryProfile( false ).queries.size() );
+    ASSERT_NE( nullptr, ml->media( m2->id() ) );
+    ASSERT_EQ( 1u, ml->queryProfile( false ).queries.size() );
+    ml->setQueryProfiling( false );
+}
+
+TEST_F( Misc, CacheStats )
+{
+    auto findStats = [this]( const std::string& entity ) {
+        auto stats = ml->cacheStats();
+        auto it = std::find_if( begin( stats ), end( stats ), [&entity]( const CacheStats& s ) {
+            return s.entity == entity;
+        });
+        return it != end( stats ) ? *it : CacheStats{};
+    };
+    auto m = ml->addMedia( "media.mp3" );
+    auto stats = findStats( policy::MediaTable::Name );
+    ASSERT_EQ( 1u, stats.nbInserts );
+    ASSERT_EQ( 1u, stats.nbEntities );
+    ASSERT_LT( sizeof( Media ) + m->title().size(), stats.nbBytes );
+
+    ASSERT_EQ( m, ml->media( m->id() ) );
+    ASSERT_EQ( stats.nbHits + 1, findStats( policy::MediaTable::Name ).nbHits );
+
+    Media::clear( ml.get() );
+    ASSERT_EQ( 0u, findStats( policy::MediaTable::Name ).nbBytes );
+    ASSERT_NE( nullptr, ml->media( m->id() ) );
+    stats = findStats( policy::MediaTable::Name );
+    ASSERT_EQ( 1u, stats.nbMisses );
+    ASSERT_EQ( 2u, stats.nbInserts );
+    ASSERT_EQ( 1u, stats.nbEntities );
+
+    ml->setCacheStatsLogging( std::chrono::seconds{ 1 } );
+    ml->setCacheStatsLogging( std::chrono::seconds::zero() );
+}
+
+TEST_F( Misc, CacheBudget )
+{
+    auto nbEntities = [this]( const std::string& entity ) {
+        for ( const auto& s : ml->cacheStats() )
+        {
+            if ( s.entity == entity )
+                return s.nbEntities;
+        }
+        return uint64_t{ 0 };
+    };
+    // Keep about a single media per cache shard
+    ml->setCacheBudget( 1 );
+    for ( auto i = 0u; i < 64; ++i )
+        ml->addMedia( "media" + std::to_string( i ) + ".mp3" );
+    ASSERT_GE( Media::cache( ml.get() ).ShardCount, nbEntities( policy::MediaTable::Name ) );
+
+    // Restore the default budget, which keeps them all
+    ml->setCacheBudget( 0 );
+    for ( auto i = 0u; i < 64; ++i )
+        ml->addMedia( "other" + std::to_string( i ) + ".mp3" );
+    ASSERT_LE( 64u, nbEntities( policy::MediaTable::Name ) );
+}
+
+TEST_F( Misc, CacheBudgetPerEntity )
+{
+    auto nbEntities = [this]( const std::string& entity ) {
+        for ( const auto& s : ml->cacheStats() )
+        {
+            if ( s.entity == entity )
+                return s.nbEntities;
+        }
+        return uint64_t{ 0 };
+    };
+    const auto nbShards = File::cache( ml.get() ).ShardCount;
+    // Limiting the files mustn't evict any media
+    ml->setCacheBudget( policy::FileTable::Name, 1, 0 );
+    for ( auto i = 0u; i < 64; ++i )
+    {
+        auto m = ml->addMedia( "media" + std::to_string( i ) + ".mp3" );
+        m->addExternalMrl( "file:///media" + std::to_string( i ) + ".mp3", IFile::Type::Main );
+    }
+    ASSERT_GE( nbShards, nbEntities( policy::FileTable::Name ) );
+    ASSERT_LE( 64u, nbEntities( policy::MediaTable::Name ) );
+
+    // A memory budget lower than a single media only keeps the ones in use
+    auto nbFiles = nbEntities( policy::FileTable::Name );
+    ml->setCacheBudget( policy::MediaTable::Name, 0, 1 );
+    ASSERT_EQ( 0u, nbEntities( policy::MediaTable::Name ) );
+    ASSERT_EQ( nbFiles, nbEntities( policy::FileTable::Name ) );
+    ml->addMedia( "media.mp3" );
+    ASSERT_GE( 1u, nbEntities( policy::MediaTable::Name ) );
+}
@@ -28,6 +28,7 @@
 
 #include "Playlist.h"
 #include "Media.h"
+#include "database/SqliteTransaction.h"
 
 class Playlists : public Tests
 {
@@ -70,10 +71,30 @@ TEST_F( Playlists, Fetch )
 
 TEST_F( Playlists, DeletePlaylist )
 {
+    ASSERT_EQ( 1u, ml->nbPlaylists() );
     auto res = ml->deletePlaylist( pl->id() );
     ASSERT_TRUE( res );
     auto playlists = ml->playlists( SortingCriteria::Default, false );
     ASSERT_EQ( 0u, playlists.size() );
+    ASSERT_EQ( 0u, ml->nbPlaylists() );
+    ASSERT_EQ( 0u, ml->playlistIds( SortingCriteria::Default, false ).size() );
+}
+
+TEST_F( Playlists, DeleteRollback )
+{
+    {
+        auto t = ml->getConn()->newTransaction();
+        ml->deletePlaylist( pl->id() );
+        // Deletions are only propagated to the cache once the transaction ends
+        ASSERT_FALSE( pl->isDeleted() );
+    }
+    ASSERT_FALSE( pl->isDeleted() );
+    auto pl2 = ml->playlist( pl->id() );
+    ASSERT_EQ( pl, pl2 );
+
+    ml->deletePlaylist( pl->id() );
+    ASSERT_TRUE( pl->isDeleted() );
+    ASSERT_EQ( nullptr, ml->playlist( pl->id() ) );
 }
 
 TEST_F( Playlists, SetName )
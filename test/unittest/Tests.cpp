@@ -35,6 +35,8 @@ class TestEnv : public ::testing::Environment
         {
             // Always clean the DB in case a previous test crashed
             unlink("test.db");
+            unlink("test.db-wal");
+            unlink("test.db-shm");
         }
 };
 